@@ -0,0 +1,532 @@
+/**
+ * Timings for the optimized paths against the plain ones they replace.
+ * Build and run on a multi-core host with:
+ *
+ *   pio run -e bench -t exec
+ *
+ * Each case prints milliseconds per iteration, averaged after one
+ * warm-up run. The numbers are for comparing the two sides of a case
+ * on one machine, not across machines.
+ */
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Irrelon/DynaVal.h"
+#include "Irrelon/DynaBuilder.h"
+#include "Irrelon/DynaCbor.h"
+#include "Irrelon/DynaConcurrentObject.h"
+#include "Irrelon/DynaFields.h"
+#include "Irrelon/DynaJournal.h"
+#include "Irrelon/DynaProgram.h"
+#include "Irrelon/DynaQuery.h"
+#include "Irrelon/DynaSchema.h"
+#include "Irrelon/DynaValSnapshotCell.h"
+#include "Irrelon/dynaPatch.h"
+#include "Irrelon/dynaStats.h"
+
+using namespace Irrelon;
+
+// Written by every case so the compiler cannot drop the work being timed
+static volatile size_t sink = 0;
+
+// Counts every allocation made through the global operator new
+static std::atomic<size_t> allocations{0};
+
+void *operator new (const size_t size) {
+	++allocations;
+	if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete (void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete (void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+// The number of allocations one run of fn makes
+template <typename Fn>
+static size_t countAllocations (Fn &&fn) {
+	const size_t before = allocations.load();
+	fn();
+	return allocations.load() - before;
+}
+
+template <typename Fn>
+static double bench (const char *name, const int iterations, Fn &&fn) {
+	fn();
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) fn();
+	const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+	std::printf("  %-44s %10.3f ms\n", name, ms);
+	return ms;
+}
+
+// Times the plain path, then the optimized one, and prints how much faster the second is
+template <typename Before, typename After>
+static void compare (const char *beforeName, const char *afterName, const int iterations, Before &&before, After &&after) {
+	const double beforeMs = bench(beforeName, iterations, before);
+	const double afterMs = bench(afterName, iterations, after);
+	std::printf("  %-44s %10.2fx\n", "speedup", afterMs > 0 ? beforeMs / afterMs : 0);
+}
+
+/**
+ * Runs worker(thread, stop) on threads threads for about 200 ms and
+ * returns the operations they report in total, in millions per second.
+ */
+template <typename Worker>
+static double throughput (const size_t threads, Worker &&worker) {
+	std::atomic<bool> stop{false};
+	std::atomic<size_t> total{0};
+	std::vector<std::thread> pool;
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t t = 0; t < threads; ++t) {
+		pool.emplace_back([&, t] { total += worker(t, stop); });
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	stop = true;
+	for (auto &thread : pool) thread.join();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return static_cast<double>(total.load()) / seconds / 1e6;
+}
+
+// An array of {id, value, name} records
+static DynaVal makeReadings (const size_t count) {
+	DynaVal readings;
+	readings.becomeArray().reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		DynaVal reading;
+		reading["id"] = static_cast<int32_t>(i);
+		reading["value"] = static_cast<double>(i % 61);
+		reading["name"] = "sensor-" + std::to_string(i);
+		readings.push(std::move(reading));
+	}
+	return readings;
+}
+
+static void benchParallel () {
+	std::printf("Parallel deepCopy, toJson and equals (200k records)\n");
+	const DynaVal doc = makeReadings(200000);
+	const DynaVal same = doc.deepCopy();
+	const DynaParallelPolicy policy;
+
+	std::printf("  %-44s %10zu\n", "threads", policy.threadCount());
+
+	compare("toJson()", "toJson(policy)", 5,
+		[&] { sink = sink + doc.toJson().size(); },
+		[&] { sink = sink + doc.toJson(policy).size(); });
+	compare("deepCopy()", "deepCopy(policy)", 5,
+		[&] { sink = sink + doc.deepCopy().size(); },
+		[&] { sink = sink + doc.deepCopy(policy).size(); });
+	compare("equals()", "equals(policy)", 5,
+		[&] { sink = sink + doc.equals(same); },
+		[&] { sink = sink + doc.equals(same, policy); });
+}
+
+static void benchSnapshotCell () {
+	std::printf("Readers against one writer (reads per second, millions)\n");
+	DynaVal state;
+	state["values"] = makeReadings(64);
+
+	for (const size_t readers : {1, 2, 4, 8}) {
+		// Baseline: one mutex around the shared tree, the writer mutates it in place
+		DynaVal shared = state.deepCopy();
+		std::mutex lock;
+		const double locked = throughput(readers + 1, [&](const size_t thread, const std::atomic<bool> &stop) {
+			size_t ops = 0;
+			for (int32_t n = 0; !stop; ++n, ++ops) {
+				std::lock_guard<std::mutex> guard(lock);
+				if (thread == 0) shared["values"][static_cast<size_t>(n % 64)]["id"] = n;
+				else sink = sink + static_cast<size_t>(shared["values"][static_cast<size_t>(n % 64)]["id"].toInt());
+			}
+			return thread == 0 ? 0 : ops;
+		});
+
+		DynaValSnapshotCell cell(state, readers);
+		DynaVal working = state.deepCopy();
+		const double published = throughput(readers + 1, [&](const size_t thread, const std::atomic<bool> &stop) {
+			size_t ops = 0;
+			if (thread == 0) {
+				for (int32_t n = 0; !stop; ++n) {
+					working["values"][static_cast<size_t>(n % 64)]["id"] = n;
+					cell.publish(working);
+				}
+				return ops;
+			}
+			const auto reader = cell.reader();
+			for (size_t n = 0; !stop; ++n, ++ops) {
+				const auto snap = reader.read();
+				sink = sink + static_cast<size_t>((*snap)["values"][n % 64]["id"].toInt());
+			}
+			return ops;
+		});
+
+		std::printf("  %zu readers %-34s %10.3f\n", readers, "std::mutex", locked);
+		std::printf("  %zu readers %-34s %10.3f\n", readers, "DynaValSnapshotCell", published);
+	}
+}
+
+static void benchConcurrentObject () {
+	std::printf("Registry writers: 50%% set, 40%% lookup, 10%% erase (ops per second, millions)\n");
+	std::vector<std::string> keys;
+	for (int i = 0; i < 1024; ++i) keys.push_back("device:" + std::to_string(i));
+
+	for (const size_t threads : {1, 2, 4, 8, 16}) {
+		// Baseline: the whole object behind one mutex
+		DynaValObject registry;
+		std::mutex lock;
+		const double locked = throughput(threads, [&](const size_t thread, const std::atomic<bool> &stop) {
+			size_t ops = 0;
+			for (size_t n = thread * 7919; !stop; ++n, ++ops) {
+				const std::string &key = keys[n % keys.size()];
+				std::lock_guard<std::mutex> guard(lock);
+				if (n % 10 < 5) registry[key] = DynaVal(static_cast<int32_t>(n));
+				else if (n % 10 < 9) sink = sink + registry.count(key);
+				else registry.erase(key);
+			}
+			return ops;
+		});
+
+		DynaConcurrentObject sharded;
+		const double striped = throughput(threads, [&](const size_t thread, const std::atomic<bool> &stop) {
+			size_t ops = 0;
+			for (size_t n = thread * 7919; !stop; ++n, ++ops) {
+				const std::string &key = keys[n % keys.size()];
+				if (n % 10 < 5) sharded.set(key, DynaVal(static_cast<int32_t>(n)));
+				else if (n % 10 < 9) sink = sink + sharded.containsKey(key);
+				else sharded.erase(key);
+			}
+			return ops;
+		});
+
+		std::printf("  %2zu threads %-33s %10.3f\n", threads, "one std::mutex", locked);
+		std::printf("  %2zu threads %-33s %10.3f\n", threads, "DynaConcurrentObject", striped);
+	}
+}
+
+static void benchJsonCache () {
+	std::printf("Incremental serialization (1000 sensors)\n");
+	const int rates[] = {1, 10, 100};
+
+	for (const int rate : rates) {
+		DynaVal plain;
+		for (int i = 0; i < 1000; ++i) {
+			DynaVal &sensor = plain["sensor" + std::to_string(i)];
+			sensor["value"] = i;
+			sensor["unit"] = "C";
+			sensor["history"] = makeReadings(4);
+		}
+		DynaVal cached = plain.deepCopy();
+		cached.enableJsonCache();
+
+		int round = 0;
+		const auto publish = [&round, rate](DynaVal &state) {
+			// Changes rate percent of the sensors each round
+			for (int i = 0; i < 1000; i += 100 / rate) state["sensor" + std::to_string(i)]["value"] = ++round;
+			sink = sink + state.toJson().size();
+		};
+
+		std::printf(" %d%% changed per publish\n", rate);
+		compare("toJson()", "toJson() with enableJsonCache()", 20,
+			[&] { publish(plain); },
+			[&] { publish(cached); });
+	}
+}
+
+static void benchPatch () {
+	std::printf("Sending a small change to a large tree (20k records, 10 changed)\n");
+	const DynaVal base = makeReadings(20000);
+	DynaVal edited = base.deepCopy();
+	for (size_t i = 0; i < 20000; i += 2000) edited[i]["value"] = -1.0;
+
+	// Sender side: the whole document against the patch that turns base into edited
+	compare("toJson() of the full tree", "diff() + toJson() of the patch", 10,
+		[&] { sink = sink + edited.toJson().size(); },
+		[&] { sink = sink + DynaVal::diff(base, edited).toJson().size(); });
+
+	// Receiver side: replace the replica with the full tree against applying the patch
+	const DynaVal patch = DynaVal::diff(base, edited);
+	const std::string fullJson = edited.toJson();
+	const std::string patchJson = patch.toJson();
+	std::printf("  %-44s %10zu\n", "full bytes", fullJson.size());
+	std::printf("  %-44s %10zu\n", "patch bytes", patchJson.size());
+	DynaVal replica = base.deepCopy();
+	compare("deepCopy() of the full tree", "applyPatch()", 10,
+		[&] { replica = edited.deepCopy(); sink = sink + replica.size(); },
+		[&] { sink = sink + replica.applyPatch(patch).isError(); });
+}
+
+static void benchCbor () {
+	std::printf("CBOR against JSON text (50k records)\n");
+	const DynaVal doc = makeReadings(50000);
+	const std::string json = doc.toJson();
+	const std::vector<uint8_t> cbor = dynaToCbor(doc);
+	std::printf("  %-44s %10zu bytes\n", "JSON size", json.size());
+	std::printf("  %-44s %10zu bytes\n", "CBOR size", cbor.size());
+
+	compare("encode toJson()", "encode dynaToCbor()", 10,
+		[&] { sink = sink + doc.toJson().size(); },
+		[&] { sink = sink + dynaToCbor(doc).size(); });
+	compare("decode dynaFromJson()", "decode dynaFromCbor()", 10,
+		[&] { sink = sink + dynaFromJson(json).size(); },
+		[&] { sink = sink + dynaFromCbor(cbor).size(); });
+}
+
+static void benchJournal () {
+	std::printf("Persisting 1000 single-value changes to 5k records\n");
+	const DynaVal base = makeReadings(5000);
+	const std::string path = "bench-journal";
+	const int changes = 1000;
+
+	// Neither side syncs, so the times compare the bytes produced and written rather than the storage
+	uint64_t rewriteBytes = 0;
+	const double rewriteMs = bench("rewrite toJson() per change", 1, [&] {
+		DynaVal state = base.deepCopy();
+		rewriteBytes = 0;
+		for (int n = 0; n < changes; ++n) {
+			state[static_cast<size_t>(n * 5)]["value"] = n;
+			const std::string json = state.toJson();
+			FILE *file = std::fopen((path + ".json").c_str(), "wb");
+			if (!file) return;
+			rewriteBytes += std::fwrite(json.data(), 1, json.size(), file);
+			std::fclose(file);
+		}
+	});
+
+	uint64_t journalBytes = 0;
+	const double journalMs = bench("DynaJournal set() per change", 1, [&] {
+		std::remove((path + ".snap").c_str());
+		std::remove((path + ".log").c_str());
+		DynaJournal journal(path, {0, 64 * 1024});
+		journal.open();
+		journal.set("", base);
+		const uint64_t seeded = journal.bytesWritten();
+		for (int n = 0; n < changes; ++n) {
+			journal.set("/" + std::to_string(n * 5) + "/value", DynaVal(n));
+		}
+		journal.close();
+		journalBytes = journal.bytesWritten() - seeded;
+	});
+
+	std::printf("  %-44s %10.2fx\n", "speedup", journalMs > 0 ? rewriteMs / journalMs : 0);
+	std::printf("  %-44s %10llu\n", "bytes per change, rewrite", static_cast<unsigned long long>(rewriteBytes / changes));
+	std::printf("  %-44s %10llu\n", "bytes per change, journal", static_cast<unsigned long long>(journalBytes / changes));
+
+	DynaJournal recovered(path);
+	bench("recovery open()", 1, [&] { recovered.open(); sink = sink + recovered.state().size(); });
+	recovered.close();
+	std::remove((path + ".json").c_str());
+	std::remove((path + ".snap").c_str());
+	std::remove((path + ".log").c_str());
+}
+
+// The uncompiled baseline: reads the descriptor tree and compares type names for every value
+static bool interpretType (const DynaVal &value, const DynaVal &typeNode);
+
+static bool interpretParams (const DynaVal &value, const DynaVal &params) {
+	if (!value.isObject()) return false;
+	for (size_t i = 0; i < params.size(); ++i) {
+		const DynaVal &param = params[i];
+		const bool optional = param["kind"].toString() == "ASSIGNMENT_PATTERN";
+		const DynaVal &identifier = optional ? param["left"] : param;
+		const std::string key = identifier["value"].toString();
+		if (!value.containsKey(key)) {
+			if (optional) continue;
+			return false;
+		}
+		if (!interpretType(value[key], identifier["type"])) return false;
+	}
+	return true;
+}
+
+static bool interpretType (const DynaVal &value, const DynaVal &typeNode) {
+	const std::string name = typeNode["value"].toString();
+	if (name == "any") return true;
+	if (name == "int" || name == "u_int" || name == "long") return value.isNumber() && value.number == std::trunc(value.number);
+	if (name == "float" || name == "double") return value.isNumber();
+	if (name == "array") {
+		if (!value.isArray()) return false;
+		for (size_t i = 0; i < value.size(); ++i) {
+			if (!interpretType(value[i], typeNode["subType"])) return false;
+		}
+		return true;
+	}
+	if (name == "object" && typeNode.containsKey("subType")) return interpretParams(value, typeNode["subType"]);
+	return dynaValTypeToString(value.type) == name;
+}
+
+static void benchSchema () {
+	std::printf("Schema validation of 20k records\n");
+	const DynaVal readings = makeReadings(20000);
+	DynaVal params;
+	params.push(makeParam("id", makeType(DynaValType::Int)));
+	params.push(makeParam("value", makeType(DynaValType::Double)));
+	params.push(makeParam("name", makeType(DynaValType::String)));
+	params.push(makeParam("unit", makeType(DynaValType::String), "C", true));
+	const DynaVal descriptor = makeType(DynaValType::Array, makeType(DynaValType::Object, params));
+	const DynaSchema schema = DynaSchema::fromDescriptor(descriptor);
+
+	compare("walk the descriptor tree", "DynaSchema::isValid()", 20,
+		[&] { sink = sink + interpretType(readings, descriptor); },
+		[&] { sink = sink + schema.isValid(readings); });
+}
+
+// The uncompiled baseline: dispatches on "kind" strings and finds identifiers by name at every node
+static DynaVal interpret (const DynaVal &node, const DynaVal &scope) {
+	const std::string kind = node["kind"].toString();
+	if (kind == "LITERAL") return node["value"];
+	if (kind == "IDENTIFIER") return scope[node["value"].toString()];
+	if (kind == "CONDITIONAL") return interpret(node[interpret(node["test"], scope).isFalsy() ? "alternate" : "consequent"], scope);
+
+	const std::string op = node["operator"].toString();
+	const DynaVal left = interpret(node["left"], scope);
+	if (kind == "LOGICAL") return (op == "&&") == left.isFalsy() ? left : interpret(node["right"], scope);
+
+	const double a = left.toDouble();
+	const double b = interpret(node["right"], scope).toDouble();
+	if (op == "+") return a + b;
+	if (op == "-") return a - b;
+	if (op == "*") return a * b;
+	if (op == "/") return a / b;
+	if (op == ">") return a > b;
+	return a < b;
+}
+
+static void benchProgram () {
+	std::printf("Expression evaluation, 100k runs\n");
+	// price * qty + fee > limit && enabled ? price * qty : 0
+	const DynaVal total = makeBinary("*", makeIdentifier("price"), makeIdentifier("qty"));
+	const DynaVal ast = makeConditional(
+		makeLogical("&&",
+			makeBinary(">", makeBinary("+", total, makeIdentifier("fee")), makeIdentifier("limit")),
+			makeIdentifier("enabled")),
+		total,
+		makeLiteral(0.0));
+	const DynaProgram program = DynaProgram::compile(ast);
+
+	DynaVal scope;
+	scope["price"] = 12.5;
+	scope["qty"] = 4.0;
+	scope["fee"] = 1.5;
+	scope["limit"] = 10.0;
+	scope["enabled"] = true;
+
+	compare("tree-walking interpreter", "DynaProgram::run()", 3,
+		[&] { for (int i = 0; i < 100000; ++i) sink = sink + static_cast<size_t>(interpret(ast, scope).toDouble()); },
+		[&] { for (int i = 0; i < 100000; ++i) sink = sink + static_cast<size_t>(program.run(scope).toDouble()); });
+}
+
+static void benchQuery () {
+	std::printf("Filter query (100k records)\n");
+	DynaVal doc;
+	doc["readings"] = makeReadings(100000);
+	const DynaQuery hot = DynaQuery::compile("$.readings[?(@.value > 30)].id");
+
+	compare("hand-written loop over toArray()", "compiled DynaQuery::count()", 10,
+		[&] {
+			size_t matches = 0;
+			for (auto &reading : doc["readings"].toArray()) {
+				if (reading["value"].toDouble() > 30) matches += reading["id"].isNumber();
+			}
+			sink = sink + matches;
+		},
+		[&] { sink = sink + hot.count(doc); });
+	bench("compiled on every call", 10, [&] {
+		sink = sink + DynaQuery::compile("$.readings[?(@.value > 30)].id").count(doc);
+	});
+}
+
+static void benchStats () {
+	std::printf("Numeric statistics (1M mixed numbers)\n");
+	DynaVal values;
+	values.becomeArray().reserve(1000000);
+	for (int32_t i = 0; i < 1000000; ++i) {
+		if (i % 2) values.push(static_cast<double>(i) / 3);
+		else values.push(i);
+	}
+
+	compare("toDouble() loop, two passes", "dynaStats()", 10,
+		[&] {
+			double sum = 0;
+			double low = values[0].toDouble();
+			double high = low;
+			size_t count = 0;
+			for (const auto &item : values.toArray()) {
+				if (!item.isNumber()) continue;
+				const double v = item.toDouble();
+				sum += v;
+				if (v < low) low = v;
+				if (v > high) high = v;
+				++count;
+			}
+			const double mean = sum / static_cast<double>(count);
+			double squares = 0;
+			for (const auto &item : values.toArray()) {
+				if (item.isNumber()) squares += (item.toDouble() - mean) * (item.toDouble() - mean);
+			}
+			sink = sink + static_cast<size_t>(squares / static_cast<double>(count) + low + high);
+		},
+		[&] { sink = sink + static_cast<size_t>(dynaStats(values).variance); });
+
+	std::vector<double> packed(1000000);
+	for (size_t i = 0; i < packed.size(); ++i) packed[i] = static_cast<double>(i) / 3;
+	bench("dynaStats() on packed doubles", 20, [&] { sink = sink + static_cast<size_t>(dynaStats(packed).variance); });
+}
+
+static void benchBuilder () {
+	std::printf("Building a 50k node response\n");
+	const size_t samples = 16000;
+
+	const auto plain = [&] {
+		DynaVal response;
+		response["device"] = "probe";
+		for (size_t i = 0; i < samples; ++i) {
+			DynaVal sample;
+			sample["ts"] = static_cast<int64_t>(i);
+			sample["v"] = static_cast<double>(i) / 2;
+			response["samples"].push(sample);
+		}
+		sink = sink + response["samples"].size();
+	};
+	const auto built = [&] {
+		DynaBuilder b;
+		b.beginObject(2).key("device").value("probe").key("samples").beginArray(samples);
+		for (size_t i = 0; i < samples; ++i) {
+			b.beginObject(2).key("ts").value(static_cast<int64_t>(i)).key("v").value(static_cast<double>(i) / 2).endObject();
+		}
+		sink = sink + b.endArray().endObject().build().size();
+	};
+
+	compare("operator[] and push()", "DynaBuilder", 10, plain, built);
+
+	const size_t plainAllocations = countAllocations(plain);
+	const size_t builtAllocations = countAllocations(built);
+	std::printf("  %-44s %10zu\n", "allocations, operator[] and push()", plainAllocations);
+	std::printf("  %-44s %10zu\n", "allocations, DynaBuilder", builtAllocations);
+	std::printf("  %-44s %10.2fx\n", "fewer allocations", builtAllocations ? static_cast<double>(plainAllocations) / builtAllocations : 0);
+}
+
+int main () {
+	benchParallel();
+	benchJsonCache();
+	benchSnapshotCell();
+	benchConcurrentObject();
+	benchPatch();
+	benchCbor();
+	benchJournal();
+	benchSchema();
+	benchProgram();
+	benchQuery();
+	benchStats();
+	benchBuilder();
+	return 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * Builds a document front to back with moves into pre-sized storage.
+	 *
+	 *   Irrelon::DynaBuilder b;
+	 *   b.beginObject(2)
+	 *       .key("id").value(42)
+	 *       .key("tags").beginArray(tags.size());
+	 *   for (const auto &tag : tags) b.value(tag);
+	 *   const Irrelon::DynaVal doc = b.endArray().endObject().build();
+	 *
+	 * Giving beginObject() / beginArray() the expected number of children
+	 * reserves the storage once, so a container never regrows. Every node
+	 * still makes its own allocations: bench/bench.cpp counts 64007 for a
+	 * 16k-sample response against 64020 with operator[] and push(), so use
+	 * the builder for its single-pass shape, not to save heap traffic.
+	 * Misuse (a value in an object without a key, unbalanced begin / end)
+	 * throws std::runtime_error.
+	 */
+	class DynaBuilder {
+	public:
+		explicit DynaBuilder (const size_t expectedDepth = 8) {
+			_stack.reserve(expectedDepth);
+		}
+
+		DynaBuilder &beginObject (const size_t expectedKeys = 0) {
+			DynaVal &container = _place(DynaVal(DynaValObject()));
+			if (expectedKeys) container.object->reserve(expectedKeys);
+			_stack.push_back(&container);
+			return *this;
+		}
+
+		DynaBuilder &beginArray (const size_t expectedItems = 0) {
+			DynaVal &container = _place(DynaVal(DynaValArray()));
+			if (expectedItems) container.array->reserve(expectedItems);
+			_stack.push_back(&container);
+			return *this;
+		}
+
+		DynaBuilder &endObject () {
+			if (_stack.empty() || !_stack.back()->isObject()) detail::dynaThrow("DynaBuilder::endObject() without an open object");
+			if (_hasKey) detail::dynaThrow("DynaBuilder::endObject() after a key without a value");
+			_stack.pop_back();
+			return *this;
+		}
+
+		DynaBuilder &endArray () {
+			if (_stack.empty() || !_stack.back()->isArray()) detail::dynaThrow("DynaBuilder::endArray() without an open array");
+			_stack.pop_back();
+			return *this;
+		}
+
+		// Names the next value in the open object
+		DynaBuilder &key (std::string name) {
+			if (_stack.empty() || !_stack.back()->isObject()) detail::dynaThrow("DynaBuilder::key() outside an object");
+			if (_hasKey) detail::dynaThrow("DynaBuilder::key() after a key without a value");
+			_key = std::move(name);
+			_hasKey = true;
+			return *this;
+		}
+
+		DynaBuilder &value (DynaVal val) {
+			_place(std::move(val));
+			return *this;
+		}
+
+		[[nodiscard]] bool isComplete () const { return _hasRoot && _stack.empty(); }
+
+		// Hands over the finished document and resets the builder
+		DynaVal build () {
+			if (!isComplete()) detail::dynaThrow("DynaBuilder::build() with open containers or no value");
+			DynaVal out = std::move(_root);
+			_root = DynaVal();
+			_hasRoot = false;
+			return out;
+		}
+
+	private:
+		DynaVal _root;
+		bool _hasRoot = false;
+		// Open containers; pointers stay valid as nothing is added to a parent while its child is open
+		std::vector<DynaVal *> _stack;
+		std::string _key;
+		bool _hasKey = false;
+
+		DynaVal &_place (DynaVal &&val) {
+			if (_stack.empty()) {
+				if (_hasRoot) detail::dynaThrow("DynaBuilder already has a complete document");
+				_root = std::move(val);
+				_hasRoot = true;
+				return _root;
+			}
+
+			DynaVal &parent = *_stack.back();
+			if (parent.isArray()) {
+				parent.array->push_back(std::move(val));
+				return parent.array->back();
+			}
+
+			if (!_hasKey) detail::dynaThrow("DynaBuilder value in an object needs a key()");
+			_hasKey = false;
+			return parent.object->insert_or_assign(std::move(_key), std::move(val)).first->second;
+		}
+	};
+}
@@ -0,0 +1,397 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+
+/**
+ * CBOR (RFC 8949) encoding for DynaVal.
+ *
+ * Every DynaValType round trips, including the numeric distinctions:
+ *   Int, UInt, Long -> plain integer (major type 0 or 1)
+ *   Float           -> single precision float
+ *   Double          -> double precision float
+ *   Error           -> tagged map of message, statusCode and key
+ *   Undefined       -> simple value undefined
+ * An untagged integer decodes as Int when it fits 32 bits signed, then
+ * UInt, then Long, so integers only carry a type tag when their type is
+ * not the one their value implies. Integer types holding a fraction or a
+ * value beyond 2^53 are written as a tagged double and keep their type.
+ * Arrays whose elements are all UInt values in [0, 255] are written as a
+ * byte string and decode back into the same array of UInt values.
+ *
+ * The private tags default to an unassigned range and can be moved by
+ * defining DYNAVAL_CBOR_TAG_BASE.
+ */
+#ifndef DYNAVAL_CBOR_TAG_BASE
+#define DYNAVAL_CBOR_TAG_BASE 55900
+#endif
+
+#ifndef DYNAVAL_CBOR_MAX_DEPTH
+#define DYNAVAL_CBOR_MAX_DEPTH 256
+#endif
+
+namespace Irrelon {
+	namespace detail {
+		constexpr uint64_t kDynaCborTagInt = DYNAVAL_CBOR_TAG_BASE;
+		constexpr uint64_t kDynaCborTagLong = DYNAVAL_CBOR_TAG_BASE + 1;
+		constexpr uint64_t kDynaCborTagError = DYNAVAL_CBOR_TAG_BASE + 2;
+		constexpr uint64_t kDynaCborTagUInt = DYNAVAL_CBOR_TAG_BASE + 3;
+
+		inline void dynaCborHead (std::vector<uint8_t> &out, const uint8_t major, const uint64_t value) {
+			const auto m = static_cast<uint8_t>(major << 5);
+
+			if (value < 24) {
+				out.push_back(static_cast<uint8_t>(m | value));
+			} else if (value <= 0xff) {
+				out.push_back(m | 24);
+				out.push_back(static_cast<uint8_t>(value));
+			} else if (value <= 0xffff) {
+				out.push_back(m | 25);
+				for (int shift = 8; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+			} else if (value <= 0xffffffffULL) {
+				out.push_back(m | 26);
+				for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+			} else {
+				out.push_back(m | 27);
+				for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+			}
+		}
+
+		inline void dynaCborInteger (std::vector<uint8_t> &out, const double number) {
+			if (number < 0) {
+				dynaCborHead(out, 1, static_cast<uint64_t>(-(number + 1)));
+			} else {
+				dynaCborHead(out, 0, static_cast<uint64_t>(number));
+			}
+		}
+
+		// The integer type an untagged whole number decodes as
+		inline DynaValType dynaCborIntegerType (const double number) {
+			if (number >= -2147483648.0 && number <= 2147483647.0) return DynaValType::Int;
+			if (number >= 0 && number <= 4294967295.0) return DynaValType::UInt;
+			return DynaValType::Long;
+		}
+
+		inline uint64_t dynaCborIntegerTag (const DynaValType type) {
+			if (type == DynaValType::UInt) return kDynaCborTagUInt;
+			return type == DynaValType::Long ? kDynaCborTagLong : kDynaCborTagInt;
+		}
+
+		inline void dynaCborDouble (std::vector<uint8_t> &out, const double number) {
+			uint64_t bits;
+			std::memcpy(&bits, &number, sizeof(bits));
+			out.push_back(0xfb);
+			for (int shift = 56; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(bits >> shift));
+		}
+
+		inline void dynaCborFloat (std::vector<uint8_t> &out, const float number) {
+			uint32_t bits;
+			std::memcpy(&bits, &number, sizeof(bits));
+			out.push_back(0xfa);
+			for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(bits >> shift));
+		}
+
+		inline void dynaCborText (std::vector<uint8_t> &out, const std::string &text) {
+			dynaCborHead(out, 3, text.size());
+			out.insert(out.end(), text.begin(), text.end());
+		}
+
+		inline bool dynaCborIsByteArray (const DynaValArray &arr) {
+			if (arr.empty()) return false;
+			for (const auto &item : arr) {
+				if (item.type != DynaValType::UInt || item.number < 0 || item.number > 255 || item.number != std::trunc(item.number)) return false;
+			}
+			return true;
+		}
+
+		inline void dynaCborEncode (const DynaVal &val, std::vector<uint8_t> &out) {
+			switch (val.type) {
+				case DynaValType::Null:
+					out.push_back(0xf6);
+					break;
+				case DynaValType::Any:
+				case DynaValType::Undefined:
+					out.push_back(0xf7);
+					break;
+				case DynaValType::Bool:
+					out.push_back(val.boolean ? 0xf5 : 0xf4);
+					break;
+				case DynaValType::UInt:
+				case DynaValType::Int:
+				case DynaValType::Long:
+					// A fraction or a value past 2^53 is written as a double, tagged so it keeps its type
+					if (std::trunc(val.number) != val.number || std::fabs(val.number) > 9007199254740992.0) {
+						dynaCborHead(out, 6, dynaCborIntegerTag(val.type));
+						dynaCborDouble(out, val.number);
+						break;
+					}
+					if (val.type != dynaCborIntegerType(val.number)) dynaCborHead(out, 6, dynaCborIntegerTag(val.type));
+					dynaCborInteger(out, val.number);
+					break;
+				case DynaValType::Float:
+					dynaCborFloat(out, static_cast<float>(val.number));
+					break;
+				case DynaValType::Double:
+					dynaCborDouble(out, val.number);
+					break;
+				case DynaValType::String:
+					dynaCborText(out, val.string);
+					break;
+				case DynaValType::Array: {
+					// clear() leaves no storage, which is an empty array
+					if (!val.array) {
+						dynaCborHead(out, 4, 0);
+						break;
+					}
+					const auto &arr = *val.array;
+					if (dynaCborIsByteArray(arr)) {
+						dynaCborHead(out, 2, arr.size());
+						for (const auto &item : arr) out.push_back(static_cast<uint8_t>(item.number));
+						break;
+					}
+					dynaCborHead(out, 4, arr.size());
+					for (const auto &item : arr) dynaCborEncode(item, out);
+					break;
+				}
+				case DynaValType::Object:
+					dynaCborHead(out, 5, val.size());
+					if (val.object) {
+						for (const auto &[key, item] : *val.object) {
+							dynaCborText(out, key);
+							dynaCborEncode(item, out);
+						}
+					}
+					break;
+				case DynaValType::Error: {
+					dynaCborHead(out, 6, kDynaCborTagError);
+					dynaCborHead(out, 5, 3);
+					const DynaError empty{};
+					const DynaError &err = val.errorData ? *val.errorData : empty;
+					dynaCborText(out, "message");
+					dynaCborText(out, err.message);
+					dynaCborText(out, "statusCode");
+					dynaCborInteger(out, err.statusCode);
+					dynaCborText(out, "key");
+					dynaCborText(out, err.key);
+					break;
+				}
+			}
+		}
+
+		class DynaCborDecoder {
+		public:
+			DynaCborDecoder (const uint8_t *data, const size_t length) : _data(data), _length(length) {}
+
+			bool decode (DynaVal &out, const size_t depth = 0) {
+				if (depth > DYNAVAL_CBOR_MAX_DEPTH) return fail("nesting too deep");
+
+				uint8_t major;
+				uint8_t info;
+				uint64_t value;
+				if (!head(major, info, value)) return false;
+
+				switch (major) {
+					case 0:
+					case 1:
+						out = DynaVal();
+						out.number = major == 0 ? static_cast<double>(value) : -1.0 - static_cast<double>(value);
+						out.type = dynaCborIntegerType(out.number);
+						return true;
+					case 2: {
+						if (!available(value)) return false;
+						DynaValArray arr;
+						arr.reserve(value);
+						for (uint64_t i = 0; i < value; ++i) arr.emplace_back(static_cast<uint8_t>(_data[_pos++]));
+						out = DynaVal(std::move(arr));
+						return true;
+					}
+					case 3:
+						if (!available(value)) return false;
+						out = DynaVal();
+						out.type = DynaValType::String;
+						out.string.assign(reinterpret_cast<const char *>(_data + _pos), value);
+						_pos += value;
+						return true;
+					case 4: {
+						// Every element takes at least one byte, which bounds the reservation
+						if (!available(value)) return false;
+						DynaValArray arr(value);
+						for (auto &item : arr) {
+							if (!decode(item, depth + 1)) return false;
+						}
+						out = DynaVal(std::move(arr));
+						return true;
+					}
+					case 5: {
+						// Every entry takes at least two bytes
+						if (value > (_length - _pos) / 2) return fail("unexpected end of input");
+						DynaValObject obj;
+						obj.reserve(value);
+						for (uint64_t i = 0; i < value; ++i) {
+							uint8_t keyMajor;
+							uint8_t keyInfo;
+							uint64_t keyLength;
+							if (!head(keyMajor, keyInfo, keyLength)) return false;
+							if (keyMajor != 3) return fail("object keys must be text strings");
+							if (!available(keyLength)) return false;
+							std::string key(reinterpret_cast<const char *>(_data + _pos), keyLength);
+							_pos += keyLength;
+							if (!decode(obj[std::move(key)], depth + 1)) return false;
+						}
+						out = DynaVal(std::move(obj));
+						return true;
+					}
+					case 6:
+						return decodeTagged(value, out, depth);
+					default:
+						return simple(info, value, out);
+				}
+			}
+
+			[[nodiscard]] size_t position () const { return _pos; }
+
+			[[nodiscard]] const std::string &error () const { return _error; }
+
+		private:
+			const uint8_t *_data;
+			size_t _length;
+			size_t _pos = 0;
+			std::string _error;
+
+			bool fail (const char *message) {
+				if (_error.empty()) _error = message;
+				return false;
+			}
+
+			bool available (const uint64_t count) {
+				if (count > _length - _pos) return fail("unexpected end of input");
+				return true;
+			}
+
+			bool head (uint8_t &major, uint8_t &info, uint64_t &value) {
+				if (!available(1)) return false;
+				const uint8_t initial = _data[_pos++];
+				major = initial >> 5;
+				info = initial & 0x1f;
+
+				if (info < 24) {
+					value = info;
+					return true;
+				}
+
+				if (info > 27) {
+					return fail(info == 31 ? "indefinite length items are not supported" : "reserved additional info");
+				}
+
+				const size_t bytes = static_cast<size_t>(1) << (info - 24);
+				if (!available(bytes)) return false;
+				value = 0;
+				for (size_t i = 0; i < bytes; ++i) value = (value << 8) | _data[_pos++];
+				return true;
+			}
+
+			bool decodeTagged (const uint64_t tag, DynaVal &out, const size_t depth) {
+				if (!decode(out, depth + 1)) return false;
+
+				if (tag == kDynaCborTagInt || tag == kDynaCborTagLong || tag == kDynaCborTagUInt) {
+					if (!out.isNumber()) return fail("integer tag on a non-number");
+					if (tag == kDynaCborTagInt) out.type = DynaValType::Int;
+					else out.type = tag == kDynaCborTagLong ? DynaValType::Long : DynaValType::UInt;
+					return true;
+				}
+
+				if (tag == kDynaCborTagError) {
+					if (!out.isObject()) return fail("error tag on a non-map");
+					DynaError err;
+					err.message = static_cast<const DynaVal &>(out)["message"].string;
+					err.statusCode = static_cast<const DynaVal &>(out)["statusCode"].toInt();
+					err.key = static_cast<const DynaVal &>(out)["key"].string;
+					out = DynaVal(std::move(err));
+					return true;
+				}
+
+				// Unknown tags are transparent
+				return true;
+			}
+
+			bool simple (const uint8_t info, const uint64_t value, DynaVal &out) {
+				out = DynaVal();
+
+				switch (info) {
+					case 20:
+					case 21:
+						out.set(info == 21);
+						return true;
+					case 22:
+						return true;
+					case 23:
+						out.becomeUndefined();
+						return true;
+					case 25: {
+						// Half precision, decoded per RFC 8949 appendix D
+						const auto half = static_cast<uint16_t>(value);
+						const int exponent = (half >> 10) & 0x1f;
+						const int mantissa = half & 0x3ff;
+						double number;
+						if (exponent == 0) number = std::ldexp(mantissa, -24);
+						else if (exponent != 31) number = std::ldexp(mantissa + 1024, exponent - 25);
+						else number = mantissa == 0 ? INFINITY : NAN;
+						out.set(static_cast<float>(half & 0x8000 ? -number : number));
+						return true;
+					}
+					case 26: {
+						const auto bits = static_cast<uint32_t>(value);
+						float number;
+						std::memcpy(&number, &bits, sizeof(number));
+						out.set(number);
+						return true;
+					}
+					case 27: {
+						double number;
+						std::memcpy(&number, &value, sizeof(number));
+						out.set(number);
+						return true;
+					}
+					default:
+						return fail("unsupported simple value");
+				}
+			}
+		};
+	}
+
+	// Appends the CBOR encoding of val to out
+	inline void dynaToCbor (const DynaVal &val, std::vector<uint8_t> &out) {
+		detail::dynaCborEncode(val, out);
+	}
+
+	[[nodiscard]] inline std::vector<uint8_t> dynaToCbor (const DynaVal &val) {
+		std::vector<uint8_t> out;
+		detail::dynaCborEncode(val, out);
+		return out;
+	}
+
+	/**
+	 * Decodes one CBOR data item from data. Returns an error value (status
+	 * 400) for malformed or truncated input. When consumed is given it
+	 * receives the number of bytes read.
+	 */
+	[[nodiscard]] inline DynaVal dynaFromCbor (const uint8_t *data, const size_t length, size_t *consumed = nullptr) {
+		detail::DynaCborDecoder decoder(data, length);
+		DynaVal out;
+
+		if (!decoder.decode(out)) {
+			return DynaVal::error("CBOR decode failed at byte " + std::to_string(decoder.position()) + ": " + decoder.error(), 400);
+		}
+
+		if (consumed) *consumed = decoder.position();
+		return out;
+	}
+
+	[[nodiscard]] inline DynaVal dynaFromCbor (const std::vector<uint8_t> &data, size_t *consumed = nullptr) {
+		return dynaFromCbor(data.data(), data.size(), consumed);
+	}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+
+namespace Irrelon {
+	/**
+	 * An object-like key/value registry that many threads can write to at
+	 * once. Keys are spread over independently locked shards by hash so
+	 * writers to different keys rarely contend, unlike wrapping a single
+	 * DynaValObject in one mutex.
+	 *
+	 * Values are stored by value. Array and object values share storage with
+	 * the DynaVal they were copied from (as with any DynaVal copy), so store
+	 * a deepCopy() if the source will keep being mutated elsewhere, and use
+	 * update() to mutate a stored container in place under its shard lock.
+	 * Reads hand out deep copies, which later updates cannot race with.
+	 */
+	class DynaConcurrentObject {
+		struct alignas(64) Shard {
+			mutable std::mutex mutex;
+			DynaValObject object;
+		};
+
+	public:
+		explicit DynaConcurrentObject (const size_t shardCount = 16)
+			: _shards(new Shard[shardCount ? shardCount : 1]),
+			  _shardCount(shardCount ? shardCount : 1) {}
+
+		DynaConcurrentObject (const DynaConcurrentObject &) = delete;
+		DynaConcurrentObject &operator= (const DynaConcurrentObject &) = delete;
+
+		// Inserts or replaces the value stored under key
+		void set (const std::string &key, DynaVal value) {
+			auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			shard.object[key] = std::move(value);
+		}
+
+		// Inserts only if the key is absent, returns true if the value was inserted
+		bool insert (const std::string &key, DynaVal value) {
+			auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			return shard.object.emplace(key, std::move(value)).second;
+		}
+
+		/**
+		 * Calls fn with a mutable reference to the value under key, creating
+		 * a null value first if the key is absent. The shard stays locked for
+		 * the duration of the call, so fn must not touch this object.
+		 */
+		void update (const std::string &key, const std::function<void(DynaVal &)> &fn) {
+			auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			fn(shard.object[key]);
+		}
+
+		// Deep copies the value under key into out, returns false if the key is absent
+		bool find (const std::string &key, DynaVal &out) const {
+			const auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			const auto it = shard.object.find(key);
+			if (it == shard.object.end()) return false;
+			out = it->second.deepCopy();
+			return true;
+		}
+
+		// Returns a deep copy of the value under key or an undefined DynaVal if absent
+		[[nodiscard]] DynaVal get (const std::string &key) const {
+			DynaVal out;
+			if (!find(key, out)) out.becomeUndefined();
+			return out;
+		}
+
+		[[nodiscard]] bool containsKey (const std::string &key) const {
+			const auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			return shard.object.find(key) != shard.object.end();
+		}
+
+		bool erase (const std::string &key) {
+			auto &shard = _shardFor(key);
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			return shard.object.erase(key) > 0;
+		}
+
+		// Total key count, taken with every shard locked
+		[[nodiscard]] size_t size () const {
+			const auto locks = _lockAll();
+			size_t total = 0;
+			for (size_t i = 0; i < _shardCount; ++i) total += _shards[i].object.size();
+			return total;
+		}
+
+		/**
+		 * Visits every entry with all shards locked, so the callback observes
+		 * a single consistent state. The callback must not touch this object.
+		 */
+		void forEach (const std::function<void(const std::string &, const DynaVal &)> &fn) const {
+			const auto locks = _lockAll();
+			for (size_t i = 0; i < _shardCount; ++i) {
+				for (const auto &[key, val] : _shards[i].object) fn(key, val);
+			}
+		}
+
+		// A consistent deep copy of every entry as a plain object DynaVal
+		[[nodiscard]] DynaVal snapshot () const {
+			const auto locks = _lockAll();
+			size_t total = 0;
+			for (size_t i = 0; i < _shardCount; ++i) total += _shards[i].object.size();
+
+			DynaValObject merged;
+			merged.reserve(total);
+			for (size_t i = 0; i < _shardCount; ++i) {
+				for (const auto &[key, val] : _shards[i].object) merged.emplace(key, val.deepCopy());
+			}
+			return DynaVal(std::move(merged));
+		}
+
+		// Serializes a consistent view of every entry without copying the values
+		[[nodiscard]] std::string toJson () const {
+			std::string out = "{";
+			bool first = true;
+			forEach([&](const std::string &key, const DynaVal &val) {
+				if (!first) out += ',';
+				first = false;
+				out += DynaVal(key).toJson();
+				out += ':';
+				out += val.toJson();
+			});
+			out += '}';
+			return out;
+		}
+
+		[[nodiscard]] size_t shardCount () const { return _shardCount; }
+
+	private:
+		std::unique_ptr<Shard[]> _shards;
+		size_t _shardCount;
+
+		[[nodiscard]] Shard &_shardFor (const std::string &key) const {
+			return _shards[std::hash<std::string>{}(key) % _shardCount];
+		}
+
+		// Locks every shard in index order so concurrent callers cannot deadlock
+		[[nodiscard]] std::vector<std::unique_lock<std::mutex>> _lockAll () const {
+			std::vector<std::unique_lock<std::mutex>> locks;
+			locks.reserve(_shardCount);
+			for (size_t i = 0; i < _shardCount; ++i) locks.emplace_back(_shards[i].mutex);
+			return locks;
+		}
+	};
+}
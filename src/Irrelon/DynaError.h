@@ -1,14 +1,17 @@
 #pragma once
+#include <charconv>
+#include <memory>
+#include <ostream>
 #include <string>
-#include <sstream>
 
 namespace Irrelon {
 	struct DynaVal;
 
 	struct DynaError {
 		std::string message;
-		int statusCode;
+		int statusCode = 0;
 		std::string key;
+		// An array of frames, null until some are added. Read it through DynaVal::errorStack()
 		std::shared_ptr<DynaVal> stack;
 
 		DynaError() = default;
@@ -16,19 +19,35 @@ namespace Irrelon {
 		DynaError(std::string msg, const int code = 500): message(std::move(msg)), statusCode(code) {}
 
 		[[nodiscard]] std::string toString () const {
-			std::ostringstream out;
-
-			if (!message.empty()) {
-				out << "Error(" << statusCode << "): " << message;
-				// TODO: Figure out what stack trace shapes will be and what they will look like when stringified
-				//if (stack) {
-				//	out << std::endl << "Stack trace: " << stack->toJson() << std::endl;
-				//}
-			} else {
+			std::string out;
+			appendTo(out);
+			return out;
+		}
+
+		// Appends the text toString() returns, without building a stream
+		void appendTo (std::string &out) const {
+			if (message.empty()) {
+				out += "Error(<null>): Unknown error occurred";
+				return;
+			}
+
+			char code[12];
+			const auto codeLength = static_cast<size_t>(std::to_chars(code, code + sizeof(code), statusCode).ptr - code);
+			out.reserve(out.size() + message.size() + codeLength + 9);
+			out += "Error(";
+			out.append(code, codeLength);
+			out += "): ";
+			out += message;
+		}
+
+		// Writes the text toString() returns straight to a stream
+		void writeTo (std::ostream &out) const {
+			if (message.empty()) {
 				out << "Error(<null>): Unknown error occurred";
+				return;
 			}
 
-			return out.str();
+			out << "Error(" << statusCode << "): " << message;
 		}
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,478 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "DynaVal.h"
+#include "DynaJsonReader.h"
+#include "dynaThrow.h"
+
+/**
+ * Compile-time field tables for binding plain structs to DynaVal and JSON.
+ *
+ *   struct Device {
+ *   	std::string name;
+ *   	int32_t port = 80;
+ *   	std::vector<std::string> hosts;
+ *   };
+ *   DYNA_FIELDS(Device, name, port, hosts)
+ *
+ * DYNA_FIELDS goes at namespace scope, in the struct's own namespace, and
+ * supports up to 32 fields. Field types may be bool, arithmetic types,
+ * std::string, std::vector of a supported type, DynaVal, or another
+ * struct with DYNA_FIELDS.
+ *
+ * dynaToJson() and dynaFromJson() go straight between the struct and
+ * text without building a DynaVal tree, and field names are matched
+ * against the table rather than hashed or copied.
+ *
+ * Integral fields only accept whole numbers in their range. A value of
+ * the wrong type or out of range is reported as a 422 error whose key is
+ * the dot path of the field, on both the DynaVal and the JSON path.
+ */
+#define DYNA_FIELD(Struct, member) ::Irrelon::DynaField<Struct, decltype(Struct::member)> {#member, &Struct::member}
+#define DYNA_FIELDS_EXPAND(x) x
+#define DYNA_FIELDS_1(Struct, a) DYNA_FIELD(Struct, a)
+#define DYNA_FIELDS_2(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_1(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_3(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_2(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_4(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_3(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_5(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_4(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_6(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_5(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_7(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_6(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_8(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_7(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_9(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_8(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_10(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_9(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_11(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_10(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_12(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_11(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_13(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_12(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_14(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_13(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_15(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_14(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_16(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_15(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_17(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_16(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_18(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_17(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_19(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_18(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_20(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_19(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_21(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_20(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_22(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_21(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_23(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_22(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_24(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_23(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_25(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_24(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_26(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_25(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_27(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_26(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_28(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_27(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_29(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_28(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_30(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_29(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_31(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_30(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_32(Struct, a, ...) DYNA_FIELD(Struct, a), DYNA_FIELDS_EXPAND(DYNA_FIELDS_31(Struct, __VA_ARGS__))
+#define DYNA_FIELDS_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define DYNA_FIELDS(Struct, ...) \
+	[[maybe_unused]] constexpr auto dynaFields (const Struct *) { \
+		return std::make_tuple(DYNA_FIELDS_EXPAND(DYNA_FIELDS_PICK(__VA_ARGS__, DYNA_FIELDS_32, DYNA_FIELDS_31, DYNA_FIELDS_30, DYNA_FIELDS_29, DYNA_FIELDS_28, DYNA_FIELDS_27, DYNA_FIELDS_26, DYNA_FIELDS_25, DYNA_FIELDS_24, DYNA_FIELDS_23, DYNA_FIELDS_22, DYNA_FIELDS_21, DYNA_FIELDS_20, DYNA_FIELDS_19, DYNA_FIELDS_18, DYNA_FIELDS_17, DYNA_FIELDS_16, DYNA_FIELDS_15, DYNA_FIELDS_14, DYNA_FIELDS_13, DYNA_FIELDS_12, DYNA_FIELDS_11, DYNA_FIELDS_10, DYNA_FIELDS_9, DYNA_FIELDS_8, DYNA_FIELDS_7, DYNA_FIELDS_6, DYNA_FIELDS_5, DYNA_FIELDS_4, DYNA_FIELDS_3, DYNA_FIELDS_2, DYNA_FIELDS_1)(Struct, __VA_ARGS__))); \
+	}
+
+namespace Irrelon {
+	template <typename Struct, typename Type>
+	struct DynaField {
+		std::string_view name;
+		Type Struct::*member;
+	};
+
+	namespace detail {
+		template <typename T, typename = void>
+		constexpr bool dynaHasFields = false;
+
+		template <typename T>
+		constexpr bool dynaHasFields<T, std::void_t<decltype(dynaFields(static_cast<const T *>(nullptr)))>> = true;
+
+		template <typename T>
+		constexpr bool dynaIsVector = false;
+
+		template <typename T, typename Allocator>
+		constexpr bool dynaIsVector<std::vector<T, Allocator>> = true;
+
+		template <typename T>
+		constexpr DynaValType dynaNumberType () {
+			if constexpr (std::is_floating_point_v<T>) return sizeof(T) == sizeof(float) ? DynaValType::Float : DynaValType::Double;
+			else if constexpr (sizeof(T) > 4) return DynaValType::Long;
+			else if constexpr (std::is_signed_v<T>) return DynaValType::Int;
+			else return DynaValType::UInt;
+		}
+
+		// Calls fn(field) for every entry of T's field table
+		template <typename T, typename Fn>
+		constexpr void dynaForEachField (Fn &&fn) {
+			std::apply([&fn](const auto &...field) { (fn(field), ...); }, dynaFields(static_cast<const T *>(nullptr)));
+		}
+
+		inline DynaVal dynaFieldError (const std::string &key, const std::string &message) {
+			DynaError err(message, 422);
+			err.key = key;
+			return DynaVal::error(err);
+		}
+
+		// Converts number into an arithmetic field, refusing fractions and values an integral field can't hold
+		template <typename T>
+		DynaVal dynaFieldNumber (const double number, T &value) {
+			if constexpr (std::is_integral_v<T>) {
+				// 2^digits is exactly representable, unlike the type's max
+				const double limit = std::ldexp(1.0, std::numeric_limits<T>::digits);
+				const double lowest = std::is_signed_v<T> ? -limit : 0.0;
+				if (std::trunc(number) != number) return dynaFieldError("", "expected a whole number");
+				if (number < lowest || number >= limit) return dynaFieldError("", "number out of range");
+			}
+
+			value = static_cast<T>(number);
+			return {};
+		}
+
+		// Parses the digits of a JSON integer straight into an integral field, a double can't hold every int64_t
+		template <typename T>
+		DynaVal dynaFieldInteger (const std::string_view text, T &value) {
+			T parsed{};
+			const auto result = std::from_chars(text.data(), text.data() + text.size(), parsed);
+			if (result.ec == std::errc() && result.ptr == text.data() + text.size()) {
+				value = parsed;
+				return {};
+			}
+			// from_chars refuses a sign on unsigned types, which only matters for -0
+			if (text == "-0") {
+				value = 0;
+				return {};
+			}
+			return dynaFieldError("", "number out of range");
+		}
+
+		// Prefixes the path of a nested error with the field or index it was found under
+		inline DynaVal dynaFieldErrorAt (const std::string_view at, DynaVal &&error) {
+			std::string &key = error.editError().key;
+			key = key.empty() ? std::string(at) : std::string(at) + "." + key;
+			return std::move(error);
+		}
+
+		inline void dynaJsonEscape (std::string &out, const std::string_view text) {
+			out += '"';
+			for (const char c : text) {
+				switch (c) {
+					case '"': out += "\\\""; break;
+					case '\\': out += "\\\\"; break;
+					case '\b': out += "\\b"; break;
+					case '\f': out += "\\f"; break;
+					case '\n': out += "\\n"; break;
+					case '\r': out += "\\r"; break;
+					case '\t': out += "\\t"; break;
+					default:
+						if (static_cast<unsigned char>(c) < 0x20) {
+							char escaped[8];
+							std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+							out += escaped;
+						} else {
+							out += c;
+						}
+				}
+			}
+			out += '"';
+		}
+
+		template <typename T>
+		void dynaWriteJson (std::string &out, const T &value) {
+			if constexpr (std::is_same_v<T, bool>) {
+				out += value ? "true" : "false";
+			} else if constexpr (std::is_integral_v<T>) {
+				char digits[24];
+				const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+				out.append(digits, result.ptr);
+			} else if constexpr (std::is_floating_point_v<T>) {
+				if (!std::isfinite(value)) {
+					out += "null";
+					return;
+				}
+				// Enough digits to read back the same value
+				char digits[32];
+				const int length = std::snprintf(digits, sizeof(digits), "%.*g", std::is_same_v<T, float> ? 9 : 17, static_cast<double>(value));
+				out.append(digits, static_cast<size_t>(length));
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				dynaJsonEscape(out, value);
+			} else if constexpr (std::is_same_v<T, DynaVal>) {
+				if (value.isError() && value.errorData) value.errorData->appendTo(out);
+				else out += value.toJson();
+			} else if constexpr (dynaIsVector<T>) {
+				out += '[';
+				for (size_t i = 0; i < value.size(); ++i) {
+					if (i) out += ',';
+					dynaWriteJson(out, value[i]);
+				}
+				out += ']';
+			} else {
+				static_assert(dynaHasFields<T>, "Type needs DYNA_FIELDS or is not supported as a field");
+				out += '{';
+				bool first = true;
+				dynaForEachField<T>([&](const auto &field) {
+					if (!first) out += ',';
+					first = false;
+					out += '"';
+					out += field.name;
+					out += "\":";
+					dynaWriteJson(out, value.*field.member);
+				});
+				out += '}';
+			}
+		}
+
+		// Items are appended without counting them first, which would rescan every nested container
+		inline DynaVal dynaReadJsonValue (DynaJsonReader &reader, const size_t depth = 0) {
+			const DynaValType type = reader.peekType();
+			if ((type == DynaValType::Array || type == DynaValType::Object) && depth >= DYNAVAL_JSON_MAX_DEPTH) {
+				reader.fail("nesting too deep");
+				return {};
+			}
+
+			switch (type) {
+				case DynaValType::Null:
+					reader.readNull();
+					return {};
+				case DynaValType::Bool:
+					return DynaVal(reader.readBool());
+				case DynaValType::String: {
+					std::string text;
+					reader.readString([&text](const char c) { text += c; });
+					return DynaVal(std::move(text));
+				}
+				case DynaValType::Array: {
+					DynaValArray arr;
+					reader.expect('[', "expected an array");
+					if (!reader.consume(']')) {
+						do {
+							arr.push_back(dynaReadJsonValue(reader, depth + 1));
+						} while (reader.consume(','));
+						reader.expect(']', "expected ',' or ']'");
+					}
+					return DynaVal(std::move(arr));
+				}
+				case DynaValType::Object: {
+					DynaValObject obj;
+					reader.expect('{', "expected an object");
+					if (!reader.consume('}')) {
+						do {
+							std::string key;
+							reader.readString([&key](const char c) { key += c; });
+							reader.expect(':', "expected ':'");
+							obj[std::move(key)] = dynaReadJsonValue(reader, depth + 1);
+						} while (reader.consume(','));
+						reader.expect('}', "expected ',' or '}'");
+					}
+					return DynaVal(std::move(obj));
+				}
+				default: {
+					const DynaJsonNumber number = reader.readNumber();
+					DynaVal out;
+					out.type = number.type;
+					out.number = number.value;
+					return out;
+				}
+			}
+		}
+
+		/**
+		 * Reads into value, a JSON null leaves the current value untouched.
+		 * Returns a null DynaVal, or a 422 error for a value of the wrong
+		 * type or range, after which reading stops.
+		 */
+		template <typename T>
+		DynaVal dynaReadJson (DynaJsonReader &reader, T &value, std::string &key) {
+			const DynaValType type = reader.peekType();
+
+			if constexpr (!std::is_same_v<T, DynaVal>) {
+				if (type == DynaValType::Null) {
+					reader.readNull();
+					return {};
+				}
+			}
+
+			if constexpr (std::is_same_v<T, bool>) {
+				if (type != DynaValType::Bool) return dynaFieldError("", "expected a bool");
+				value = reader.readBool();
+			} else if constexpr (std::is_arithmetic_v<T>) {
+				// Anything peekType() can't place is read as a number, so malformed input still fails as JSON
+				if (type != DynaValType::Double) return dynaFieldError("", "expected a number");
+				const size_t start = reader.position();
+				const DynaJsonNumber number = reader.readNumber();
+				if (reader.failed()) return {};
+				if constexpr (std::is_integral_v<T>) {
+					// Plain integers skip the double, so 64 bit fields keep every digit
+					const std::string_view text = reader.input().substr(start, reader.position() - start);
+					if (text.find_first_of(".eE") == std::string_view::npos) return dynaFieldInteger(text, value);
+				}
+				return dynaFieldNumber(number.value, value);
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				if (type != DynaValType::String) return dynaFieldError("", "expected a string");
+				value.clear();
+				reader.readString([&value](const char c) { value += c; });
+			} else if constexpr (std::is_same_v<T, DynaVal>) {
+				value = dynaReadJsonValue(reader);
+			} else if constexpr (dynaIsVector<T>) {
+				if (type != DynaValType::Array) return dynaFieldError("", "expected an array");
+				value.clear();
+				value.reserve(reader.countItems());
+				reader.expect('[', "expected an array");
+				if (reader.consume(']')) return {};
+				do {
+					// Read into a local so std::vector<bool> works without element references
+					typename T::value_type item{};
+					DynaVal result = dynaReadJson(reader, item, key);
+					if (result.isError()) return dynaFieldErrorAt(std::to_string(value.size()), std::move(result));
+					value.push_back(std::move(item));
+				} while (reader.consume(','));
+				reader.expect(']', "expected ',' or ']'");
+			} else {
+				static_assert(dynaHasFields<T>, "Type needs DYNA_FIELDS or is not supported as a field");
+				if (type != DynaValType::Object) return dynaFieldError("", "expected an object");
+				reader.expect('{', "expected an object");
+				if (reader.consume('}')) return {};
+				do {
+					// One key buffer is reused for the whole document
+					key.clear();
+					reader.readString([&key](const char c) { key += c; });
+					reader.expect(':', "expected ':'");
+
+					bool matched = false;
+					DynaVal result;
+					dynaForEachField<T>([&](const auto &field) {
+						if (matched || field.name != key) return;
+						matched = true;
+						result = dynaReadJson(reader, value.*field.member, key);
+						if (result.isError()) result = dynaFieldErrorAt(field.name, std::move(result));
+					});
+					if (result.isError()) return result;
+					if (!matched) reader.skipValue();
+				} while (reader.consume(','));
+				reader.expect('}', "expected ',' or '}'");
+			}
+
+			return {};
+		}
+	}
+
+	template <typename T>
+	[[nodiscard]] DynaVal toDynaVal (const T &value) {
+		if constexpr (std::is_same_v<T, bool>) {
+			return DynaVal(value);
+		} else if constexpr (std::is_arithmetic_v<T>) {
+			DynaVal out;
+			out.type = detail::dynaNumberType<T>();
+			out.number = static_cast<double>(value);
+			return out;
+		} else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, DynaVal>) {
+			return DynaVal(value);
+		} else if constexpr (detail::dynaIsVector<T>) {
+			DynaValArray arr;
+			arr.reserve(value.size());
+			for (const auto &item : value) arr.push_back(toDynaVal(item));
+			return DynaVal(std::move(arr));
+		} else {
+			static_assert(detail::dynaHasFields<T>, "Type needs DYNA_FIELDS or is not supported as a field");
+			DynaValObject obj;
+			obj.reserve(std::tuple_size_v<decltype(dynaFields(static_cast<const T *>(nullptr)))>);
+			detail::dynaForEachField<T>([&](const auto &field) {
+				obj.emplace(std::string(field.name), toDynaVal(value.*field.member));
+			});
+			return DynaVal(std::move(obj));
+		}
+	}
+
+	/**
+	 * Copies source into value. Keys missing from source leave their field
+	 * untouched and unknown keys are ignored. Returns a null DynaVal or a
+	 * 422 error whose key is the dot path of the offending field.
+	 */
+	template <typename T>
+	DynaVal fromDynaVal (const DynaVal &source, T &value) {
+		if constexpr (std::is_same_v<T, bool>) {
+			if (!source.isBool()) return detail::dynaFieldError("", "expected a bool");
+			value = source.boolean;
+		} else if constexpr (std::is_arithmetic_v<T>) {
+			if (!source.isNumber()) return detail::dynaFieldError("", "expected a number");
+			return detail::dynaFieldNumber(source.number, value);
+		} else if constexpr (std::is_same_v<T, std::string>) {
+			if (!source.isString()) return detail::dynaFieldError("", "expected a string");
+			value = source.string;
+		} else if constexpr (std::is_same_v<T, DynaVal>) {
+			value = source;
+		} else if constexpr (detail::dynaIsVector<T>) {
+			if (!source.isArray()) return detail::dynaFieldError("", "expected an array");
+			value.clear();
+			value.reserve(source.size());
+			for (size_t i = 0; i < source.size(); ++i) {
+				// Read into a local so std::vector<bool> works without element references
+				typename T::value_type item{};
+				DynaVal result = fromDynaVal((*source.array)[i], item);
+				if (result.isError()) return detail::dynaFieldErrorAt(std::to_string(i), std::move(result));
+				value.push_back(std::move(item));
+			}
+		} else {
+			static_assert(detail::dynaHasFields<T>, "Type needs DYNA_FIELDS or is not supported as a field");
+			if (!source.isObject()) return detail::dynaFieldError("", "expected an object");
+			if (!source.object) return {};
+
+			// Walks the entries once and matches names against the table, no key strings are built
+			for (const auto &[key, val] : *source.object) {
+				DynaVal result;
+				detail::dynaForEachField<T>([&](const auto &field) {
+					if (field.name != key || result.isError()) return;
+					result = fromDynaVal(val, value.*field.member);
+					if (result.isError()) result = detail::dynaFieldErrorAt(field.name, std::move(result));
+				});
+				if (result.isError()) return result;
+			}
+		}
+
+		return {};
+	}
+
+	// Serializes a bound struct (or any supported field type) straight to JSON
+	template <typename T>
+	[[nodiscard]] std::string dynaToJson (const T &value) {
+		std::string out;
+		detail::dynaWriteJson(out, value);
+		return out;
+	}
+
+	/**
+	 * Parses JSON straight into a bound struct. Returns a null DynaVal, a
+	 * 400 error for malformed JSON, or a 422 error keyed by the dot path of
+	 * a field whose value has the wrong type or range.
+	 */
+	template <typename T>
+	DynaVal dynaFromJson (const std::string_view json, T &value) {
+#ifndef DYNAVAL_NO_EXCEPTIONS
+		try {
+#endif
+			DynaJsonReader reader(json);
+			std::string key;
+			DynaVal result = detail::dynaReadJson(reader, value, key);
+			if (reader.failed()) return DynaVal::error(std::string("Invalid JSON: ") + reader.error(), 400);
+			if (result.isError()) return result;
+			if (!reader.atEnd()) {
+				static const DynaError trailingData("Invalid JSON: unexpected data after the value", 400);
+				return DynaVal::staticError(trailingData);
+			}
+#ifndef DYNAVAL_NO_EXCEPTIONS
+		} catch (const std::runtime_error &e) {
+			return DynaVal::error(e.what(), 400);
+		}
+#endif
+		return {};
+	}
+
+	// Parses JSON into a DynaVal tree, or a 400 error value if it is malformed
+	[[nodiscard]] inline DynaVal dynaFromJson (const std::string_view json) {
+		DynaVal out;
+		const DynaVal result = dynaFromJson(json, out);
+		return result.isError() ? result : out;
+	}
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	struct DynaIndexOptions {
+		// Hash index answering find() in O(1)
+		bool hashed = true;
+		// Ordered index answering range() in O(log n), also used by find() when not hashed
+		bool ordered = false;
+	};
+
+	namespace detail {
+		struct DynaIndexHash {
+			size_t operator() (const DynaVal &val) const { return val.hash(); }
+		};
+
+		struct DynaIndexEqual {
+			bool operator() (const DynaVal &a, const DynaVal &b) const { return a.equals(b); }
+		};
+
+		// Numbers sort before strings, then bools, then everything else by type
+		inline int dynaIndexRank (const DynaVal &val) {
+			if (val.isNumber()) return 0;
+			if (val.isString()) return 1;
+			if (val.isBool()) return 2;
+			return 3 + static_cast<int>(val.type);
+		}
+
+		inline bool dynaIndexIsNaN (const DynaVal &val) {
+			return val.isNumber() && val.number != val.number;
+		}
+
+		// Scalars are keys; NaN, undefined, arrays, objects and errors are never indexed
+		inline bool dynaIndexIsKey (const DynaVal &val) {
+			return !val.isUndefined() && !dynaIndexIsNaN(val) && !val.isArray() && !val.isObject() && !val.isError();
+		}
+
+		/**
+		 * NaN sorts after every other number so the order stays strict and
+		 * weak. Types from rank 3 up are only ordered against each other by
+		 * type, which is exact for null but would make every array (or
+		 * object, or error) one key; those are never indexed.
+		 */
+		struct DynaIndexLess {
+			bool operator() (const DynaVal &a, const DynaVal &b) const {
+				const int rankA = dynaIndexRank(a);
+				const int rankB = dynaIndexRank(b);
+				if (rankA != rankB) return rankA < rankB;
+				if (rankA == 0) {
+					const bool nanA = a.number != a.number;
+					const bool nanB = b.number != b.number;
+					if (nanA || nanB) return !nanA && nanB;
+					return a.number < b.number;
+				}
+				if (rankA == 1) return a.string < b.string;
+				if (rankA == 2) return a.boolean < b.boolean;
+				return false;
+			}
+		};
+	}
+
+	/**
+	 * A secondary index over an array of objects, keyed by the value at a
+	 * dot separated field path in each record ("mac", "meta.topic").
+	 *
+	 *   Irrelon::DynaIndex byMac(devices, "mac");
+	 *   const Irrelon::DynaVal *device = byMac.find("aa:bb:cc:dd:ee:ff");
+	 *
+	 * The index holds a handle that shares the array's storage. Records
+	 * pushed, removed or updated through the index keep it current; after
+	 * changing the array any other way, call rebuild(). Until then an
+	 * index whose array changed size is stale and its lookups find
+	 * nothing, and a position is never returned past the end of the
+	 * array. Records without
+	 * the field, or whose field is NaN, an array, an object or an error,
+	 * are not indexed, and looking one of those up finds nothing. Lookups
+	 * return positions in the array, or a pointer to the record for find().
+	 *
+	 * remove() renumbers the positions after the removed record, which is
+	 * O(n) just like the erase in the array itself.
+	 */
+	class DynaIndex {
+	public:
+		DynaIndex (DynaVal records, const std::string &fieldPath, const DynaIndexOptions options = {})
+			: _records(std::move(records)), _options(options) {
+			if (!_records.isArray()) detail::dynaThrow("DynaIndex requires an array of records");
+			if (!_options.hashed && !_options.ordered) detail::dynaThrow("DynaIndex needs a hashed or ordered index");
+
+			size_t start = 0;
+			while (true) {
+				const size_t dot = fieldPath.find('.', start);
+				_path.push_back(fieldPath.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+				if (dot == std::string::npos) break;
+				start = dot + 1;
+			}
+
+			rebuild();
+		}
+
+		// Re-reads every record, for when the array was changed without going through the index
+		void rebuild () {
+			_hashed.clear();
+			_ordered.clear();
+			_size = _records.array ? _records.array->size() : 0;
+			if (!_records.array) return;
+
+			if (_options.hashed) _hashed.reserve(_records.array->size());
+			for (size_t i = 0; i < _records.array->size(); ++i) _add(i);
+		}
+
+		// The indexed array, sharing storage with the DynaVal the index was built from
+		[[nodiscard]] const DynaVal &records () const { return _records; }
+
+		[[nodiscard]] size_t size () const { return _records.size(); }
+
+		// True when the array changed size without going through the index, until rebuild()
+		[[nodiscard]] bool isStale () const {
+			return (_records.array ? _records.array->size() : 0) != _size;
+		}
+
+		// Appends a record and indexes it, returns its position
+		size_t push (const DynaVal &record) {
+			const bool stale = isStale();
+			_records.push(record);
+			const size_t position = _records.array->size() - 1;
+			if (!stale) _size = _records.array->size();
+			_add(position);
+			return position;
+		}
+
+		void remove (const size_t position) {
+			if (!_records.array || position >= _records.array->size()) return;
+			_records.ensureMutable();
+			const bool stale = isStale();
+			_drop(position);
+			_records.remove(position);
+			if (!stale) _size = _records.array->size();
+
+			for (auto &[key, at] : _hashed) {
+				if (at > position) --at;
+			}
+			for (auto &[key, at] : _ordered) {
+				if (at > position) --at;
+			}
+		}
+
+		/**
+		 * Calls fn with the record at position and reindexes it afterwards,
+		 * so fn may change the indexed field or replace the record.
+		 */
+		void update (const size_t position, const std::function<void(DynaVal &)> &fn) {
+			if (!_records.array || position >= _records.array->size()) {
+				detail::dynaThrow("DynaIndex::update() position out of range");
+			}
+
+			_drop(position);
+#ifdef DYNAVAL_NO_EXCEPTIONS
+			fn((*_records.array)[position]);
+#else
+			try {
+				fn((*_records.array)[position]);
+			} catch (...) {
+				_add(position);
+				throw;
+			}
+#endif
+			_add(position);
+		}
+
+		// Sets the value at a dot separated field path inside the record at position
+		void set (const size_t position, const std::string &fieldPath, const DynaVal &value) {
+			update(position, [&fieldPath, &value](DynaVal &record) {
+				DynaVal *current = &record;
+				size_t start = 0;
+				size_t dot;
+				while ((dot = fieldPath.find('.', start)) != std::string::npos) {
+					current = &(*current)[fieldPath.substr(start, dot - start)];
+					start = dot + 1;
+				}
+				(*current)[fieldPath.substr(start)] = value;
+			});
+		}
+
+		// The record at the lowest position whose field equals key, or nullptr
+		[[nodiscard]] const DynaVal *find (const DynaVal &key) const {
+			if (!detail::dynaIndexIsKey(key) || !_current()) return nullptr;
+			const size_t position = _options.hashed ? _first(_hashed, key) : _first(_ordered, key);
+			if (position >= _records.array->size()) return nullptr;
+			return &(*_records.array)[position];
+		}
+
+		// Positions of every record whose field equals key, in ascending order
+		[[nodiscard]] std::vector<size_t> findAll (const DynaVal &key) const {
+			std::vector<size_t> positions;
+			if (!detail::dynaIndexIsKey(key) || !_current()) return positions;
+			const size_t limit = _records.array->size();
+			if (_options.hashed) {
+				const auto [begin, end] = _hashed.equal_range(key);
+				for (auto it = begin; it != end; ++it) {
+					if (it->second < limit) positions.push_back(it->second);
+				}
+			} else {
+				const auto [begin, end] = _ordered.equal_range(key);
+				for (auto it = begin; it != end; ++it) {
+					if (it->second < limit) positions.push_back(it->second);
+				}
+			}
+			std::sort(positions.begin(), positions.end());
+			return positions;
+		}
+
+		[[nodiscard]] size_t count (const DynaVal &key) const {
+			if (!detail::dynaIndexIsKey(key) || !_current()) return 0;
+			return _options.hashed ? _hashed.count(key) : _ordered.count(key);
+		}
+
+		/**
+		 * Positions of the records whose field lies in [lo, hi], ordered by
+		 * field value. Numbers and strings each compare by value, and a
+		 * number never falls in a string range or the other way around. A
+		 * bound that cannot be a key (NaN, a container) matches nothing.
+		 * Needs the ordered index.
+		 */
+		[[nodiscard]] std::vector<size_t> range (const DynaVal &lo, const DynaVal &hi) const {
+			if (!_options.ordered) detail::dynaThrow("DynaIndex::range() requires an ordered index");
+
+			std::vector<size_t> positions;
+			if (!detail::dynaIndexIsKey(lo) || !detail::dynaIndexIsKey(hi) || detail::DynaIndexLess{}(hi, lo) || !_current()) return positions;
+			const size_t limit = _records.array->size();
+			const auto end = _ordered.upper_bound(hi);
+			for (auto it = _ordered.lower_bound(lo); it != end; ++it) {
+				if (it->second < limit) positions.push_back(it->second);
+			}
+			return positions;
+		}
+
+	private:
+		DynaVal _records;
+		DynaIndexOptions _options;
+		std::vector<std::string> _path;
+		// Array size at the last rebuild() or change through the index
+		size_t _size = 0;
+		std::unordered_multimap<DynaVal, size_t, detail::DynaIndexHash, detail::DynaIndexEqual> _hashed;
+		std::multimap<DynaVal, size_t, detail::DynaIndexLess> _ordered;
+
+		// True when there is storage to read and the entries still match its size
+		[[nodiscard]] bool _current () const {
+			return _records.array && !isStale();
+		}
+
+		// The indexed field of a record, or nullptr when the record does not have it
+		[[nodiscard]] const DynaVal *_key (const size_t position) const {
+			const DynaVal *current = &(*_records.array)[position];
+			for (const auto &segment : _path) {
+				if (!current->isObject() || !current->object) return nullptr;
+				const auto it = current->object->find(segment);
+				if (it == current->object->end()) return nullptr;
+				current = &it->second;
+			}
+			return detail::dynaIndexIsKey(*current) ? current : nullptr;
+		}
+
+		// The lowest position stored under key, or SIZE_MAX
+		template <typename Map>
+		static size_t _first (const Map &map, const DynaVal &key) {
+			size_t position = SIZE_MAX;
+			const auto [begin, end] = map.equal_range(key);
+			for (auto it = begin; it != end; ++it) position = std::min(position, it->second);
+			return position;
+		}
+
+		void _add (const size_t position) {
+			const DynaVal *key = _key(position);
+			if (!key) return;
+			if (_options.hashed) _hashed.emplace(*key, position);
+			if (_options.ordered) _ordered.emplace(*key, position);
+		}
+
+		void _drop (const size_t position) {
+			const DynaVal *key = _key(position);
+			if (!key) return;
+
+			if (_options.hashed) {
+				const auto [begin, end] = _hashed.equal_range(*key);
+				for (auto it = begin; it != end; ++it) {
+					if (it->second == position) {
+						_hashed.erase(it);
+						break;
+					}
+				}
+			}
+
+			if (_options.ordered) {
+				const auto [begin, end] = _ordered.equal_range(*key);
+				for (auto it = begin; it != end; ++it) {
+					if (it->second == position) {
+						_ordered.erase(it);
+						break;
+					}
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,467 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+#include "DynaCbor.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Append-only persistence for a DynaVal tree.
+ *
+ * Mutations are applied in memory and appended to <path>.log as small
+ * binary entries instead of rewriting the whole tree. Once the log grows
+ * past a threshold it is compacted: the full state is written to
+ * <path>.snap and the log starts over. Opening replays snapshot + log.
+ *
+ *   Snapshot  "DYNS", u8 version, 3 reserved, u64 generation, u32 length, CBOR state, u32 CRC-32
+ *   Log       "DYNJ", u8 version, 3 reserved, u64 generation, then entries:
+ *   Entry     u8 op, u32 length, CBOR [pointer, value], u32 CRC-32 of op, length and payload
+ *
+ * All integers are little-endian. A log whose generation does not match
+ * the snapshot was superseded by a compaction and is ignored, and replay
+ * stops at the first torn or corrupt entry.
+ *
+ * If an entry cannot be appended or synced, the log is closed and cut
+ * back to its last synced entry, and the journal refuses further changes. Call
+ * open() to reload the durable state, or compact() to persist the state
+ * in memory.
+ */
+namespace Irrelon {
+	struct DynaJournalOptions {
+		// fsync after this many appended entries, 0 syncs only on sync(), compact() and close
+		size_t syncEvery = 1;
+		// Compact once the log grows past this many bytes, 0 compacts only on compact()
+		size_t compactAfterBytes = 64 * 1024;
+	};
+
+	namespace detail {
+		enum class DynaJournalOp : uint8_t {
+			Set = 1,
+			Push = 2,
+			Remove = 3
+		};
+
+		constexpr uint8_t kDynaJournalVersion = 1;
+		constexpr size_t kDynaJournalHeaderSize = 16;
+
+		inline uint32_t dynaCrc32 (const uint8_t *data, const size_t length, uint32_t crc = 0) {
+			static const auto table = [] {
+				std::vector<uint32_t> out(256);
+				for (uint32_t i = 0; i < 256; ++i) {
+					uint32_t c = i;
+					for (int k = 0; k < 8; ++k) c = c & 1 ? 0xedb88320U ^ (c >> 1) : c >> 1;
+					out[i] = c;
+				}
+				return out;
+			}();
+
+			crc = ~crc;
+			for (size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+			return ~crc;
+		}
+
+		inline void dynaJournalU32 (std::vector<uint8_t> &out, const uint32_t value) {
+			for (int shift = 0; shift < 32; shift += 8) out.push_back(static_cast<uint8_t>(value >> shift));
+		}
+
+		inline uint64_t dynaJournalReadLe (const uint8_t *p, const int bytes) {
+			uint64_t value = 0;
+			for (int i = bytes - 1; i >= 0; --i) value = value << 8 | p[i];
+			return value;
+		}
+
+		inline void dynaJournalHeader (std::vector<uint8_t> &out, const char *magic, const uint64_t generation) {
+			out.insert(out.end(), magic, magic + 4);
+			out.push_back(kDynaJournalVersion);
+			out.insert(out.end(), 3, 0);
+			for (int shift = 0; shift < 64; shift += 8) out.push_back(static_cast<uint8_t>(generation >> shift));
+		}
+
+		inline bool dynaJournalCheckHeader (const std::vector<uint8_t> &data, const char *magic, uint64_t &generation) {
+			if (data.size() < kDynaJournalHeaderSize) return false;
+			if (!std::equal(magic, magic + 4, data.begin()) || data[4] != kDynaJournalVersion) return false;
+			generation = dynaJournalReadLe(data.data() + 8, 8);
+			return true;
+		}
+
+		inline bool dynaJournalReadFile (const std::string &path, std::vector<uint8_t> &out) {
+			FILE *file = std::fopen(path.c_str(), "rb");
+			if (!file) return false;
+
+			out.clear();
+			uint8_t buffer[512];
+			size_t read;
+			while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) out.insert(out.end(), buffer, buffer + read);
+			std::fclose(file);
+			return true;
+		}
+
+		inline bool dynaJournalFlush (FILE *file) {
+			if (std::fflush(file) != 0) return false;
+#if defined(_WIN32)
+			return _commit(_fileno(file)) == 0;
+#else
+			return fsync(fileno(file)) == 0;
+#endif
+		}
+
+		// Cuts the file at path back to size bytes
+		inline bool dynaJournalTruncate (const std::string &path, const size_t size) {
+#if defined(_WIN32)
+			FILE *file = std::fopen(path.c_str(), "r+b");
+			if (!file) return false;
+			const bool ok = _chsize_s(_fileno(file), static_cast<long long>(size)) == 0;
+			std::fclose(file);
+			return ok;
+#else
+			return truncate(path.c_str(), static_cast<off_t>(size)) == 0;
+#endif
+		}
+
+		/**
+		 * Makes a rename in the directory holding path durable. Filesystems
+		 * that cannot open or sync a directory (Windows, most embedded VFS
+		 * layers) commit renames on their own and are skipped.
+		 */
+		inline bool dynaJournalSyncDirectory (const std::string &path) {
+#if defined(_WIN32)
+			return true;
+#else
+			const size_t slash = path.find_last_of('/');
+			const std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+			const int fd = ::open(directory.c_str(), O_RDONLY);
+			if (fd < 0) return true;
+			const bool ok = fsync(fd) == 0 || errno == EINVAL || errno == ENOTSUP;
+			::close(fd);
+			return ok;
+#endif
+		}
+
+		// Resolves tokens from root, creating objects and growing arrays like the non-const operator[]
+		inline DynaVal &dynaJournalVivify (DynaVal &root, const std::vector<std::string> &tokens) {
+			DynaVal *current = &root;
+			size_t index;
+
+			for (const auto &token : tokens) {
+				if (current->isArray() && dynaPointerIndex(token, index)) current = &(*current)[index];
+				else current = &(*current)[token];
+			}
+
+			return *current;
+		}
+
+		inline DynaVal dynaJournalApply (DynaVal &root, const DynaJournalOp op, const std::vector<std::string> &tokens, DynaVal &&value) {
+			switch (op) {
+				case DynaJournalOp::Set:
+					dynaJournalVivify(root, tokens) = std::move(value);
+					return {};
+				case DynaJournalOp::Push:
+					dynaJournalVivify(root, tokens).push(std::move(value));
+					return {};
+				case DynaJournalOp::Remove: {
+					DynaVal removed;
+					if (tokens.empty() || dynaPatchTake(root, tokens, removed) != DynaPatchStep::Applied) {
+						static const DynaError notFound("Journal path not found", 404);
+						return DynaVal::staticError(notFound);
+					}
+					return {};
+				}
+			}
+
+			static const DynaError unknownOp("Unknown journal operation", 400);
+			return DynaVal::staticError(unknownOp);
+		}
+
+		inline DynaVal dynaJournalNotOpen () {
+			static const DynaError notOpen("Journal is not open", 409);
+			return DynaVal::staticError(notOpen);
+		}
+
+		inline DynaVal dynaJournalFailed () {
+			static const DynaError failed("Journal log write failed, call open() or compact() first", 409);
+			return DynaVal::staticError(failed);
+		}
+	}
+
+	/**
+	 * Owns a DynaVal tree and persists every change made through it. Read
+	 * the tree with state() and mutate it only through set(), push() and
+	 * remove(), which take JSON Pointer paths ("/sensors/3/value"). Values
+	 * are deep copied in, so later changes to the caller's copy are not
+	 * silently left out of the log.
+	 *
+	 * Every call returns a null DynaVal on success or an error value.
+	 * Not thread safe; guard with a mutex if shared between threads.
+	 */
+	class DynaJournal {
+	public:
+		explicit DynaJournal (std::string path, const DynaJournalOptions options = {})
+			: _path(std::move(path)), _options(options) {}
+
+		DynaJournal (const DynaJournal &) = delete;
+		DynaJournal &operator= (const DynaJournal &) = delete;
+
+		~DynaJournal () {
+			close();
+		}
+
+		/**
+		 * Loads the snapshot, replays the log on top of it and opens the log
+		 * for appending. A missing snapshot starts from a null tree. If the
+		 * log was stale or had a torn tail it is compacted away immediately.
+		 */
+		DynaVal open () {
+			close();
+			_state = DynaVal();
+			_generation = 0;
+			_failed = false;
+
+			// The temporary only outlives a compaction on filesystems that could not rename over the snapshot
+			std::vector<uint8_t> data;
+			if (!_loadSnapshot(_path + ".snap", data)) _loadSnapshot(_path + ".snap.tmp", data);
+
+			bool clean = false;
+			uint64_t logGeneration = 0;
+			if (detail::dynaJournalReadFile(_path + ".log", data) && detail::dynaJournalCheckHeader(data, "DYNJ", logGeneration) &&
+				logGeneration == _generation) {
+				clean = _replay(data);
+				_logBytes = data.size();
+				_syncedBytes = _logBytes;
+			}
+
+			if (!clean) return compact();
+
+			_log = std::fopen((_path + ".log").c_str(), "ab");
+			if (!_log) return DynaVal::error("Cannot open journal log " + _path + ".log", 500);
+			return {};
+		}
+
+		// Flushes pending entries to storage and closes the log
+		void close () {
+			if (!_log) return;
+			if (detail::dynaJournalFlush(_log)) _syncedBytes = _logBytes;
+			std::fclose(_log);
+			_log = nullptr;
+			_unsynced = 0;
+		}
+
+		[[nodiscard]] bool isOpen () const { return _log != nullptr; }
+
+		// True after an append or sync failed, until open() or compact() succeeds
+		[[nodiscard]] bool hasFailed () const { return _failed; }
+
+		[[nodiscard]] const DynaVal &state () const { return _state; }
+
+		// Sets (or inserts) the value at pointer, creating intermediate objects
+		DynaVal set (const std::string &pointer, const DynaVal &value) {
+			return _mutate(detail::DynaJournalOp::Set, pointer, &value);
+		}
+
+		// Appends value to the array at pointer, creating it if needed
+		DynaVal push (const std::string &pointer, const DynaVal &value) {
+			return _mutate(detail::DynaJournalOp::Push, pointer, &value);
+		}
+
+		// Removes the object key or array element at pointer
+		DynaVal remove (const std::string &pointer) {
+			return _mutate(detail::DynaJournalOp::Remove, pointer, nullptr);
+		}
+
+		// Forces appended entries to storage regardless of syncEvery
+		DynaVal sync () {
+			if (_failed) return detail::dynaJournalFailed();
+			if (!_log) return detail::dynaJournalNotOpen();
+			if (!detail::dynaJournalFlush(_log)) return _fail("Cannot sync journal log");
+			_unsynced = 0;
+			_syncedBytes = _logBytes;
+			return {};
+		}
+
+		/**
+		 * Writes the whole state to a new snapshot under the next generation
+		 * and starts an empty log. The snapshot is written to a temporary
+		 * file and renamed into place, and the old log is only discarded
+		 * after that, so a crash at any point leaves a recoverable pair. A
+		 * successful compaction clears a failed append, since the snapshot
+		 * holds the state in memory.
+		 */
+		DynaVal compact () {
+			if (_log) {
+				std::fclose(_log);
+				_log = nullptr;
+			}
+
+			const uint64_t next = _generation + 1;
+			std::vector<uint8_t> out;
+			detail::dynaJournalHeader(out, "DYNS", next);
+			detail::dynaJournalU32(out, 0);
+			const size_t start = out.size();
+			dynaToCbor(_state, out);
+			const auto length = static_cast<uint32_t>(out.size() - start);
+			for (int i = 0; i < 4; ++i) out[start - 4 + i] = static_cast<uint8_t>(length >> (i * 8));
+			detail::dynaJournalU32(out, detail::dynaCrc32(out.data() + start, length));
+
+			const std::string snapshot = _path + ".snap";
+			const std::string temporary = snapshot + ".tmp";
+			if (!_writeFile(temporary, out)) return DynaVal::error("Cannot write journal snapshot " + temporary, 500);
+			if (std::rename(temporary.c_str(), snapshot.c_str()) != 0) {
+				// Some filesystems will not rename over an existing file, open() falls back to the temporary
+				std::remove(snapshot.c_str());
+				if (std::rename(temporary.c_str(), snapshot.c_str()) != 0) {
+					return DynaVal::error("Cannot replace journal snapshot " + snapshot, 500);
+				}
+			}
+			if (!detail::dynaJournalSyncDirectory(snapshot)) return DynaVal::error("Cannot sync journal directory", 500);
+
+			_generation = next;
+			out.clear();
+			detail::dynaJournalHeader(out, "DYNJ", _generation);
+			if (!_writeFile(_path + ".log", out)) return DynaVal::error("Cannot reset journal log", 500);
+
+			_logBytes = out.size();
+			_syncedBytes = _logBytes;
+			_unsynced = 0;
+			_log = std::fopen((_path + ".log").c_str(), "ab");
+			if (!_log) return DynaVal::error("Cannot open journal log " + _path + ".log", 500);
+			_failed = false;
+			return {};
+		}
+
+		// Current log size in bytes, including the header
+		[[nodiscard]] size_t logBytes () const { return _logBytes; }
+
+		// Total bytes written to storage since construction, for measuring write amplification
+		[[nodiscard]] uint64_t bytesWritten () const { return _bytesWritten; }
+
+		// Incremented by every compaction
+		[[nodiscard]] uint64_t generation () const { return _generation; }
+
+	private:
+		std::string _path;
+		DynaJournalOptions _options;
+		DynaVal _state;
+		FILE *_log = nullptr;
+		uint64_t _generation = 0;
+		size_t _logBytes = 0;
+		// Log size as of the last successful sync, where a failed append cuts back to
+		size_t _syncedBytes = 0;
+		size_t _unsynced = 0;
+		uint64_t _bytesWritten = 0;
+		bool _failed = false;
+		std::vector<uint8_t> _entry;
+		std::vector<std::string> _tokens;
+
+		DynaVal _mutate (const detail::DynaJournalOp op, const std::string &pointer, const DynaVal *value) {
+			if (_failed) return detail::dynaJournalFailed();
+			if (!_log) return detail::dynaJournalNotOpen();
+			if (!detail::dynaPointerParse(pointer, _tokens)) return DynaVal::error("Invalid journal path " + pointer, 400);
+
+			DynaVal payload;
+			payload.push(pointer);
+			if (value) payload.push(value->deepCopy());
+
+			_entry.clear();
+			_entry.push_back(static_cast<uint8_t>(op));
+			detail::dynaJournalU32(_entry, 0);
+			dynaToCbor(payload, _entry);
+			const auto length = static_cast<uint32_t>(_entry.size() - 5);
+			for (int i = 0; i < 4; ++i) _entry[1 + i] = static_cast<uint8_t>(length >> (i * 8));
+			detail::dynaJournalU32(_entry, detail::dynaCrc32(_entry.data(), _entry.size()));
+
+			// Apply first so a failing operation (such as removing a missing key) is never logged
+			DynaVal result = detail::dynaJournalApply(_state, op, _tokens, value ? std::move(payload[1]) : DynaVal());
+			if (result.isError()) return result;
+
+			if (std::fwrite(_entry.data(), 1, _entry.size(), _log) != _entry.size()) {
+				return _fail("Cannot append to journal log");
+			}
+			_logBytes += _entry.size();
+			_bytesWritten += _entry.size();
+
+			if (_options.syncEvery && ++_unsynced >= _options.syncEvery) {
+				result = sync();
+				if (result.isError()) return result;
+			}
+
+			if (_options.compactAfterBytes && _logBytes > _options.compactAfterBytes) return compact();
+			return {};
+		}
+
+		/**
+		 * Closes the log and cuts it back to the last entry known to be
+		 * whole, so a partly written entry can't hide later appends from
+		 * replay. Unsynced entries are dropped with it, as their bytes may
+		 * be torn too.
+		 */
+		DynaVal _fail (const char *message) {
+			std::fclose(_log);
+			_log = nullptr;
+			_logBytes = _syncedBytes;
+			_unsynced = 0;
+			detail::dynaJournalTruncate(_path + ".log", _logBytes);
+			_failed = true;
+			return DynaVal::error(message, 500);
+		}
+
+		bool _loadSnapshot (const std::string &file, std::vector<uint8_t> &data) {
+			uint64_t generation;
+			if (!detail::dynaJournalReadFile(file, data) || !detail::dynaJournalCheckHeader(data, "DYNS", generation)) return false;
+			if (data.size() < detail::kDynaJournalHeaderSize + 8) return false;
+
+			const uint8_t *body = data.data() + detail::kDynaJournalHeaderSize;
+			const auto length = static_cast<size_t>(detail::dynaJournalReadLe(body, 4));
+			if (data.size() < detail::kDynaJournalHeaderSize + 8 + length) return false;
+			if (detail::dynaJournalReadLe(body + 4 + length, 4) != detail::dynaCrc32(body + 4, length)) return false;
+
+			DynaVal state = dynaFromCbor(body + 4, length);
+			if (state.isError()) return false;
+
+			_state = std::move(state);
+			_generation = generation;
+			return true;
+		}
+
+		// Applies every intact entry, returns false if the log ended in a torn or corrupt entry
+		bool _replay (const std::vector<uint8_t> &data) {
+			size_t at = detail::kDynaJournalHeaderSize;
+
+			while (at < data.size()) {
+				if (data.size() - at < 9) return false;
+				const auto length = static_cast<size_t>(detail::dynaJournalReadLe(data.data() + at + 1, 4));
+				if (data.size() - at - 9 < length) return false;
+				if (detail::dynaJournalReadLe(data.data() + at + 5 + length, 4) != detail::dynaCrc32(data.data() + at, 5 + length)) {
+					return false;
+				}
+
+				DynaVal payload = dynaFromCbor(data.data() + at + 5, length);
+				if (!payload.isArray() || !payload[0].isString() || !detail::dynaPointerParse(payload[0].string, _tokens)) return false;
+
+				const auto op = static_cast<detail::DynaJournalOp>(data[at]);
+				detail::dynaJournalApply(_state, op, _tokens, payload.size() > 1 ? std::move(payload[1]) : DynaVal());
+				at += 9 + length;
+			}
+
+			return true;
+		}
+
+		bool _writeFile (const std::string &file, const std::vector<uint8_t> &data) {
+			FILE *out = std::fopen(file.c_str(), "wb");
+			if (!out) return false;
+			const bool ok = std::fwrite(data.data(), 1, data.size(), out) == data.size() && detail::dynaJournalFlush(out);
+			std::fclose(out);
+			if (ok) _bytesWritten += data.size();
+			return ok;
+		}
+	};
+}
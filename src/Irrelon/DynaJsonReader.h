@@ -0,0 +1,441 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "DynaValType.h"
+#include "dynaThrow.h"
+
+// Deepest nesting of arrays and objects the readers follow before rejecting the input
+#ifndef DYNAVAL_JSON_MAX_DEPTH
+#define DYNAVAL_JSON_MAX_DEPTH 256
+#endif
+
+namespace Irrelon {
+	namespace detail {
+		/**
+		 * Not constexpr on purpose: reaching it during constant evaluation
+		 * turns malformed JSON into a compile error that names the reason,
+		 * and at runtime it throws (or calls DYNAVAL_FATAL without
+		 * exceptions).
+		 */
+		inline void dynaJsonInvalid (const char *reason) {
+			detail::dynaThrow(std::string("Invalid JSON: ") + reason);
+		}
+
+		/**
+		 * value * 10^exponent in steps of at most 10^22, usable in constant
+		 * evaluation. A single step (|exponent| <= 22) rounds once; results
+		 * past the double range come back as infinity without overflowing.
+		 */
+		constexpr double dynaScalePow10 (double value, int exponent) {
+			constexpr double exact[] = {
+				1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+				1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+			};
+			constexpr double largest = std::numeric_limits<double>::max();
+
+			while (exponent < 0 && value != 0) {
+				const int step = exponent < -22 ? 22 : -exponent;
+				value /= exact[step];
+				exponent += step;
+			}
+			while (exponent > 0) {
+				const int step = exponent > 22 ? 22 : exponent;
+				if (value > largest / exact[step]) return std::numeric_limits<double>::infinity();
+				value *= exact[step];
+				exponent -= step;
+			}
+			return value;
+		}
+	}
+
+	struct DynaJsonNumber {
+		DynaValType type = DynaValType::Int;
+		double value = 0;
+	};
+
+	/**
+	 * Forward-only JSON tokenizer over a string_view, usable in constant
+	 * expressions. It does not build anything itself; callers drive it and
+	 * decide where values go. Integers that fit in 32 bits read as Int,
+	 * larger integers as Long and anything with a fraction or exponent as
+	 * Double.
+	 *
+	 * Malformed input throws. Under DYNAVAL_NO_EXCEPTIONS the reader
+	 * records the first reason instead and jumps to the end of the input,
+	 * so every later read fails fast; callers check failed() when done.
+	 */
+	class DynaJsonReader {
+	public:
+		constexpr explicit DynaJsonReader (const std::string_view json) : _json(json) {}
+
+		[[nodiscard]] constexpr size_t position () const { return _pos; }
+
+		// The whole input, for re-reading a token between two position()s
+		[[nodiscard]] constexpr std::string_view input () const { return _json; }
+
+		// True once malformed input was seen, only ever set with exceptions disabled
+		[[nodiscard]] constexpr bool failed () const { return _error != nullptr; }
+
+		// Why the input was rejected, null until it fails
+		[[nodiscard]] constexpr const char *error () const { return _error; }
+
+		[[nodiscard]] constexpr bool atEnd () {
+			skipWhitespace();
+			return _pos >= _json.size();
+		}
+
+		constexpr void skipWhitespace () {
+			while (_pos < _json.size() &&
+				(_json[_pos] == ' ' || _json[_pos] == '\t' || _json[_pos] == '\n' || _json[_pos] == '\r')) {
+				++_pos;
+			}
+		}
+
+		// Next significant character without consuming it, 0 at the end of input
+		[[nodiscard]] constexpr char peek () {
+			skipWhitespace();
+			return _pos < _json.size() ? _json[_pos] : '\0';
+		}
+
+		// Consumes c if it is the next significant character
+		constexpr bool consume (const char c) {
+			if (peek() != c) return false;
+			++_pos;
+			return true;
+		}
+
+		constexpr void expect (const char c, const char *reason) {
+			if (!consume(c)) _invalid(reason);
+		}
+
+		// The type of the next value, judged from its first character
+		[[nodiscard]] constexpr DynaValType peekType () {
+			switch (peek()) {
+				case '{': return DynaValType::Object;
+				case '[': return DynaValType::Array;
+				case '"': return DynaValType::String;
+				case 't':
+				case 'f': return DynaValType::Bool;
+				case 'n': return DynaValType::Null;
+				default: return DynaValType::Double;
+			}
+		}
+
+		/**
+		 * Reads a string value and hands each unescaped byte to sink, with
+		 * \u escapes (including surrogate pairs) written out as UTF-8.
+		 */
+		template <typename Sink>
+		constexpr void readString (Sink &&sink) {
+			expect('"', "expected a string");
+
+			while (true) {
+				if (_pos >= _json.size()) return _invalid("unterminated string");
+				const char c = _json[_pos++];
+				if (c == '"') return;
+				if (static_cast<unsigned char>(c) < 0x20) return _invalid("control character in string");
+				if (c != '\\') {
+					sink(c);
+					continue;
+				}
+
+				if (_pos >= _json.size()) return _invalid("unterminated escape");
+				switch (_json[_pos++]) {
+					case '"': sink('"'); break;
+					case '\\': sink('\\'); break;
+					case '/': sink('/'); break;
+					case 'b': sink('\b'); break;
+					case 'f': sink('\f'); break;
+					case 'n': sink('\n'); break;
+					case 'r': sink('\r'); break;
+					case 't': sink('\t'); break;
+					case 'u': {
+						uint32_t code = _readHex4();
+						if (code >= 0xd800 && code < 0xdc00) {
+							if (_pos + 1 >= _json.size() || _json[_pos] != '\\' || _json[_pos + 1] != 'u') {
+								return _invalid("unpaired surrogate");
+							}
+							_pos += 2;
+							const uint32_t low = _readHex4();
+							if (low < 0xdc00 || low > 0xdfff) return _invalid("unpaired surrogate");
+							code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+						}
+						_writeUtf8(code, sink);
+						break;
+					}
+					default:
+						return _invalid("unknown escape");
+				}
+			}
+		}
+
+		/**
+		 * Reads a string without copying it when it has no escapes, setting
+		 * out to its bytes inside the input. Returns false with only the
+		 * leading whitespace consumed when the next value is not a string or
+		 * has escapes, so the caller can fall back to readString().
+		 */
+		constexpr bool readStringView (std::string_view &out) {
+			if (peek() != '"') return false;
+
+			for (size_t end = _pos + 1; end < _json.size(); ++end) {
+				const char c = _json[end];
+				if (c == '\\' || static_cast<unsigned char>(c) < 0x20) return false;
+				if (c == '"') {
+					out = _json.substr(_pos + 1, end - _pos - 1);
+					_pos = end + 1;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		constexpr DynaJsonNumber readNumber () {
+			skipWhitespace();
+			const bool negative = _pos < _json.size() && _json[_pos] == '-';
+			if (negative) ++_pos;
+			const size_t start = _pos;
+			if (_pos >= _json.size() || !_isDigit(_json[_pos])) {
+				_invalid("expected a value");
+				return {};
+			}
+			if (_json[_pos] == '0' && _pos + 1 < _json.size() && _isDigit(_json[_pos + 1])) {
+				_invalid("leading zero");
+				return {};
+			}
+
+			// Keeps 19 significant digits, the rest only move the decimal exponent
+			uint64_t mantissa = 0;
+			int digits = 0;
+			int exponent = 0;
+			bool integral = true;
+
+			for (; _pos < _json.size() && _isDigit(_json[_pos]); ++_pos) {
+				if (digits < 19) {
+					mantissa = mantissa * 10 + static_cast<uint64_t>(_json[_pos] - '0');
+					if (mantissa) ++digits;
+				} else {
+					++exponent;
+				}
+			}
+
+			if (_pos < _json.size() && _json[_pos] == '.') {
+				integral = false;
+				++_pos;
+				if (_pos >= _json.size() || !_isDigit(_json[_pos])) {
+					_invalid("expected a digit");
+					return {};
+				}
+				for (; _pos < _json.size() && _isDigit(_json[_pos]); ++_pos) {
+					if (digits < 19) {
+						mantissa = mantissa * 10 + static_cast<uint64_t>(_json[_pos] - '0');
+						if (mantissa) ++digits;
+						--exponent;
+					}
+				}
+			}
+
+			if (_pos < _json.size() && (_json[_pos] == 'e' || _json[_pos] == 'E')) {
+				integral = false;
+				++_pos;
+				bool negativeExponent = false;
+				if (_pos < _json.size() && (_json[_pos] == '+' || _json[_pos] == '-')) negativeExponent = _json[_pos++] == '-';
+				if (_pos >= _json.size() || !_isDigit(_json[_pos])) {
+					_invalid("expected a digit");
+					return {};
+				}
+				int explicitExponent = 0;
+				for (; _pos < _json.size() && _isDigit(_json[_pos]); ++_pos) {
+					if (explicitExponent < 10000) explicitExponent = explicitExponent * 10 + (_json[_pos] - '0');
+				}
+				exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			}
+
+			DynaJsonNumber out;
+			double value = 0;
+			if (!mantissa) {
+				// Zero stays zero whatever the exponent, instead of 0 * inf
+			} else if (exponent == 0 || (digits <= 15 && exponent >= -22 && exponent <= 22) || std::is_constant_evaluated()) {
+				// Correctly rounded while both operands are exact; past that only constant evaluation comes here and may be an ulp off
+				value = detail::dynaScalePow10(static_cast<double>(mantissa), exponent);
+			} else {
+				value = _parseDouble(start, _pos, exponent);
+			}
+			if (value > std::numeric_limits<double>::max()) {
+				_invalid("number out of range");
+				return {};
+			}
+			out.value = negative ? -value : value;
+
+			if (!integral || exponent != 0) out.type = DynaValType::Double;
+			else if (out.value >= -2147483648.0 && out.value <= 2147483647.0) out.type = DynaValType::Int;
+			else out.type = DynaValType::Long;
+
+			return out;
+		}
+
+		constexpr bool readBool () {
+			if (_readWord("true")) return true;
+			if (_readWord("false")) return false;
+			_invalid("expected a value");
+			return false;
+		}
+
+		constexpr void readNull () {
+			if (!_readWord("null")) _invalid("expected a value");
+		}
+
+		// Rejects the input for a reason found by the caller, such as a type or depth limit
+		constexpr void fail (const char *reason) {
+			_invalid(reason);
+		}
+
+		// Skips over the next complete value
+		constexpr void skipValue (const size_t depth = 0) {
+			switch (peekType()) {
+				case DynaValType::Object:
+					if (depth >= DYNAVAL_JSON_MAX_DEPTH) return fail("nesting too deep");
+					expect('{', "expected an object");
+					if (consume('}')) return;
+					do {
+						readString([](char) {});
+						expect(':', "expected ':'");
+						skipValue(depth + 1);
+					} while (consume(','));
+					expect('}', "expected ',' or '}'");
+					return;
+				case DynaValType::Array:
+					if (depth >= DYNAVAL_JSON_MAX_DEPTH) return fail("nesting too deep");
+					expect('[', "expected an array");
+					if (consume(']')) return;
+					do {
+						skipValue(depth + 1);
+					} while (consume(','));
+					expect(']', "expected ',' or ']'");
+					return;
+				case DynaValType::String:
+					readString([](char) {});
+					return;
+				case DynaValType::Bool:
+					readBool();
+					return;
+				case DynaValType::Null:
+					readNull();
+					return;
+				default:
+					readNumber();
+			}
+		}
+
+		/**
+		 * Counts the items of the array or object starting at the next
+		 * character without consuming anything, so callers can lay out a
+		 * fixed size table before reading the items themselves.
+		 */
+		[[nodiscard]] constexpr uint32_t countItems () {
+			DynaJsonReader scan = *this;
+			const bool isObject = scan.peek() == '{';
+			scan.expect(isObject ? '{' : '[', "expected a container");
+			if (scan.consume(isObject ? '}' : ']')) return 0;
+
+			uint32_t count = 0;
+			do {
+				if (isObject) {
+					scan.readString([](char) {});
+					scan.expect(':', "expected ':'");
+				}
+				scan.skipValue();
+				++count;
+			} while (scan.consume(','));
+
+			return count;
+		}
+
+	private:
+		std::string_view _json;
+		size_t _pos = 0;
+		const char *_error = nullptr;
+
+		/**
+		 * Correctly rounded conversion of the unsigned number text in
+		 * [from, to). Out of range text becomes 0 or HUGE_VAL depending on
+		 * the sign of its decimal exponent, as strtod does.
+		 */
+		double _parseDouble (const size_t from, const size_t to, const int exponent) const {
+			double value = 0;
+#if defined(__cpp_lib_to_chars)
+			const auto result = std::from_chars(_json.data() + from, _json.data() + to, value);
+			if (result.ec == std::errc::result_out_of_range) return exponent < 0 ? 0 : HUGE_VAL;
+#else
+			const std::string text(_json.substr(from, to - from));
+			value = std::strtod(text.c_str(), nullptr);
+#endif
+			return value;
+		}
+
+		constexpr void _invalid (const char *reason) {
+#ifdef DYNAVAL_NO_EXCEPTIONS
+			if (!_error) _error = reason;
+			_pos = _json.size();
+#else
+			// Always taken; a call that cannot be skipped is not allowed in a constexpr function
+			if (reason) detail::dynaJsonInvalid(reason);
+#endif
+		}
+
+		static constexpr bool _isDigit (const char c) { return c >= '0' && c <= '9'; }
+
+		constexpr bool _readWord (const std::string_view word) {
+			skipWhitespace();
+			if (_json.substr(_pos, word.size()) != word) return false;
+			_pos += word.size();
+			return true;
+		}
+
+		constexpr uint32_t _readHex4 () {
+			if (_pos + 4 > _json.size()) {
+				_invalid("short \\u escape");
+				return 0;
+			}
+			uint32_t code = 0;
+			for (int i = 0; i < 4; ++i) {
+				const char c = _json[_pos++];
+				code <<= 4;
+				if (c >= '0' && c <= '9') code |= static_cast<uint32_t>(c - '0');
+				else if (c >= 'a' && c <= 'f') code |= static_cast<uint32_t>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F') code |= static_cast<uint32_t>(c - 'A' + 10);
+				else {
+					_invalid("bad \\u escape");
+					return 0;
+				}
+			}
+			return code;
+		}
+
+		template <typename Sink>
+		static constexpr void _writeUtf8 (const uint32_t code, Sink &sink) {
+			if (code < 0x80) {
+				sink(static_cast<char>(code));
+			} else if (code < 0x800) {
+				sink(static_cast<char>(0xc0 | code >> 6));
+				sink(static_cast<char>(0x80 | (code & 0x3f)));
+			} else if (code < 0x10000) {
+				sink(static_cast<char>(0xe0 | code >> 12));
+				sink(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+				sink(static_cast<char>(0x80 | (code & 0x3f)));
+			} else {
+				sink(static_cast<char>(0xf0 | code >> 18));
+				sink(static_cast<char>(0x80 | (code >> 12 & 0x3f)));
+				sink(static_cast<char>(0x80 | (code >> 6 & 0x3f)));
+				sink(static_cast<char>(0x80 | (code & 0x3f)));
+			}
+		}
+	};
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include "DynaJsonReader.h"
+#include "DynaView.h"
+
+/**
+ * Compile-time DynaVal literals.
+ *
+ *   constexpr Irrelon::DynaView defaults = Irrelon::dynaLiteral<R"({"port": 8080, "hosts": ["a", "b"]})">();
+ *
+ * The JSON is parsed during compilation and laid out in the DynaView
+ * snapshot format as a constexpr array, so it lands in read-only storage
+ * (.rodata / flash) and is read in place without any heap allocation.
+ * Malformed JSON is a compile error. Duplicate keys keep the last value.
+ */
+namespace Irrelon {
+	template <size_t N>
+	struct DynaFixedString {
+		char data[N] {};
+
+		constexpr DynaFixedString (const char (&text)[N]) {
+			for (size_t i = 0; i < N; ++i) data[i] = text[i];
+		}
+
+		[[nodiscard]] constexpr std::string_view view () const { return {data, N - 1}; }
+	};
+
+	namespace detail {
+		/**
+		 * Writes JSON out as a DynaView snapshot. With a null output buffer it
+		 * only measures, which is how the literal learns its array size.
+		 */
+		class DynaLiteralWriter {
+		public:
+			constexpr DynaLiteralWriter (const std::string_view json, char *out) : _reader(json), _out(out) {}
+
+			constexpr size_t write () {
+				_size = kDynaSnapshotHeaderSize;
+				const uint32_t root = _node();
+				if (_reader.failed()) dynaJsonInvalid(_reader.error());
+				if (!_reader.atEnd()) dynaJsonInvalid("unexpected data after the value");
+
+				if (_out) {
+					_out[0] = 'D';
+					_out[1] = 'Y';
+					_out[2] = 'N';
+					_out[3] = 'V';
+					_out[4] = static_cast<char>(kDynaSnapshotVersion);
+					_patchU32(8, root);
+					_patchU32(12, static_cast<uint32_t>(_size));
+				}
+
+				return _size;
+			}
+
+		private:
+			DynaJsonReader _reader;
+			char *_out;
+			size_t _size = 0;
+
+			constexpr void _put (const char c) {
+				if (_out) _out[_size] = c;
+				++_size;
+			}
+
+			constexpr void _putU32 (const uint32_t value) {
+				for (int shift = 0; shift < 32; shift += 8) _put(static_cast<char>(value >> shift));
+			}
+
+			constexpr void _patchU32 (const size_t at, const uint32_t value) {
+				if (!_out) return;
+				for (int i = 0; i < 4; ++i) _out[at + i] = static_cast<char>(value >> (i * 8));
+			}
+
+			// Writes the next string's bytes length prefixed, returns the offset of the bytes
+			constexpr size_t _string (const bool terminate) {
+				const size_t lengthAt = _size;
+				_putU32(0);
+				const size_t start = _size;
+				_reader.readString([this](const char c) { _put(c); });
+				_patchU32(lengthAt, static_cast<uint32_t>(_size - start));
+				if (terminate) _put('\0');
+				return start;
+			}
+
+			constexpr uint32_t _node () {
+				const auto offset = static_cast<uint32_t>(_size);
+				const DynaValType type = _reader.peekType();
+
+				switch (type) {
+					case DynaValType::Null:
+						_reader.readNull();
+						_put(static_cast<char>(DynaValType::Null));
+						break;
+					case DynaValType::Bool:
+						_put(static_cast<char>(DynaValType::Bool));
+						_put(_reader.readBool() ? 1 : 0);
+						break;
+					case DynaValType::String:
+						_put(static_cast<char>(DynaValType::String));
+						_string(true);
+						break;
+					case DynaValType::Array:
+						_array();
+						break;
+					case DynaValType::Object:
+						_object();
+						break;
+					default: {
+						const DynaJsonNumber number = _reader.readNumber();
+						_put(static_cast<char>(number.type));
+						const auto bits = std::bit_cast<uint64_t>(number.value);
+						for (int shift = 0; shift < 64; shift += 8) _put(static_cast<char>(bits >> shift));
+					}
+				}
+
+				return offset;
+			}
+
+			constexpr void _array () {
+				const uint32_t count = _reader.countItems();
+				_put(static_cast<char>(DynaValType::Array));
+				_putU32(count);
+				const size_t table = _size;
+				_size += count * 4;
+
+				_reader.expect('[', "expected an array");
+				for (uint32_t i = 0; i < count; ++i) {
+					if (i) _reader.expect(',', "expected ','");
+					_patchU32(table + i * 4, _node());
+				}
+				_reader.expect(']', "expected ']'");
+			}
+
+			constexpr void _object () {
+				const uint32_t count = _reader.countItems();
+				_put(static_cast<char>(DynaValType::Object));
+				const size_t countAt = _size;
+				_putU32(count);
+				const size_t table = _size;
+				_size += count * 12;
+
+				_reader.expect('{', "expected an object");
+				for (uint32_t i = 0; i < count; ++i) {
+					if (i) _reader.expect(',', "expected ','");
+					const size_t row = table + i * 12;
+					const size_t key = _string(false);
+					_patchU32(row, static_cast<uint32_t>(key));
+					_patchU32(row + 4, static_cast<uint32_t>(_size - key));
+					_reader.expect(':', "expected ':'");
+					_patchU32(row + 8, _node());
+				}
+				_reader.expect('}', "expected '}'");
+
+				if (_out) _patchU32(countAt, _sortRows(table, count));
+			}
+
+			[[nodiscard]] constexpr std::string_view _rowKey (const size_t row) const {
+				return {_out + dynaReadU32(_out + row), dynaReadU32(_out + row + 4)};
+			}
+
+			/**
+			 * Stable sorts the key table so DynaView can binary search it, then
+			 * drops all but the last of any duplicate keys. The rows freed by
+			 * duplicates stay behind unused. Returns the new entry count.
+			 */
+			constexpr uint32_t _sortRows (const size_t table, const uint32_t count) {
+				for (uint32_t i = 1; i < count; ++i) {
+					for (uint32_t j = i; j > 0 && _rowKey(table + j * 12) < _rowKey(table + (j - 1) * 12); --j) {
+						for (size_t b = 0; b < 12; ++b) {
+							const char swap = _out[table + j * 12 + b];
+							_out[table + j * 12 + b] = _out[table + (j - 1) * 12 + b];
+							_out[table + (j - 1) * 12 + b] = swap;
+						}
+					}
+				}
+
+				uint32_t kept = 0;
+				for (uint32_t i = 0; i < count; ++i) {
+					if (i + 1 < count && _rowKey(table + i * 12) == _rowKey(table + (i + 1) * 12)) continue;
+					for (size_t b = 0; b < 12; ++b) _out[table + kept * 12 + b] = _out[table + i * 12 + b];
+					++kept;
+				}
+
+				return kept;
+			}
+		};
+
+		template <DynaFixedString Json>
+		constexpr auto dynaLiteralBytes () {
+			constexpr size_t size = DynaLiteralWriter(Json.view(), nullptr).write();
+			std::array<char, size> out {};
+			DynaLiteralWriter(Json.view(), out.data()).write();
+			return out;
+		}
+
+		template <DynaFixedString Json>
+		inline constexpr auto dynaLiteralStorage = dynaLiteralBytes<Json>();
+	}
+
+	// A read-only view of JSON laid out at compile time
+	template <DynaFixedString Json>
+	constexpr DynaView dynaLiteral () {
+		return DynaView(detail::dynaLiteralStorage<Json>.data());
+	}
+
+	// The raw snapshot bytes behind dynaLiteral(), e.g. to write them to a file
+	template <DynaFixedString Json>
+	constexpr const auto &dynaLiteralBytes () {
+		return detail::dynaLiteralStorage<Json>;
+	}
+
+	namespace literals {
+		// R"({"port": 8080})"_dyna
+		template <DynaFixedString Json>
+		constexpr DynaView operator""_dyna () {
+			return dynaLiteral<Json>();
+		}
+	}
+}
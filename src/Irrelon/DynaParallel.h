@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "dynaThrow.h"
+
+#ifndef DYNAVAL_NO_THREADS
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace Irrelon {
+	/**
+	 * Controls how the parallel variants of deepCopy(), toJson() and equals()
+	 * split work. Containers with fewer than `cutoff` direct children always
+	 * take the sequential path so small trees pay nothing for the option.
+	 */
+	struct DynaParallelPolicy {
+		// Number of threads to use including the caller, 0 = hardware concurrency
+		size_t threads = 0;
+		// Minimum number of direct children before a container is split
+		size_t cutoff = 4096;
+		// Elements per chunk, 0 = split evenly across threads
+		size_t chunkSize = 0;
+
+		[[nodiscard]] size_t threadCount () const {
+#ifdef DYNAVAL_NO_THREADS
+			return 1;
+#else
+			if (threads) return threads;
+			const unsigned hw = std::thread::hardware_concurrency();
+			return hw ? hw : 1;
+#endif
+		}
+
+		[[nodiscard]] size_t chunkCount (const size_t count) const {
+			if (!count) return 0;
+			if (chunkSize) return (count + chunkSize - 1) / chunkSize;
+			return std::min(count, threadCount());
+		}
+
+		[[nodiscard]] bool shouldSplit (const size_t count) const {
+			return count >= cutoff && count > 1 && threadCount() > 1;
+		}
+	};
+
+	namespace detail {
+#ifndef DYNAVAL_NO_THREADS
+		// Set on pool workers and on a caller while it runs chunks so that nested
+		// parallel calls fall back to the sequential path instead of deadlocking
+		inline thread_local bool dynaInParallelRegion = false;
+
+		struct DynaParallelJob {
+			std::function<void(size_t)> fn;
+			size_t count = 0;
+			std::atomic<size_t> next{0};
+			std::atomic<size_t> finished{0};
+			std::mutex mutex;
+			std::condition_variable done;
+			std::exception_ptr error;
+
+			void run () {
+				size_t index;
+				while ((index = next.fetch_add(1)) < count) {
+#ifdef DYNAVAL_NO_EXCEPTIONS
+					fn(index);
+#else
+					try {
+						fn(index);
+					} catch (...) {
+						std::lock_guard<std::mutex> lock(mutex);
+						if (!error) error = std::current_exception();
+					}
+#endif
+
+					if (finished.fetch_add(1) + 1 == count) {
+						std::lock_guard<std::mutex> lock(mutex);
+						done.notify_all();
+					}
+				}
+			}
+		};
+
+		/**
+		 * A lazily started pool of worker threads shared by every parallel
+		 * DynaVal operation. Workers are created on first use and live for the
+		 * rest of the process.
+		 */
+		class DynaTaskPool {
+		public:
+			static DynaTaskPool &instance () {
+				static DynaTaskPool pool;
+				return pool;
+			}
+
+			void run (const size_t count, const size_t threads, std::function<void(size_t)> fn) {
+				auto job = std::make_shared<DynaParallelJob>();
+				job->fn = std::move(fn);
+				job->count = count;
+
+				const size_t helpers = std::min(threads, count) - 1;
+				ensureWorkers(helpers);
+
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					for (size_t i = 0; i < helpers; ++i) _queue.push_back(job);
+				}
+				_wake.notify_all();
+
+				dynaInParallelRegion = true;
+				job->run();
+				dynaInParallelRegion = false;
+
+				std::unique_lock<std::mutex> lock(job->mutex);
+				job->done.wait(lock, [&job] { return job->finished.load() >= job->count; });
+
+#ifndef DYNAVAL_NO_EXCEPTIONS
+				if (job->error) std::rethrow_exception(job->error);
+#endif
+			}
+
+			~DynaTaskPool () {
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					_stopping = true;
+				}
+				_wake.notify_all();
+				for (auto &worker : _workers) worker.join();
+			}
+
+		private:
+			std::mutex _mutex;
+			std::condition_variable _wake;
+			std::deque<std::shared_ptr<DynaParallelJob>> _queue;
+			std::vector<std::thread> _workers;
+			bool _stopping = false;
+
+			void ensureWorkers (const size_t wanted) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				while (_workers.size() < wanted) {
+					_workers.emplace_back([this] { workerLoop(); });
+				}
+			}
+
+			void workerLoop () {
+				dynaInParallelRegion = true;
+
+				for (;;) {
+					std::shared_ptr<DynaParallelJob> job;
+					{
+						std::unique_lock<std::mutex> lock(_mutex);
+						_wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+						if (_stopping && _queue.empty()) return;
+						job = std::move(_queue.front());
+						_queue.pop_front();
+					}
+					job->run();
+				}
+			}
+		};
+#endif
+	}
+
+	/**
+	 * Splits [0, count) into the chunks described by `policy` and calls
+	 * fn(chunkIndex, begin, end) for each of them, using the shared task pool
+	 * when the policy allows it. Blocks until every chunk has completed and
+	 * rethrows the first exception thrown by any chunk.
+	 */
+	inline void dynaParallelFor (
+		const DynaParallelPolicy &policy,
+		const size_t count,
+		const std::function<void(size_t, size_t, size_t)> &fn
+	) {
+		const size_t chunks = policy.chunkCount(count);
+		if (!chunks) return;
+
+		const size_t perChunk = (count + chunks - 1) / chunks;
+		const auto runChunk = [&](const size_t chunk) {
+			const size_t begin = chunk * perChunk;
+			const size_t end = std::min(count, begin + perChunk);
+			if (begin < end) fn(chunk, begin, end);
+		};
+
+#ifndef DYNAVAL_NO_THREADS
+		if (chunks > 1 && policy.threadCount() > 1 && !detail::dynaInParallelRegion) {
+			detail::DynaTaskPool::instance().run(chunks, policy.threadCount(), runChunk);
+			return;
+		}
+#endif
+
+		for (size_t chunk = 0; chunk < chunks; ++chunk) runChunk(chunk);
+	}
+}
@@ -0,0 +1,502 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * AST node builders in the same shape as makeParam(). Together with
+	 * IDENTIFIER, LITERAL and ASSIGNMENT_PATTERN these are the node kinds
+	 * DynaProgram compiles:
+	 *
+	 *   BINARY       operator, left, right   + - * / % == != < <= > >=
+	 *   LOGICAL      operator, left, right   && || ??
+	 *   UNARY        operator, argument      ! -
+	 *   CONDITIONAL  test, consequent, alternate
+	 *   MEMBER       object, property        object[property]
+	 */
+	inline DynaVal makeLiteral (const DynaVal &value) {
+		DynaVal node;
+		node["kind"] = "LITERAL";
+		node["value"] = value;
+		return node;
+	}
+
+	inline DynaVal makeIdentifier (const std::string &name) {
+		DynaVal node;
+		node["kind"] = "IDENTIFIER";
+		node["value"] = name;
+		return node;
+	}
+
+	inline DynaVal makeBinary (const std::string &op, const DynaVal &left, const DynaVal &right) {
+		DynaVal node;
+		node["kind"] = "BINARY";
+		node["operator"] = op;
+		node["left"] = left;
+		node["right"] = right;
+		return node;
+	}
+
+	inline DynaVal makeLogical (const std::string &op, const DynaVal &left, const DynaVal &right) {
+		DynaVal node = makeBinary(op, left, right);
+		node["kind"] = "LOGICAL";
+		return node;
+	}
+
+	inline DynaVal makeUnary (const std::string &op, const DynaVal &argument) {
+		DynaVal node;
+		node["kind"] = "UNARY";
+		node["operator"] = op;
+		node["argument"] = argument;
+		return node;
+	}
+
+	inline DynaVal makeConditional (const DynaVal &test, const DynaVal &consequent, const DynaVal &alternate) {
+		DynaVal node;
+		node["kind"] = "CONDITIONAL";
+		node["test"] = test;
+		node["consequent"] = consequent;
+		node["alternate"] = alternate;
+		return node;
+	}
+
+	inline DynaVal makeMember (const DynaVal &object, const DynaVal &property) {
+		DynaVal node;
+		node["kind"] = "MEMBER";
+		node["object"] = object;
+		node["property"] = property;
+		return node;
+	}
+
+	/**
+	 * An expression AST lowered to stack bytecode. Compiling resolves every
+	 * identifier to a numbered slot and every literal to a constant pool
+	 * index, so running the program never looks at a "kind" or "value"
+	 * key or compares identifier names.
+	 *
+	 * ASSIGNMENT_PATTERN evaluates to its identifier's value, or to the
+	 * right hand side when that value is undefined, and stores the result
+	 * back into the slot for later references. Arithmetic keeps integer
+	 * types when both operands are integers and the result is integral,
+	 * and "+" concatenates when either side is a string. Type errors and
+	 * error operands produce an error value rather than throwing.
+	 *
+	 * A compiled program is immutable and can be run from many threads.
+	 */
+	class DynaProgram {
+	public:
+		/**
+		 * Compiles ast. Identifiers named in slots get those slot numbers in
+		 * order, others are numbered after them by first appearance. Throws
+		 * std::runtime_error for malformed nodes.
+		 */
+		static DynaProgram compile (const DynaVal &ast, const std::vector<std::string> &slots = {}) {
+			DynaProgram program;
+			program._slots = slots;
+			program._compile(ast);
+			program._emit(Op::Return);
+			return program;
+		}
+
+		[[nodiscard]] size_t slotCount () const { return _slots.size(); }
+
+		// The slot an identifier was assigned, or -1 if the expression does not use it
+		[[nodiscard]] int slot (const std::string &name) const {
+			for (size_t i = 0; i < _slots.size(); ++i) {
+				if (_slots[i] == name) return static_cast<int>(i);
+			}
+			return -1;
+		}
+
+		[[nodiscard]] const std::vector<std::string> &slotNames () const { return _slots; }
+
+		// Runs with slot values given by position, missing trailing slots are undefined
+		[[nodiscard]] DynaVal run (const std::vector<DynaVal> &slotValues) const {
+			std::vector<DynaVal> locals(_slots.size());
+			for (size_t i = 0; i < locals.size(); ++i) {
+				if (i < slotValues.size()) locals[i] = slotValues[i];
+				else locals[i].becomeUndefined();
+			}
+			return _execute(locals);
+		}
+
+		// Runs with identifiers read from the keys of scope, missing keys are undefined
+		[[nodiscard]] DynaVal run (const DynaVal &scope) const {
+			std::vector<DynaVal> locals(_slots.size());
+			for (size_t i = 0; i < locals.size(); ++i) {
+				if (scope.containsKey(_slots[i])) locals[i] = scope[_slots[i]];
+				else locals[i].becomeUndefined();
+			}
+			return _execute(locals);
+		}
+
+	private:
+		enum class Op : uint8_t {
+			Constant,
+			Load,
+			Store,
+			Pop,
+			Add,
+			Subtract,
+			Multiply,
+			Divide,
+			Modulo,
+			Equal,
+			NotEqual,
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			Not,
+			Negate,
+			Member,
+			Jump,
+			// Conditional jumps that keep the tested value on the stack
+			JumpIfFalsy,
+			JumpIfTruthy,
+			JumpIfPresent,
+			JumpIfDefined,
+			// Pops the tested value
+			JumpIfFalsyPop,
+			Return
+		};
+
+		std::vector<uint8_t> _code;
+		std::vector<DynaVal> _constants;
+		std::vector<std::string> _slots;
+		size_t _depth = 0;
+		size_t _maxDepth = 0;
+
+		void _emit (const Op op) {
+			_code.push_back(static_cast<uint8_t>(op));
+		}
+
+		void _emit (const Op op, const uint32_t operand) {
+			_emit(op);
+			for (int shift = 0; shift < 32; shift += 8) _code.push_back(static_cast<uint8_t>(operand >> shift));
+		}
+
+		// Emits a jump with a placeholder target, returns where to patch it
+		size_t _emitJump (const Op op) {
+			_emit(op, 0);
+			return _code.size() - 4;
+		}
+
+		void _patchJump (const size_t at) {
+			const auto target = static_cast<uint32_t>(_code.size());
+			for (int i = 0; i < 4; ++i) _code[at + i] = static_cast<uint8_t>(target >> (i * 8));
+		}
+
+		void _push () {
+			if (++_depth > _maxDepth) _maxDepth = _depth;
+		}
+
+		uint32_t _slotFor (const std::string &name) {
+			const int existing = slot(name);
+			if (existing >= 0) return static_cast<uint32_t>(existing);
+			_slots.push_back(name);
+			return static_cast<uint32_t>(_slots.size() - 1);
+		}
+
+		static const DynaVal &_child (const DynaVal &node, const char *key) {
+			if (!node.containsKey(key)) {
+				detail::dynaThrow("AST node " + node["kind"].string + " is missing \"" + key + "\"");
+			}
+			return node[key];
+		}
+
+		static Op _binaryOp (const std::string &op) {
+			if (op == "+") return Op::Add;
+			if (op == "-") return Op::Subtract;
+			if (op == "*") return Op::Multiply;
+			if (op == "/") return Op::Divide;
+			if (op == "%") return Op::Modulo;
+			if (op == "==") return Op::Equal;
+			if (op == "!=") return Op::NotEqual;
+			if (op == "<") return Op::Less;
+			if (op == "<=") return Op::LessEqual;
+			if (op == ">") return Op::Greater;
+			if (op == ">=") return Op::GreaterEqual;
+			detail::dynaThrow("Unknown binary operator \"" + op + "\"");
+		}
+
+		void _compile (const DynaVal &node) {
+			const DynaVal &kind = node["kind"];
+			if (!kind.isString()) detail::dynaThrow("AST node has no kind");
+
+			if (kind == "LITERAL") {
+				// Containers get a private, frozen copy, so neither the AST nor a run can change the pool
+				DynaVal constant = node["value"].deepCopy();
+				if (constant.isArray() || constant.isObject()) constant.freeze();
+				_constants.push_back(std::move(constant));
+				_emit(Op::Constant, static_cast<uint32_t>(_constants.size() - 1));
+				_push();
+			} else if (kind == "IDENTIFIER") {
+				const DynaVal &name = _child(node, "value");
+				if (!name.isString()) detail::dynaThrow("IDENTIFIER value must be a string");
+				_emit(Op::Load, _slotFor(name.string));
+				_push();
+			} else if (kind == "ASSIGNMENT_PATTERN") {
+				const DynaVal &left = _child(node, "left");
+				if (left["kind"] != "IDENTIFIER" || !left["value"].isString()) {
+					detail::dynaThrow("ASSIGNMENT_PATTERN left must be an IDENTIFIER");
+				}
+				const uint32_t target = _slotFor(left["value"].string);
+				_emit(Op::Load, target);
+				_push();
+				const size_t done = _emitJump(Op::JumpIfDefined);
+				_emit(Op::Pop);
+				--_depth;
+				_compile(_child(node, "right"));
+				_emit(Op::Store, target);
+				_patchJump(done);
+			} else if (kind == "BINARY") {
+				const Op op = _binaryOp(_child(node, "operator").string);
+				_compile(_child(node, "left"));
+				_compile(_child(node, "right"));
+				_emit(op);
+				--_depth;
+			} else if (kind == "LOGICAL") {
+				const std::string &op = _child(node, "operator").string;
+				Op jump;
+				if (op == "&&") jump = Op::JumpIfFalsy;
+				else if (op == "||") jump = Op::JumpIfTruthy;
+				else if (op == "??") jump = Op::JumpIfPresent;
+				else detail::dynaThrow("Unknown logical operator \"" + op + "\"");
+
+				// The right side only runs when the left does not decide the result
+				_compile(_child(node, "left"));
+				const size_t done = _emitJump(jump);
+				_emit(Op::Pop);
+				--_depth;
+				_compile(_child(node, "right"));
+				_patchJump(done);
+			} else if (kind == "UNARY") {
+				const std::string &op = _child(node, "operator").string;
+				_compile(_child(node, "argument"));
+				if (op == "!") _emit(Op::Not);
+				else if (op == "-") _emit(Op::Negate);
+				else detail::dynaThrow("Unknown unary operator \"" + op + "\"");
+			} else if (kind == "CONDITIONAL") {
+				_compile(_child(node, "test"));
+				const size_t otherwise = _emitJump(Op::JumpIfFalsyPop);
+				--_depth;
+				_compile(_child(node, "consequent"));
+				const size_t done = _emitJump(Op::Jump);
+				--_depth;
+				_patchJump(otherwise);
+				_compile(_child(node, "alternate"));
+				_patchJump(done);
+			} else if (kind == "MEMBER") {
+				_compile(_child(node, "object"));
+				_compile(_child(node, "property"));
+				_emit(Op::Member);
+				--_depth;
+			} else {
+				detail::dynaThrow("Cannot compile AST node of kind " + kind.string);
+			}
+		}
+
+		static bool _isInteger (const DynaVal &val) {
+			return val.type == DynaValType::Int || val.type == DynaValType::UInt || val.type == DynaValType::Long;
+		}
+
+		static std::string _concatText (const DynaVal &val) {
+			if (val.isString()) return val.string;
+			return val.toJson();
+		}
+
+		static DynaVal _number (const DynaVal &left, const DynaVal &right, const double result) {
+			DynaVal out;
+			out.number = result;
+			out.type = DynaValType::Double;
+			// Whole results inside the Long range stay integers, checked before any cast
+			if (!_isInteger(left) || !_isInteger(right) || std::trunc(result) != result ||
+				result < -9223372036854775808.0 || result >= 9223372036854775808.0) return out;
+
+			// The wider of the two integer types, then Int for negatives and Long for anything that does not fit
+			out.type = static_cast<int>(left.type) > static_cast<int>(right.type) ? left.type : right.type;
+			if (out.type == DynaValType::UInt && result < 0) out.type = DynaValType::Int;
+			if (out.type == DynaValType::UInt && result > 4294967295.0) out.type = DynaValType::Long;
+			if (out.type == DynaValType::Int && (result < -2147483648.0 || result > 2147483647.0)) out.type = DynaValType::Long;
+			return out;
+		}
+
+		static DynaVal _arithmetic (const Op op, const DynaVal &left, const DynaVal &right) {
+			if (left.isError()) return left;
+			if (right.isError()) return right;
+
+			if (op == Op::Add && (left.isString() || right.isString())) {
+				return DynaVal(_concatText(left) + _concatText(right));
+			}
+
+			if (!left.isNumber() || !right.isNumber()) {
+				return DynaVal::error("Cannot apply arithmetic to " + dynaValTypeToString(left.type) + " and " +
+					dynaValTypeToString(right.type), 400);
+			}
+
+			switch (op) {
+				case Op::Add: return _number(left, right, left.number + right.number);
+				case Op::Subtract: return _number(left, right, left.number - right.number);
+				case Op::Multiply: return _number(left, right, left.number * right.number);
+				default: break;
+			}
+
+			// An integer zero divisor is an error for both operators, a floating one follows IEEE 754
+			if (right.number == 0 && _isInteger(right)) {
+				static const DynaError divisionByZero("Division by zero", 400);
+				static const DynaError moduloByZero("Modulo by zero", 400);
+				return DynaVal::staticError(op == Op::Divide ? divisionByZero : moduloByZero);
+			}
+			if (op == Op::Divide) return DynaVal(left.number / right.number);
+			return _number(left, right, std::fmod(left.number, right.number));
+		}
+
+		// Orders numbers by value and strings lexicographically, other pairs never compare
+		static bool _compare (const Op op, const DynaVal &left, const DynaVal &right) {
+			int order;
+			if (left.isNumber() && right.isNumber()) {
+				if (left.number != left.number || right.number != right.number) return false;
+				order = left.number < right.number ? -1 : left.number > right.number ? 1 : 0;
+			} else if (left.isString() && right.isString()) {
+				order = left.string.compare(right.string);
+			} else {
+				return false;
+			}
+
+			switch (op) {
+				case Op::Less: return order < 0;
+				case Op::LessEqual: return order <= 0;
+				case Op::Greater: return order > 0;
+				default: return order >= 0;
+			}
+		}
+
+		static DynaVal _member (const DynaVal &object, const DynaVal &property) {
+			DynaVal out;
+			if (object.isArray() && property.isNumber() && property.number >= 0) {
+				const auto index = static_cast<size_t>(property.number);
+				if (index < object.size()) return object[index];
+			} else if (object.isObject() && property.isString() && object.containsKey(property.string)) {
+				return object[property.string];
+			}
+			out.becomeUndefined();
+			return out;
+		}
+
+		[[nodiscard]] uint32_t _operand (const size_t at) const {
+			return static_cast<uint32_t>(_code[at]) | static_cast<uint32_t>(_code[at + 1]) << 8 |
+				static_cast<uint32_t>(_code[at + 2]) << 16 | static_cast<uint32_t>(_code[at + 3]) << 24;
+		}
+
+		DynaVal _execute (std::vector<DynaVal> &locals) const {
+			std::vector<DynaVal> stack;
+			stack.reserve(_maxDepth);
+			size_t pc = 0;
+
+			while (true) {
+				const auto op = static_cast<Op>(_code[pc++]);
+
+				switch (op) {
+					case Op::Constant: {
+						// Container literals are copied so a result never shares the pool's storage
+						const DynaVal &constant = _constants[_operand(pc)];
+						if (constant.isArray() || constant.isObject()) stack.push_back(constant.deepCopy());
+						else stack.push_back(constant);
+						pc += 4;
+						break;
+					}
+					case Op::Load:
+						stack.push_back(locals[_operand(pc)]);
+						pc += 4;
+						break;
+					case Op::Store:
+						locals[_operand(pc)] = stack.back();
+						pc += 4;
+						break;
+					case Op::Pop:
+						stack.pop_back();
+						break;
+					case Op::Add:
+					case Op::Subtract:
+					case Op::Multiply:
+					case Op::Divide:
+					case Op::Modulo: {
+						DynaVal result = _arithmetic(op, stack[stack.size() - 2], stack.back());
+						stack.pop_back();
+						stack.back() = std::move(result);
+						break;
+					}
+					case Op::Equal:
+					case Op::NotEqual: {
+						const bool equal = stack[stack.size() - 2].equals(stack.back());
+						stack.pop_back();
+						stack.back() = DynaVal(op == Op::Equal ? equal : !equal);
+						break;
+					}
+					case Op::Less:
+					case Op::LessEqual:
+					case Op::Greater:
+					case Op::GreaterEqual: {
+						const bool result = _compare(op, stack[stack.size() - 2], stack.back());
+						stack.pop_back();
+						stack.back() = DynaVal(result);
+						break;
+					}
+					case Op::Not:
+						stack.back() = DynaVal(stack.back().isFalsy());
+						break;
+					case Op::Negate: {
+						DynaVal &top = stack.back();
+						if (_isInteger(top)) {
+							// -UInt and -INT_MIN leave their type, so they widen like a binary result
+							top = _number(top, top, -top.number);
+						} else if (top.isNumber()) {
+							DynaVal negated;
+							negated.type = top.type;
+							negated.number = -top.number;
+							top = std::move(negated);
+						} else if (!top.isError()) {
+							top = DynaVal::error("Cannot negate " + dynaValTypeToString(top.type), 400);
+						}
+						break;
+					}
+					case Op::Member: {
+						DynaVal result = _member(stack[stack.size() - 2], stack.back());
+						stack.pop_back();
+						stack.back() = std::move(result);
+						break;
+					}
+					case Op::Jump:
+						pc = _operand(pc);
+						break;
+					case Op::JumpIfFalsy:
+						pc = stack.back().isFalsy() ? _operand(pc) : pc + 4;
+						break;
+					case Op::JumpIfTruthy:
+						pc = !stack.back().isFalsy() ? _operand(pc) : pc + 4;
+						break;
+					case Op::JumpIfPresent:
+						pc = !stack.back().isNull() && !stack.back().isUndefined() ? _operand(pc) : pc + 4;
+						break;
+					case Op::JumpIfDefined:
+						pc = !stack.back().isUndefined() ? _operand(pc) : pc + 4;
+						break;
+					case Op::JumpIfFalsyPop: {
+						const bool falsy = stack.back().isFalsy();
+						stack.pop_back();
+						pc = falsy ? _operand(pc) : pc + 4;
+						break;
+					}
+					case Op::Return:
+						return std::move(stack.back());
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,522 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "DynaVal.h"
+#include "DynaJsonReader.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * A JSONPath expression compiled into a reusable plan.
+	 *
+	 *   $.readings[?(@.value > 30)].id
+	 *
+	 * Supported: $ root, .name and ['name'] children, [n] indexes (negative
+	 * from the end), * wildcards, .. recursive descent, [start:end:step]
+	 * slices, [a,b] unions and [?(...)] filters. Filters take @ and $
+	 * paths, numbers, quoted strings, true, false and null, the comparisons
+	 * == != < <= > >=, and && || ! with parentheses. A path on its own in a
+	 * filter tests that the key exists.
+	 *
+	 * Key names are parsed once at compile time, but each key step is still
+	 * an ordinary find(), so a flat path runs no faster than a hand loop.
+	 * Matches are handed to a callback by const reference into the queried
+	 * tree, so nothing is copied. compile() throws std::runtime_error for
+	 * malformed paths.
+	 */
+	class DynaQuery {
+	public:
+		static DynaQuery compile (const std::string &path) {
+			DynaQuery query;
+			Parser parser {path, 0, query};
+			parser.parsePath(query._steps);
+			if (parser.pos != path.size()) parser.fail("unexpected character");
+			return query;
+		}
+
+		/**
+		 * Calls fn(const DynaVal &) for every match in document order. If fn
+		 * returns bool, returning false stops the query early.
+		 */
+		template <typename Fn>
+		void forEach (const DynaVal &root, Fn &&fn) const {
+			_walk(root, 0, root, fn);
+		}
+
+		// Copies the matches into an array, containers still share storage with root
+		[[nodiscard]] DynaVal select (const DynaVal &root) const {
+			DynaValArray matches;
+			forEach(root, [&matches](const DynaVal &match) { matches.push_back(match); });
+			return DynaVal(std::move(matches));
+		}
+
+		// The first match, or nullptr
+		[[nodiscard]] const DynaVal *first (const DynaVal &root) const {
+			const DynaVal *found = nullptr;
+			forEach(root, [&found](const DynaVal &match) {
+				found = &match;
+				return false;
+			});
+			return found;
+		}
+
+		[[nodiscard]] size_t count (const DynaVal &root) const {
+			size_t total = 0;
+			forEach(root, [&total](const DynaVal &) { ++total; });
+			return total;
+		}
+
+	private:
+		struct Selector {
+			enum class Kind : uint8_t { Key, Index, Wildcard, Slice, Filter };
+
+			Kind kind = Kind::Wildcard;
+			std::string key;
+			int64_t index = 0;
+			int64_t end = 0;
+			int64_t step = 1;
+			bool hasStart = false;
+			bool hasEnd = false;
+			uint32_t filter = 0;
+		};
+
+		struct Step {
+			bool recursive = false;
+			std::vector<Selector> selectors;
+		};
+
+		enum class Compare : uint8_t { None, Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual };
+
+		struct FilterNode {
+			enum class Kind : uint8_t { Literal, Current, Root, Compare, And, Or, Not };
+
+			Kind kind = Kind::Literal;
+			Compare compare = Compare::None;
+			uint32_t left = 0;
+			uint32_t right = 0;
+			DynaVal literal;
+			// Key and index selectors only
+			std::vector<Selector> path;
+		};
+
+		std::vector<Step> _steps;
+		std::vector<FilterNode> _filters;
+
+		struct Parser {
+			const std::string &text;
+			size_t pos;
+			DynaQuery &query;
+
+			[[noreturn]] void fail (const char *reason) const {
+				detail::dynaThrow("Invalid query at " + std::to_string(pos) + ": " + reason);
+			}
+
+			void skipSpaces () {
+				while (pos < text.size() && text[pos] == ' ') ++pos;
+			}
+
+			bool consume (const char c) {
+				skipSpaces();
+				if (pos < text.size() && text[pos] == c) {
+					++pos;
+					return true;
+				}
+				return false;
+			}
+
+			bool consume (const std::string_view word) {
+				skipSpaces();
+				if (text.compare(pos, word.size(), word) != 0) return false;
+				pos += word.size();
+				return true;
+			}
+
+			void expect (const char c) {
+				if (!consume(c)) fail(("expected '" + std::string(1, c) + "'").c_str());
+			}
+
+			static Selector keySelector (std::string key) {
+				Selector selector;
+				selector.kind = Selector::Kind::Key;
+				selector.key = std::move(key);
+				return selector;
+			}
+
+			std::string name () {
+				const size_t start = pos;
+				while (pos < text.size() && text[pos] != '.' && text[pos] != '[' && text[pos] != ' ' &&
+					text[pos] != ')' && text[pos] != '=' && text[pos] != '!' && text[pos] != '<' && text[pos] != '>' &&
+					text[pos] != '&' && text[pos] != '|') {
+					++pos;
+				}
+				if (pos == start) fail("expected a name");
+				return text.substr(start, pos - start);
+			}
+
+			std::string quoted () {
+				const char quote = text[pos++];
+				std::string out;
+				while (pos < text.size() && text[pos] != quote) {
+					if (text[pos] == '\\' && pos + 1 < text.size()) ++pos;
+					out += text[pos++];
+				}
+				if (pos >= text.size()) fail("unterminated string");
+				++pos;
+				return out;
+			}
+
+			bool integer (int64_t &out) {
+				skipSpaces();
+				const size_t start = pos;
+				if (pos < text.size() && text[pos] == '-') ++pos;
+				if (pos >= text.size() || text[pos] < '0' || text[pos] > '9') {
+					pos = start;
+					return false;
+				}
+				out = 0;
+				while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') out = out * 10 + (text[pos++] - '0');
+				if (text[start] == '-') out = -out;
+				return true;
+			}
+
+			void parsePath (std::vector<Step> &steps, const bool inFilter = false) {
+				if (!inFilter) {
+					skipSpaces();
+					if (pos < text.size() && text[pos] == '$') ++pos;
+				}
+
+				while (pos < text.size()) {
+					Step step;
+					if (text.compare(pos, 2, "..") == 0) {
+						if (inFilter) fail("recursive descent is not supported in filters");
+						pos += 2;
+						step.recursive = true;
+						if (pos < text.size() && text[pos] == '[') {
+							++pos;
+							brackets(step.selectors, inFilter);
+						} else if (pos < text.size() && text[pos] == '*') {
+							++pos;
+							step.selectors.emplace_back();
+						} else {
+							step.selectors.push_back(keySelector(name()));
+						}
+					} else if (text[pos] == '.') {
+						++pos;
+						if (pos < text.size() && text[pos] == '*' && !inFilter) {
+							++pos;
+							step.selectors.emplace_back();
+						} else {
+							step.selectors.push_back(keySelector(name()));
+						}
+					} else if (text[pos] == '[') {
+						++pos;
+						brackets(step.selectors, inFilter);
+					} else {
+						return;
+					}
+					steps.push_back(std::move(step));
+				}
+			}
+
+			void brackets (std::vector<Selector> &selectors, const bool inFilter) {
+				do {
+					skipSpaces();
+					if (pos >= text.size()) fail("unterminated brackets");
+
+					if (text[pos] == '\'' || text[pos] == '"') {
+						selectors.push_back(keySelector(quoted()));
+					} else if (text[pos] == '*' && !inFilter) {
+						++pos;
+						selectors.emplace_back();
+					} else if (text[pos] == '?' && !inFilter) {
+						++pos;
+						expect('(');
+						Selector selector;
+						selector.kind = Selector::Kind::Filter;
+						selector.filter = orExpression();
+						expect(')');
+						selectors.push_back(std::move(selector));
+					} else {
+						Selector selector;
+						selector.kind = Selector::Kind::Index;
+						selector.hasStart = integer(selector.index);
+						if (consume(':')) {
+							if (inFilter) fail("slices are not supported in filters");
+							selector.kind = Selector::Kind::Slice;
+							selector.hasEnd = integer(selector.end);
+							if (consume(':') && !integer(selector.step)) fail("expected a step");
+							if (selector.step == 0) fail("slice step cannot be zero");
+						} else if (!selector.hasStart) {
+							fail("expected an index, name, slice, * or filter");
+						}
+						selectors.push_back(std::move(selector));
+					}
+				} while (!inFilter && consume(','));
+				expect(']');
+			}
+
+			uint32_t addNode (FilterNode node) {
+				query._filters.push_back(std::move(node));
+				return static_cast<uint32_t>(query._filters.size() - 1);
+			}
+
+			uint32_t orExpression () {
+				uint32_t left = andExpression();
+				while (consume(std::string_view("||"))) {
+					FilterNode node;
+					node.kind = FilterNode::Kind::Or;
+					node.left = left;
+					node.right = andExpression();
+					left = addNode(std::move(node));
+				}
+				return left;
+			}
+
+			uint32_t andExpression () {
+				uint32_t left = unaryExpression();
+				while (consume(std::string_view("&&"))) {
+					FilterNode node;
+					node.kind = FilterNode::Kind::And;
+					node.left = left;
+					node.right = unaryExpression();
+					left = addNode(std::move(node));
+				}
+				return left;
+			}
+
+			uint32_t unaryExpression () {
+				if (consume('!')) {
+					FilterNode node;
+					node.kind = FilterNode::Kind::Not;
+					node.left = unaryExpression();
+					return addNode(std::move(node));
+				}
+
+				const uint32_t left = operand();
+				Compare compare = Compare::None;
+				if (consume(std::string_view("=="))) compare = Compare::Equal;
+				else if (consume(std::string_view("!="))) compare = Compare::NotEqual;
+				else if (consume(std::string_view("<="))) compare = Compare::LessEqual;
+				else if (consume(std::string_view(">="))) compare = Compare::GreaterEqual;
+				else if (consume('<')) compare = Compare::Less;
+				else if (consume('>')) compare = Compare::Greater;
+				if (compare == Compare::None) return left;
+
+				FilterNode node;
+				node.kind = FilterNode::Kind::Compare;
+				node.compare = compare;
+				node.left = left;
+				node.right = operand();
+				return addNode(std::move(node));
+			}
+
+			uint32_t operand () {
+				skipSpaces();
+				if (pos >= text.size()) fail("expected a value");
+
+				FilterNode node;
+				const char c = text[pos];
+
+				if (c == '(') {
+					++pos;
+					const uint32_t inner = orExpression();
+					expect(')');
+					return inner;
+				}
+
+				if (c == '@' || c == '$') {
+					++pos;
+					node.kind = c == '@' ? FilterNode::Kind::Current : FilterNode::Kind::Root;
+					std::vector<Step> steps;
+					parsePath(steps, true);
+					for (auto &step : steps) node.path.push_back(std::move(step.selectors.front()));
+				} else if (c == '\'' || c == '"') {
+					node.literal = DynaVal(quoted());
+				} else if (consume(std::string_view("true"))) {
+					node.literal = DynaVal(true);
+				} else if (consume(std::string_view("false"))) {
+					node.literal = DynaVal(false);
+				} else if (consume(std::string_view("null"))) {
+					node.literal.becomeNull();
+				} else {
+					DynaJsonReader reader(std::string_view(text).substr(pos));
+#ifdef DYNAVAL_NO_EXCEPTIONS
+					const DynaJsonNumber number = reader.readNumber();
+					if (reader.failed()) fail("expected a value");
+#else
+					DynaJsonNumber number;
+					try {
+						number = reader.readNumber();
+					} catch (const std::runtime_error &) {
+						fail("expected a value");
+					}
+#endif
+					node.literal.type = number.type;
+					node.literal.number = number.value;
+					pos += reader.position();
+				}
+
+				return addNode(std::move(node));
+			}
+		};
+
+		static const DynaVal *_child (const DynaVal &node, const Selector &selector) {
+			if (selector.kind == Selector::Kind::Key) {
+				if (!node.isObject() || !node.object) return nullptr;
+				const auto it = node.object->find(selector.key);
+				return it == node.object->end() ? nullptr : &it->second;
+			}
+
+			if (!node.isArray() || !node.array) return nullptr;
+			const auto size = static_cast<int64_t>(node.array->size());
+			const int64_t index = selector.index < 0 ? selector.index + size : selector.index;
+			return index >= 0 && index < size ? &(*node.array)[static_cast<size_t>(index)] : nullptr;
+		}
+
+		[[nodiscard]] const DynaVal *_resolve (const FilterNode &node, const DynaVal &current, const DynaVal &root) const {
+			if (node.kind == FilterNode::Kind::Literal) return &node.literal;
+
+			const DynaVal *value = node.kind == FilterNode::Kind::Current ? &current : &root;
+			for (const auto &selector : node.path) {
+				value = _child(*value, selector);
+				if (!value) return nullptr;
+			}
+			return value;
+		}
+
+		static bool _compare (const Compare compare, const DynaVal *left, const DynaVal *right) {
+			if (!left || !right) return compare == Compare::NotEqual && left != right;
+
+			if (compare == Compare::Equal) return left->equals(*right);
+			if (compare == Compare::NotEqual) return !left->equals(*right);
+
+			int order;
+			if (left->isNumber() && right->isNumber()) {
+				if (left->number != left->number || right->number != right->number) return false;
+				order = left->number < right->number ? -1 : left->number > right->number ? 1 : 0;
+			} else if (left->isString() && right->isString()) {
+				order = left->string.compare(right->string);
+			} else {
+				return false;
+			}
+
+			switch (compare) {
+				case Compare::Less: return order < 0;
+				case Compare::LessEqual: return order <= 0;
+				case Compare::Greater: return order > 0;
+				default: return order >= 0;
+			}
+		}
+
+		[[nodiscard]] bool _test (const uint32_t index, const DynaVal &current, const DynaVal &root) const {
+			const FilterNode &node = _filters[index];
+
+			switch (node.kind) {
+				case FilterNode::Kind::And:
+					return _test(node.left, current, root) && _test(node.right, current, root);
+				case FilterNode::Kind::Or:
+					return _test(node.left, current, root) || _test(node.right, current, root);
+				case FilterNode::Kind::Not:
+					return !_test(node.left, current, root);
+				case FilterNode::Kind::Compare:
+					return _compare(node.compare, _resolve(_filters[node.left], current, root),
+						_resolve(_filters[node.right], current, root));
+				case FilterNode::Kind::Literal:
+					return !node.literal.isFalsy();
+				default:
+					return _resolve(node, current, root) != nullptr;
+			}
+		}
+
+		template <typename Fn>
+		static bool _emit (Fn &fn, const DynaVal &match) {
+			if constexpr (std::is_same_v<std::invoke_result_t<Fn &, const DynaVal &>, bool>) {
+				return fn(match);
+			} else {
+				fn(match);
+				return true;
+			}
+		}
+
+		// Applies one selector to node and continues with the next step, false once the callback stops
+		template <typename Fn>
+		bool _select (const DynaVal &node, const Selector &selector, const size_t next, const DynaVal &root, Fn &fn) const {
+			switch (selector.kind) {
+				case Selector::Kind::Key:
+				case Selector::Kind::Index: {
+					const DynaVal *child = _child(node, selector);
+					return !child || _walk(*child, next, root, fn);
+				}
+				case Selector::Kind::Wildcard:
+				case Selector::Kind::Filter: {
+					const bool filter = selector.kind == Selector::Kind::Filter;
+					if (node.isArray() && node.array) {
+						for (const auto &child : *node.array) {
+							if (filter && !_test(selector.filter, child, root)) continue;
+							if (!_walk(child, next, root, fn)) return false;
+						}
+					} else if (node.isObject() && node.object) {
+						for (const auto &[key, child] : *node.object) {
+							if (filter && !_test(selector.filter, child, root)) continue;
+							if (!_walk(child, next, root, fn)) return false;
+						}
+					}
+					return true;
+				}
+				case Selector::Kind::Slice: {
+					if (!node.isArray() || !node.array) return true;
+					const auto size = static_cast<int64_t>(node.array->size());
+					const auto clamp = [size](int64_t value, const int64_t low, const int64_t high) {
+						if (value < 0) value += size;
+						return value < low ? low : value > high ? high : value;
+					};
+
+					if (selector.step > 0) {
+						const int64_t start = selector.hasStart ? clamp(selector.index, 0, size) : 0;
+						const int64_t end = selector.hasEnd ? clamp(selector.end, 0, size) : size;
+						for (int64_t i = start; i < end; i += selector.step) {
+							if (!_walk((*node.array)[static_cast<size_t>(i)], next, root, fn)) return false;
+						}
+					} else {
+						const int64_t start = selector.hasStart ? clamp(selector.index, -1, size - 1) : size - 1;
+						const int64_t end = selector.hasEnd ? clamp(selector.end, -1, size - 1) : -1;
+						for (int64_t i = start; i > end; i += selector.step) {
+							if (!_walk((*node.array)[static_cast<size_t>(i)], next, root, fn)) return false;
+						}
+					}
+					return true;
+				}
+			}
+			return true;
+		}
+
+		template <typename Fn>
+		bool _walk (const DynaVal &node, const size_t stepIndex, const DynaVal &root, Fn &fn) const {
+			if (stepIndex == _steps.size()) return _emit(fn, node);
+
+			const Step &step = _steps[stepIndex];
+			for (const auto &selector : step.selectors) {
+				if (!_select(node, selector, stepIndex + 1, root, fn)) return false;
+			}
+
+			if (!step.recursive) return true;
+
+			// Recursive descent applies the same step again to every descendant
+			if (node.isArray() && node.array) {
+				for (const auto &child : *node.array) {
+					if (!_walk(child, stepIndex, root, fn)) return false;
+				}
+			} else if (node.isObject() && node.object) {
+				for (const auto &[key, child] : *node.object) {
+					if (!_walk(child, stepIndex, root, fn)) return false;
+				}
+			}
+			return true;
+		}
+	};
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "DynaVal.h"
+
+namespace Irrelon {
+	class DynaSlice;
+
+	/**
+	 * A non-owning, read-only handle to a value inside a DynaVal tree. It
+	 * is one pointer: copying it touches no reference counts, and looking
+	 * up a missing key or index yields an empty ref instead of creating
+	 * the entry the way non-const DynaVal::operator[] does.
+	 *
+	 *   void report (Irrelon::DynaRef device) {
+	 *       if (device["meta"]["rssi"].toInt() < -80) ...
+	 *   }
+	 *
+	 * An empty ref reads as null. The tree must outlive the ref and must
+	 * not be restructured while it is in use, as with any pointer into a
+	 * container.
+	 */
+	class DynaRef {
+	public:
+		DynaRef () = default;
+
+		DynaRef (const DynaVal &val) : _val(&val) {}
+
+		// A ref to a temporary would dangle as soon as the full expression ends
+		DynaRef (const DynaVal &&) = delete;
+
+		// True when the ref points at a value, even a null one
+		[[nodiscard]] bool exists () const { return _val != nullptr; }
+
+		explicit operator bool () const { return exists(); }
+
+		// The value, nullptr for an empty ref
+		[[nodiscard]] const DynaVal *get () const { return _val; }
+
+		// The value, a shared null for an empty ref
+		[[nodiscard]] const DynaVal &value () const { return _val ? *_val : _null(); }
+
+		[[nodiscard]] DynaValType type () const { return value().type; }
+		[[nodiscard]] bool isNull () const { return value().isNull(); }
+		[[nodiscard]] bool isUndefined () const { return value().isUndefined(); }
+		[[nodiscard]] bool isError () const { return value().isError(); }
+		[[nodiscard]] bool isNumber () const { return value().isNumber(); }
+		[[nodiscard]] bool isBool () const { return value().isBool(); }
+		[[nodiscard]] bool isString () const { return value().isString(); }
+		[[nodiscard]] bool isArray () const { return value().isArray(); }
+		[[nodiscard]] bool isObject () const { return value().isObject(); }
+
+		[[nodiscard]] int toInt (const bool looseType = false) const { return value().toInt(looseType); }
+		[[nodiscard]] uint toUInt (const bool looseType = false) const { return value().toUInt(looseType); }
+		[[nodiscard]] long toLong (const bool looseType = false) const { return value().toLong(looseType); }
+		[[nodiscard]] float toFloat (const bool looseType = false) const { return value().toFloat(looseType); }
+		[[nodiscard]] double toDouble (const bool looseType = false) const { return value().toDouble(looseType); }
+		[[nodiscard]] bool toBool (const bool looseType = false) const { return value().toBool(looseType); }
+		[[nodiscard]] std::string toString () const { return value().toString(); }
+
+		// The string's bytes without copying them, empty for anything but a string
+		[[nodiscard]] std::string_view toStringView () const { return value().toStringView(); }
+
+		[[nodiscard]] size_t size () const { return value().size(); }
+
+		[[nodiscard]] bool containsKey (const std::string &key) const { return value().containsKey(key); }
+
+		[[nodiscard]] DynaRef operator[] (const std::string &key) const {
+			if (!isObject() || !_val->object) return {};
+			const auto it = _val->object->find(key);
+			return it == _val->object->end() ? DynaRef() : DynaRef(it->second);
+		}
+
+		[[nodiscard]] DynaRef operator[] (const char *key) const { return (*this)[std::string(key)]; }
+
+		[[nodiscard]] DynaRef operator[] (const size_t index) const {
+			if (!isArray() || !_val->array || index >= _val->array->size()) return {};
+			return DynaRef((*_val->array)[index]);
+		}
+
+		// Negative indexes give an empty ref
+		[[nodiscard]] DynaRef operator[] (const int index) const {
+			return index < 0 ? DynaRef() : (*this)[static_cast<size_t>(index)];
+		}
+
+		// Every element of an array, an empty slice for anything else
+		[[nodiscard]] DynaSlice items () const;
+
+		// Elements [begin, end) of an array, clamped to its size
+		[[nodiscard]] DynaSlice slice (size_t begin, size_t end) const;
+
+		// Calls fn(key, DynaRef) for each entry of an object
+		template <typename Fn>
+		void forEachEntry (Fn &&fn) const {
+			if (!isObject() || !_val->object) return;
+			for (const auto &[key, val] : *_val->object) fn(key, DynaRef(val));
+		}
+
+		[[nodiscard]] std::string toJson () const { return value().toJson(); }
+
+		// A DynaVal handle to the value, sharing its storage
+		[[nodiscard]] DynaVal toDynaVal () const { return value(); }
+
+	private:
+		const DynaVal *_val = nullptr;
+
+		static const DynaVal &_null () {
+			static const DynaVal null;
+			return null;
+		}
+	};
+
+	/**
+	 * A non-owning view of a contiguous run of array elements: a pointer
+	 * and a count. Slicing a slice narrows the view without copying, and
+	 * serializing writes only the elements in view. The same lifetime
+	 * rules as DynaRef apply; anything that grows or shrinks the array
+	 * invalidates the slice.
+	 */
+	class DynaSlice {
+	public:
+		DynaSlice () = default;
+
+		DynaSlice (const DynaVal *first, const size_t count) : _first(first), _count(first ? count : 0) {}
+
+		[[nodiscard]] size_t size () const { return _count; }
+
+		[[nodiscard]] bool empty () const { return _count == 0; }
+
+		// Out of range indexes give an empty ref
+		[[nodiscard]] DynaRef operator[] (const size_t index) const {
+			return index < _count ? DynaRef(_first[index]) : DynaRef();
+		}
+
+		[[nodiscard]] const DynaVal *begin () const { return _first; }
+
+		[[nodiscard]] const DynaVal *end () const { return _first + _count; }
+
+		// Elements [begin, end) of this slice, clamped to its size
+		[[nodiscard]] DynaSlice slice (size_t begin, size_t end) const {
+			end = std::min(end, _count);
+			begin = std::min(begin, end);
+			return {_first + begin, end - begin};
+		}
+
+		[[nodiscard]] std::string toJson () const {
+			std::ostringstream out;
+			out << '[';
+			for (size_t i = 0; i < _count; ++i) {
+				if (i) out << ',';
+				_first[i].toJson(out);
+			}
+			out << ']';
+			return out.str();
+		}
+
+		// A new array holding the elements in view, sharing their storage
+		[[nodiscard]] DynaVal toDynaVal () const {
+			DynaValArray out(begin(), end());
+			return DynaVal(std::move(out));
+		}
+
+	private:
+		const DynaVal *_first = nullptr;
+		size_t _count = 0;
+	};
+
+	inline DynaSlice DynaRef::items () const {
+		if (!isArray() || !_val->array) return {};
+		return {_val->array->data(), _val->array->size()};
+	}
+
+	inline DynaSlice DynaRef::slice (const size_t begin, const size_t end) const {
+		return items().slice(begin, end);
+	}
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <sstream>
+#include <string>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * A bounded first-in first-out window of values for rolling telemetry
+	 * queues. push() appends and, once the ring is full, drops the oldest
+	 * value; shift() and pop() take from either end. All three are O(1)
+	 * where shifting a DynaVal array moves every remaining element.
+	 *
+	 *   Irrelon::DynaRing window(600);
+	 *   window.push(sample);
+	 *   const std::string json = window.toJson(); // oldest first
+	 *
+	 * Slots are allocated once, up front. Indexes are logical: 0 is the
+	 * oldest value and size() - 1 the newest.
+	 */
+	class DynaRing {
+	public:
+		class Iterator {
+		public:
+			Iterator (const DynaRing *ring, const size_t index) : _ring(ring), _index(index) {}
+
+			const DynaVal &operator* () const { return (*_ring)[_index]; }
+			const DynaVal *operator-> () const { return &(*_ring)[_index]; }
+
+			Iterator &operator++ () {
+				++_index;
+				return *this;
+			}
+
+			bool operator== (const Iterator &other) const { return _index == other._index; }
+			bool operator!= (const Iterator &other) const { return _index != other._index; }
+
+		private:
+			const DynaRing *_ring;
+			size_t _index;
+		};
+
+		explicit DynaRing (const size_t capacity) : _slots(capacity) {
+			if (!capacity) detail::dynaThrow("DynaRing capacity must be at least 1");
+		}
+
+		// A ring holding the last capacity elements of an array
+		static DynaRing fromArray (const DynaVal &arr, const size_t capacity) {
+			DynaRing ring(capacity);
+			if (!arr.isArray() || !arr.array) return ring;
+			const size_t count = arr.array->size();
+			for (size_t i = count > capacity ? count - capacity : 0; i < count; ++i) ring.push((*arr.array)[i]);
+			return ring;
+		}
+
+		[[nodiscard]] size_t size () const { return _size; }
+
+		[[nodiscard]] size_t capacity () const { return _slots.size(); }
+
+		[[nodiscard]] bool empty () const { return _size == 0; }
+
+		[[nodiscard]] bool full () const { return _size == _slots.size(); }
+
+		// Appends value, dropping the oldest when full, and returns the stored value
+		DynaVal &push (DynaVal value) {
+			DynaVal &slot = _slots[_physical(_size == _slots.size() ? 0 : _size)];
+			if (_size == _slots.size()) _head = _physical(1);
+			else ++_size;
+			slot = std::move(value);
+			return slot;
+		}
+
+		// Removes and returns the oldest value, undefined when empty
+		DynaVal shift () {
+			DynaVal out;
+			if (!_size) return out.becomeUndefined();
+			out = std::move(_slots[_head]);
+			_slots[_head] = DynaVal();
+			_head = _physical(1);
+			--_size;
+			return out;
+		}
+
+		// Removes and returns the newest value, undefined when empty
+		DynaVal pop () {
+			DynaVal out;
+			if (!_size) return out.becomeUndefined();
+			DynaVal &slot = _slots[_physical(_size - 1)];
+			out = std::move(slot);
+			slot = DynaVal();
+			--_size;
+			return out;
+		}
+
+		// The value at a logical index, throws when out of range
+		DynaVal &operator[] (const size_t index) {
+			if (index >= _size) detail::dynaThrow("DynaRing index out of range");
+			return _slots[_physical(index)];
+		}
+
+		// The value at a logical index, a shared null when out of range
+		const DynaVal &operator[] (const size_t index) const {
+			static const DynaVal nullValue;
+			return index < _size ? _slots[_physical(index)] : nullValue;
+		}
+
+		[[nodiscard]] const DynaVal &front () const { return (*this)[0]; }
+
+		[[nodiscard]] const DynaVal &back () const { return (*this)[_size ? _size - 1 : 0]; }
+
+		void clear () {
+			for (size_t i = 0; i < _size; ++i) _slots[_physical(i)] = DynaVal();
+			_head = 0;
+			_size = 0;
+		}
+
+		[[nodiscard]] Iterator begin () const { return {this, 0}; }
+
+		[[nodiscard]] Iterator end () const { return {this, _size}; }
+
+		// Serializes oldest first, as an array
+		[[nodiscard]] std::string toJson () const {
+			std::ostringstream out;
+			out << '[';
+			for (size_t i = 0; i < _size; ++i) {
+				if (i) out << ',';
+				_slots[_physical(i)].toJson(out);
+			}
+			out << ']';
+			return out.str();
+		}
+
+		// The values oldest first as an array, sharing their storage
+		[[nodiscard]] DynaVal toDynaVal () const {
+			DynaValArray out;
+			out.reserve(_size);
+			for (size_t i = 0; i < _size; ++i) out.push_back(_slots[_physical(i)]);
+			return DynaVal(std::move(out));
+		}
+
+	private:
+		DynaValArray _slots;
+		size_t _head = 0;
+		size_t _size = 0;
+
+		[[nodiscard]] size_t _physical (const size_t index) const {
+			const size_t at = _head + index;
+			return at < _slots.size() ? at : at - _slots.size();
+		}
+	};
+}
@@ -0,0 +1,510 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "DynaError.h"
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * A validator compiled once from a type descriptor and reused for every
+	 * value. Two descriptor forms are accepted:
+	 *
+	 * - makeType()/makeParam() nodes. An array of params describes an
+	 *   object: IDENTIFIER params are required keys and ASSIGNMENT_PATTERN
+	 *   params are optional keys with a default. A DATA_TYPE of "array"
+	 *   takes its element type from subType, and one of "object" takes its
+	 *   keys from a subType array of params. Integer types accept any number
+	 *   with an integral value, so parsed JSON validates as expected.
+	 *
+	 * - A JSON Schema subset: type, properties, required, default,
+	 *   additionalProperties, items, enum, minimum, maximum,
+	 *   exclusiveMinimum, exclusiveMaximum, minLength, maxLength, minItems
+	 *   and maxItems.
+	 *
+	 * Compiling flattens the descriptor into a node table with key hashes
+	 * computed up front, so validation walks each object's entries once
+	 * instead of interpreting the descriptor tree. Errors are DynaErrors
+	 * with status 422 and the dot path of the offending value in key.
+	 * A malformed descriptor throws std::runtime_error from the factory.
+	 */
+	class DynaSchema {
+	public:
+		// Compiles makeType() / makeParam() nodes, or an array of params describing an object
+		static DynaSchema fromDescriptor (const DynaVal &descriptor) {
+			DynaSchema schema;
+			schema._compileDescriptor(descriptor);
+			return schema;
+		}
+
+		static DynaSchema fromJsonSchema (const DynaVal &jsonSchema) {
+			DynaSchema schema;
+			schema._compileJsonSchema(jsonSchema);
+			return schema;
+		}
+
+		// Checks value without changing it, an empty result means it is valid
+		[[nodiscard]] std::vector<DynaError> validate (const DynaVal &value) const {
+			Context context;
+			_validate(value, 0, context);
+			return std::move(context.errors);
+		}
+
+		// Checks value and inserts the defaults of missing optional keys
+		std::vector<DynaError> validateAndFill (DynaVal &value) const {
+			Context context;
+			_validate(value, 0, context);
+			return std::move(context.errors);
+		}
+
+		[[nodiscard]] bool isValid (const DynaVal &value) const {
+			return validate(value).empty();
+		}
+
+	private:
+		static constexpr int32_t kAdditionalAllowed = -1;
+		static constexpr int32_t kAdditionalForbidden = -2;
+
+		struct Node {
+			// Bit per DynaValType, 0 accepts anything
+			uint32_t typeMask = 0;
+			bool integerOnly = false;
+			bool unsignedOnly = false;
+			// Inclusive and exclusive bounds are kept apart so a schema may give both
+			bool hasMinimum = false;
+			bool hasMaximum = false;
+			bool hasExclusiveMinimum = false;
+			bool hasExclusiveMaximum = false;
+			double minimum = 0;
+			double maximum = 0;
+			double exclusiveMinimum = 0;
+			double exclusiveMaximum = 0;
+			// String length in code points, or array item count
+			size_t minLength = 0;
+			size_t maxLength = SIZE_MAX;
+			uint32_t firstProperty = 0;
+			uint32_t propertyCount = 0;
+			int32_t items = -1;
+			int32_t additional = kAdditionalAllowed;
+			uint32_t firstEnum = 0;
+			uint32_t enumCount = 0;
+		};
+
+		struct Property {
+			size_t hash = 0;
+			std::string key;
+			uint32_t node = 0;
+			bool required = false;
+			bool hasDefault = false;
+			DynaVal defaultValue;
+		};
+
+		struct PathPart {
+			std::string_view key;
+			size_t index;
+		};
+
+		struct Context {
+			std::vector<DynaError> errors;
+			std::vector<PathPart> path;
+			std::vector<uint8_t> seen;
+		};
+
+		std::vector<Node> _nodes;
+		std::vector<Property> _properties;
+		std::vector<DynaVal> _enums;
+
+		static size_t _hash (const std::string_view key) {
+			return std::hash<std::string_view>{}(key);
+		}
+
+		static constexpr uint32_t _bit (const DynaValType type) {
+			return 1u << static_cast<uint32_t>(type);
+		}
+
+		static constexpr uint32_t _numberBits () {
+			return _bit(DynaValType::Int) | _bit(DynaValType::UInt) | _bit(DynaValType::Float) |
+				_bit(DynaValType::Double) | _bit(DynaValType::Long);
+		}
+
+		uint32_t _addNode () {
+			_nodes.emplace_back();
+			return static_cast<uint32_t>(_nodes.size() - 1);
+		}
+
+		// Reserves a contiguous property range for node, filled in by the caller
+		uint32_t _reserveProperties (const uint32_t node, const size_t count) {
+			const auto first = static_cast<uint32_t>(_properties.size());
+			_properties.resize(_properties.size() + count);
+			_nodes[node].firstProperty = first;
+			_nodes[node].propertyCount = static_cast<uint32_t>(count);
+			return first;
+		}
+
+		// Sorts a node's properties by hash so lookups can binary search
+		void _sortProperties (const uint32_t node) {
+			const auto begin = _properties.begin() + _nodes[node].firstProperty;
+			std::sort(begin, begin + _nodes[node].propertyCount, [](const Property &a, const Property &b) {
+				return a.hash < b.hash;
+			});
+		}
+
+		void _setDescriptorType (const uint32_t node, const std::string &name) {
+			Node &target = _nodes[node];
+			if (name == "any") {
+				target.typeMask = 0;
+			} else if (name == "int" || name == "long") {
+				target.typeMask = _numberBits();
+				target.integerOnly = true;
+			} else if (name == "u_int") {
+				target.typeMask = _numberBits();
+				target.integerOnly = true;
+				target.unsignedOnly = true;
+			} else if (name == "float" || name == "double") {
+				target.typeMask = _numberBits();
+			} else if (name == "boolean") {
+				target.typeMask = _bit(DynaValType::Bool);
+			} else if (name == "string") {
+				target.typeMask = _bit(DynaValType::String);
+			} else if (name == "array") {
+				target.typeMask = _bit(DynaValType::Array);
+			} else if (name == "object") {
+				target.typeMask = _bit(DynaValType::Object);
+			} else if (name == "null") {
+				target.typeMask = _bit(DynaValType::Null);
+			} else if (name == "undefined") {
+				target.typeMask = _bit(DynaValType::Undefined);
+			} else if (name == "error") {
+				target.typeMask = _bit(DynaValType::Error);
+			} else {
+				detail::dynaThrow("Unknown type \"" + name + "\" in schema descriptor");
+			}
+		}
+
+		uint32_t _compileDescriptor (const DynaVal &descriptor) {
+			if (descriptor.isArray()) return _compileParams(descriptor);
+
+			const DynaVal &kind = descriptor["kind"];
+			if (kind == "IDENTIFIER" || kind == "ASSIGNMENT_PATTERN") {
+				DynaVal params;
+				params.push(descriptor);
+				return _compileParams(params);
+			}
+
+			if (kind != "DATA_TYPE" || !descriptor["value"].isString()) {
+				detail::dynaThrow("Schema descriptor must be a DATA_TYPE node or a list of params");
+			}
+
+			const uint32_t node = _addNode();
+			_setDescriptorType(node, descriptor["value"].string);
+
+			const DynaVal &subType = descriptor["subType"];
+			if (!subType.isNull()) {
+				if (descriptor["value"] == "array") {
+					const int32_t items = static_cast<int32_t>(_compileDescriptor(subType));
+					_nodes[node].items = items;
+				} else if (descriptor["value"] == "object" && subType.isArray()) {
+					_compileParamsInto(subType, node);
+				}
+			}
+
+			return node;
+		}
+
+		uint32_t _compileParams (const DynaVal &params) {
+			const uint32_t node = _addNode();
+			_nodes[node].typeMask = _bit(DynaValType::Object);
+			_compileParamsInto(params, node);
+			return node;
+		}
+
+		void _compileParamsInto (const DynaVal &params, const uint32_t node) {
+			const uint32_t first = _reserveProperties(node, params.size());
+
+			for (size_t i = 0; i < params.size(); ++i) {
+				const DynaVal &param = params[i];
+				const bool isPattern = param["kind"] == "ASSIGNMENT_PATTERN";
+				const DynaVal &identifier = isPattern ? param["left"] : param;
+
+				if (identifier["kind"] != "IDENTIFIER" || !identifier["value"].isString()) {
+					detail::dynaThrow("Schema params must be IDENTIFIER or ASSIGNMENT_PATTERN nodes");
+				}
+
+				const uint32_t child = identifier["type"].isNull() ? _addNode() : _compileDescriptor(identifier["type"]);
+
+				Property &property = _properties[first + i];
+				property.key = identifier["value"].string;
+				property.hash = _hash(property.key);
+				property.node = child;
+				property.required = !isPattern;
+				if (isPattern) {
+					const DynaVal &right = param["right"];
+					property.hasDefault = true;
+					property.defaultValue = right["kind"] == "LITERAL" ? right["value"] : right;
+				}
+			}
+
+			_sortProperties(node);
+		}
+
+		uint32_t _compileJsonSchema (const DynaVal &schema) {
+			if (!schema.isObject()) detail::dynaThrow("JSON Schema must be an object");
+
+			const uint32_t node = _addNode();
+
+			const DynaVal &type = schema["type"];
+			if (type.isString() || type.isArray()) {
+				const size_t count = type.isString() ? 1 : type.size();
+				bool number = false;
+				bool integer = false;
+				for (size_t i = 0; i < count; ++i) {
+					const DynaVal &name = type.isString() ? type : type[i];
+					if (name == "number") number = true;
+					else if (name == "integer") integer = true;
+					else if (name == "string") _nodes[node].typeMask |= _bit(DynaValType::String);
+					else if (name == "boolean") _nodes[node].typeMask |= _bit(DynaValType::Bool);
+					else if (name == "object") _nodes[node].typeMask |= _bit(DynaValType::Object);
+					else if (name == "array") _nodes[node].typeMask |= _bit(DynaValType::Array);
+					else if (name == "null") _nodes[node].typeMask |= _bit(DynaValType::Null);
+					else detail::dynaThrow("Unknown JSON Schema type " + name.toJson());
+				}
+				if (number || integer) _nodes[node].typeMask |= _numberBits();
+				_nodes[node].integerOnly = integer && !number;
+			}
+
+			const auto readNumber = [&schema](const char *key, bool &has, double &out) {
+				if (!schema[key].isNumber()) return;
+				has = true;
+				out = schema[key].number;
+			};
+			readNumber("minimum", _nodes[node].hasMinimum, _nodes[node].minimum);
+			readNumber("maximum", _nodes[node].hasMaximum, _nodes[node].maximum);
+			readNumber("exclusiveMinimum", _nodes[node].hasExclusiveMinimum, _nodes[node].exclusiveMinimum);
+			readNumber("exclusiveMaximum", _nodes[node].hasExclusiveMaximum, _nodes[node].exclusiveMaximum);
+
+			for (const char *key : {"minLength", "minItems"}) {
+				if (schema[key].isNumber()) _nodes[node].minLength = static_cast<size_t>(schema[key].number);
+			}
+			for (const char *key : {"maxLength", "maxItems"}) {
+				if (schema[key].isNumber()) _nodes[node].maxLength = static_cast<size_t>(schema[key].number);
+			}
+
+			const DynaVal &enumValues = schema["enum"];
+			if (enumValues.isArray()) {
+				_nodes[node].firstEnum = static_cast<uint32_t>(_enums.size());
+				_nodes[node].enumCount = static_cast<uint32_t>(enumValues.size());
+				for (size_t i = 0; i < enumValues.size(); ++i) _enums.push_back(enumValues[i]);
+			}
+
+			if (schema.containsKey("items")) {
+				const int32_t items = static_cast<int32_t>(_compileJsonSchema(schema["items"]));
+				_nodes[node].items = items;
+			}
+
+			const DynaVal &additional = schema["additionalProperties"];
+			if (additional.isBool()) {
+				_nodes[node].additional = additional.boolean ? kAdditionalAllowed : kAdditionalForbidden;
+			} else if (additional.isObject()) {
+				const int32_t extra = static_cast<int32_t>(_compileJsonSchema(additional));
+				_nodes[node].additional = extra;
+			}
+
+			// Keys listed in required but not in properties get an unconstrained entry
+			std::vector<std::string> keys;
+			const DynaVal &properties = schema["properties"];
+			if (properties.isObject() && properties.object) {
+				for (const auto &[key, val] : *properties.object) keys.push_back(key);
+			}
+			const DynaVal &required = schema["required"];
+			for (size_t i = 0; i < required.size(); ++i) {
+				if (required[i].isString() && std::find(keys.begin(), keys.end(), required[i].string) == keys.end()) {
+					keys.push_back(required[i].string);
+				}
+			}
+
+			if (!keys.empty()) {
+				const uint32_t first = _reserveProperties(node, keys.size());
+				for (size_t i = 0; i < keys.size(); ++i) {
+					const DynaVal &propertySchema = properties[keys[i]];
+					const uint32_t child = propertySchema.isObject() ? _compileJsonSchema(propertySchema) : _addNode();
+
+					Property &property = _properties[first + i];
+					property.key = keys[i];
+					property.hash = _hash(property.key);
+					property.node = child;
+					for (size_t r = 0; r < required.size(); ++r) {
+						if (required[r] == keys[i]) property.required = true;
+					}
+					if (propertySchema.containsKey("default")) {
+						property.hasDefault = true;
+						property.defaultValue = propertySchema["default"];
+					}
+				}
+				_sortProperties(node);
+			}
+
+			return node;
+		}
+
+		static std::string _typeNames (const Node &node) {
+			std::string out;
+			const auto add = [&out](const std::string &name) {
+				if (!out.empty()) out += " or ";
+				out += name;
+			};
+
+			if (node.typeMask & _numberBits()) add(node.unsignedOnly ? "unsigned integer" : node.integerOnly ? "integer" : "number");
+			for (const DynaValType type : {
+				DynaValType::Bool, DynaValType::String, DynaValType::Array, DynaValType::Object,
+				DynaValType::Null, DynaValType::Undefined, DynaValType::Error
+			}) {
+				if (node.typeMask & _bit(type)) add(dynaValTypeToString(type));
+			}
+
+			return out;
+		}
+
+		static void _fail (Context &context, const std::string &message) {
+			std::string path;
+			for (const auto &part : context.path) {
+				if (!path.empty()) path += '.';
+				if (part.key.data()) path += part.key;
+				else path += std::to_string(part.index);
+			}
+
+			DynaError error(message, 422);
+			error.key = std::move(path);
+			context.errors.push_back(std::move(error));
+		}
+
+		static size_t _codePoints (const std::string &text) {
+			size_t count = 0;
+			for (const char c : text) {
+				if ((static_cast<unsigned char>(c) & 0xc0) != 0x80) ++count;
+			}
+			return count;
+		}
+
+		[[nodiscard]] const Property *_findProperty (const Node &node, const std::string &key) const {
+			const auto begin = _properties.begin() + node.firstProperty;
+			const auto end = begin + node.propertyCount;
+			const size_t hash = _hash(key);
+
+			for (auto it = std::lower_bound(begin, end, hash, [](const Property &p, const size_t h) { return p.hash < h; });
+				it != end && it->hash == hash; ++it) {
+				if (it->key == key) return &*it;
+			}
+
+			return nullptr;
+		}
+
+		// Value is const DynaVal for validate(), and DynaVal for validateAndFill() which inserts defaults
+		template <typename Value>
+		void _validate (Value &value, const uint32_t index, Context &context) const {
+			const Node &node = _nodes[index];
+
+			if (node.typeMask && !(node.typeMask & _bit(value.type))) {
+				_fail(context, "expected " + _typeNames(node));
+				return;
+			}
+
+			if (node.enumCount) {
+				bool found = false;
+				for (uint32_t i = 0; i < node.enumCount && !found; ++i) found = _enums[node.firstEnum + i].equals(value);
+				if (!found) _fail(context, "not one of the allowed values");
+			}
+
+			if (value.isNumber()) {
+				const double number = value.number;
+				if (node.integerOnly && (!std::isfinite(number) || std::floor(number) != number)) _fail(context, "expected an integer");
+				if (node.unsignedOnly && number < 0) _fail(context, "expected an unsigned integer");
+				if ((node.hasMinimum && number < node.minimum) || (node.hasExclusiveMinimum && number <= node.exclusiveMinimum)) {
+					_fail(context, "below the minimum");
+				}
+				if ((node.hasMaximum && number > node.maximum) || (node.hasExclusiveMaximum && number >= node.exclusiveMaximum)) {
+					_fail(context, "above the maximum");
+				}
+				return;
+			}
+
+			if (value.isString()) {
+				const size_t length = _codePoints(value.string);
+				if (length < node.minLength) _fail(context, "too short");
+				if (length > node.maxLength) _fail(context, "too long");
+				return;
+			}
+
+			if (value.isArray()) {
+				const size_t count = value.size();
+				if (count < node.minLength) _fail(context, "too few items");
+				if (count > node.maxLength) _fail(context, "too many items");
+				if (node.items < 0 || !value.array) return;
+
+				for (size_t i = 0; i < count; ++i) {
+					context.path.push_back({{}, i});
+					Value &item = (*value.array)[i];
+					_validate(item, static_cast<uint32_t>(node.items), context);
+					context.path.pop_back();
+				}
+				return;
+			}
+
+			if (value.isObject()) {
+				_validateObject(value, node, context);
+			}
+		}
+
+		template <typename Value>
+		void _validateObject (Value &value, const Node &node, Context &context) const {
+			const size_t seenAt = context.seen.size();
+			context.seen.resize(seenAt + node.propertyCount, 0);
+
+			if (value.object) {
+				// One pass over the entries, each looked up in the precomputed table
+				for (auto &[key, entry] : *value.object) {
+					Value &val = entry;
+					const Property *property = _findProperty(node, key);
+					context.path.push_back({key, 0});
+
+					if (property) {
+						context.seen[seenAt + (property - &_properties[node.firstProperty])] = 1;
+						_validate(val, property->node, context);
+					} else if (node.additional == kAdditionalForbidden) {
+						_fail(context, "unexpected key");
+					} else if (node.additional >= 0) {
+						_validate(val, static_cast<uint32_t>(node.additional), context);
+					}
+
+					context.path.pop_back();
+				}
+			}
+
+			for (uint32_t i = 0; i < node.propertyCount; ++i) {
+				if (context.seen[seenAt + i]) continue;
+				const Property &property = _properties[node.firstProperty + i];
+
+				if constexpr (!std::is_const_v<Value>) {
+					if (property.hasDefault) {
+						value[property.key] = property.defaultValue.deepCopy();
+						continue;
+					}
+				}
+
+				if (property.required) {
+					context.path.push_back({property.key, 0});
+					_fail(context, "missing required key");
+					context.path.pop_back();
+				}
+			}
+
+			context.seen.resize(seenAt);
+		}
+	};
+}
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "DynaVal.h"
+#include "DynaFields.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * Column-oriented copy of an array of same-shaped objects.
+	 *
+	 *   const Irrelon::DynaTable history = Irrelon::DynaTable::fromRows(samples);
+	 *   const std::vector<double> &temps = history.column("temp")->numbers();
+	 *
+	 * Each field becomes one contiguous typed column: numbers as doubles,
+	 * bools as bytes and strings as std::string. A field that mixes kinds
+	 * (say a number in one row and a string in another), or holds arrays or
+	 * objects, falls back to a column of DynaVals. Number columns keep the
+	 * field's DynaValType and widen to Double when rows mix numeric types.
+	 *
+	 * A validity bitmap records which cells hold a value. Null and missing
+	 * fields are both null cells, and both come back as null in toRows()
+	 * and toJson(). The typed storage under a null cell holds a zero value.
+	 */
+	class DynaTable {
+	public:
+		class Column {
+		public:
+			[[nodiscard]] const std::string &name () const { return _name; }
+
+			// Int, UInt, Float, Double or Long for numbers, Bool, String, Any for mixed, Null if every cell is null
+			[[nodiscard]] DynaValType type () const { return _type; }
+
+			[[nodiscard]] bool isNumeric () const { return _type >= DynaValType::Int && _type <= DynaValType::Long; }
+
+			[[nodiscard]] size_t size () const { return _size; }
+
+			[[nodiscard]] bool isNull (const size_t row) const {
+				return row >= _size || !(_valid[row / 64] >> (row % 64) & 1);
+			}
+
+			[[nodiscard]] size_t nullCount () const { return _nulls; }
+
+			// Contiguous column storage, only the one matching type() is filled
+			[[nodiscard]] const std::vector<double> &numbers () const { return _numbers; }
+			[[nodiscard]] const std::vector<uint8_t> &bools () const { return _bools; }
+			[[nodiscard]] const std::vector<std::string> &strings () const { return _strings; }
+			[[nodiscard]] const std::vector<DynaVal> &values () const { return _values; }
+			[[nodiscard]] const std::vector<uint64_t> &validity () const { return _valid; }
+
+			// The cell as a DynaVal, null for null cells
+			[[nodiscard]] DynaVal at (const size_t row) const {
+				DynaVal out;
+				if (isNull(row)) return out;
+
+				if (isNumeric()) {
+					out.type = _type;
+					out.number = _numbers[row];
+				} else if (_type == DynaValType::Bool) {
+					out = DynaVal(_bools[row] != 0);
+				} else if (_type == DynaValType::String) {
+					out = DynaVal(_strings[row]);
+				} else {
+					out = _values[row];
+				}
+				return out;
+			}
+
+		private:
+			friend class DynaTable;
+
+			std::string _name;
+			std::string _jsonKey;
+			DynaValType _type = DynaValType::Null;
+			size_t _size = 0;
+			size_t _nulls = 0;
+			std::vector<double> _numbers;
+			std::vector<uint8_t> _bools;
+			std::vector<std::string> _strings;
+			std::vector<DynaVal> _values;
+			std::vector<uint64_t> _valid;
+
+			// Widens the column type to cover a value of type seen
+			void _admit (const DynaValType seen) {
+				if (seen == DynaValType::Null || seen == DynaValType::Undefined) return;
+
+				DynaValType next = seen;
+				if (seen == DynaValType::Array || seen == DynaValType::Object || seen == DynaValType::Error) next = DynaValType::Any;
+
+				if (_type == DynaValType::Null || _type == next) {
+					_type = next;
+					return;
+				}
+
+				const bool numeric = next >= DynaValType::Int && next <= DynaValType::Long;
+				_type = isNumeric() && numeric ? DynaValType::Double : DynaValType::Any;
+			}
+
+			void _allocate (const size_t rows) {
+				_size = rows;
+				_nulls = rows;
+				_valid.assign((rows + 63) / 64, 0);
+				if (isNumeric()) _numbers.assign(rows, 0);
+				else if (_type == DynaValType::Bool) _bools.assign(rows, 0);
+				else if (_type == DynaValType::String) _strings.resize(rows);
+				else if (_type == DynaValType::Any) _values.resize(rows);
+			}
+
+			void _set (const size_t row, const DynaVal &value) {
+				if (value.isNull() || value.isUndefined() || _type == DynaValType::Null) return;
+
+				if (isNumeric()) _numbers[row] = value.number;
+				else if (_type == DynaValType::Bool) _bools[row] = value.boolean;
+				else if (_type == DynaValType::String) _strings[row] = value.string;
+				else _values[row] = value;
+
+				_valid[row / 64] |= uint64_t(1) << (row % 64);
+				--_nulls;
+			}
+
+			// A column with the same name and type holding the given rows of this one
+			[[nodiscard]] Column _take (const std::vector<size_t> &rows) const {
+				Column out;
+				out._name = _name;
+				out._jsonKey = _jsonKey;
+				out._type = _type;
+				out._allocate(rows.size());
+				for (size_t i = 0; i < rows.size(); ++i) {
+					if (!isNull(rows[i])) out._set(i, at(rows[i]));
+				}
+				return out;
+			}
+
+			void _writeCell (std::string &out, const size_t row) const {
+				if (isNull(row)) {
+					out += "null";
+				} else if (isNumeric()) {
+					// Same formatting as DynaVal::toJson()
+					char digits[32];
+					const int length = std::snprintf(digits, sizeof(digits), "%g", _numbers[row]);
+					out.append(digits, static_cast<size_t>(length));
+				} else if (_type == DynaValType::Bool) {
+					out += _bools[row] ? "true" : "false";
+				} else if (_type == DynaValType::String) {
+					detail::dynaJsonEscape(out, _strings[row]);
+				} else {
+					out += _values[row].toJson();
+				}
+			}
+		};
+
+		DynaTable () = default;
+
+		/**
+		 * Builds the table from an array of objects. Columns appear in the
+		 * order their field is first seen. Array and object cells share
+		 * storage with the rows, as with any DynaVal copy.
+		 */
+		static DynaTable fromRows (const DynaVal &rows) {
+			if (!rows.isArray()) detail::dynaThrow("DynaTable::fromRows() requires an array");
+
+			DynaTable table;
+			table._rows = rows.size();
+			if (!rows.array) return table;
+
+			for (const auto &row : *rows.array) {
+				if (!row.isObject()) detail::dynaThrow("DynaTable::fromRows() rows must be objects");
+				if (!row.object) continue;
+				for (const auto &[key, val] : *row.object) table._columnFor(key)._admit(val.type);
+			}
+
+			for (auto &column : table._columns) column._allocate(table._rows);
+
+			for (size_t i = 0; i < table._rows; ++i) {
+				const DynaVal &row = (*rows.array)[i];
+				if (!row.object) continue;
+				for (const auto &[key, val] : *row.object) table._columns[table._lookup.at(key)]._set(i, val);
+			}
+
+			return table;
+		}
+
+		[[nodiscard]] size_t rowCount () const { return _rows; }
+
+		[[nodiscard]] size_t columnCount () const { return _columns.size(); }
+
+		[[nodiscard]] const std::vector<Column> &columns () const { return _columns; }
+
+		// The named column, or nullptr
+		[[nodiscard]] const Column *column (const std::string &name) const {
+			const auto it = _lookup.find(name);
+			return it == _lookup.end() ? nullptr : &_columns[it->second];
+		}
+
+		// A table with only the named columns, in the order given
+		[[nodiscard]] DynaTable project (const std::vector<std::string> &names) const {
+			DynaTable out;
+			out._rows = _rows;
+			for (const auto &name : names) {
+				const Column *source = column(name);
+				if (!source) detail::dynaThrow("DynaTable::project() has no column " + name);
+				out._lookup.emplace(name, out._columns.size());
+				out._columns.push_back(*source);
+			}
+			return out;
+		}
+
+		// A table with the given rows, in the order given
+		[[nodiscard]] DynaTable take (const std::vector<size_t> &rows) const {
+			DynaTable out;
+			out._rows = rows.size();
+			out._lookup = _lookup;
+			out._columns.reserve(_columns.size());
+			for (const auto &column : _columns) out._columns.push_back(column._take(rows));
+			return out;
+		}
+
+		/**
+		 * Rows whose cell in the named column satisfies pred, skipping null
+		 * cells. pred is called with a double for number columns, bool for
+		 * bool columns, const std::string & for string columns and
+		 * const DynaVal & for mixed columns. Throws if the column is missing
+		 * or pred does not take the column's kind of value.
+		 */
+		template <typename Pred>
+		[[nodiscard]] std::vector<size_t> where (const std::string &name, Pred &&pred) const {
+			const Column *col = column(name);
+			if (!col) detail::dynaThrow("DynaTable::where() has no column " + name);
+
+			std::vector<size_t> rows;
+			const auto scan = [&](const auto &cells) {
+				for (size_t i = 0; i < _rows; ++i) {
+					if (!col->isNull(i) && pred(cells[i])) rows.push_back(i);
+				}
+			};
+
+			if (col->isNumeric()) {
+				if constexpr (std::is_invocable_r_v<bool, Pred &, double>) {
+					scan(col->_numbers);
+					return rows;
+				}
+			} else if (col->type() == DynaValType::Bool) {
+				if constexpr (std::is_invocable_r_v<bool, Pred &, bool>) {
+					for (size_t i = 0; i < _rows; ++i) {
+						if (!col->isNull(i) && pred(col->_bools[i] != 0)) rows.push_back(i);
+					}
+					return rows;
+				}
+			} else if (col->type() == DynaValType::String) {
+				if constexpr (std::is_invocable_r_v<bool, Pred &, const std::string &>) {
+					scan(col->_strings);
+					return rows;
+				}
+			} else if (col->type() == DynaValType::Any) {
+				if constexpr (std::is_invocable_r_v<bool, Pred &, const DynaVal &>) {
+					scan(col->_values);
+					return rows;
+				}
+			} else {
+				// Every cell is null
+				return rows;
+			}
+
+			detail::dynaThrow("DynaTable::where() predicate does not accept column " + name);
+		}
+
+		// One row as an object, null cells included as null
+		[[nodiscard]] DynaVal row (const size_t index) const {
+			DynaValObject object;
+			object.reserve(_columns.size());
+			for (const auto &column : _columns) object.emplace(column._name, column.at(index));
+			return DynaVal(std::move(object));
+		}
+
+		[[nodiscard]] DynaVal toRows () const {
+			DynaValArray rows;
+			rows.reserve(_rows);
+			for (size_t i = 0; i < _rows; ++i) rows.push_back(row(i));
+			return DynaVal(std::move(rows));
+		}
+
+		// The same JSON as toRows().toJson() with columns in table order, written without building rows
+		[[nodiscard]] std::string toJson () const {
+			std::string out = "[";
+			for (size_t i = 0; i < _rows; ++i) {
+				if (i) out += ',';
+				out += '{';
+				for (size_t c = 0; c < _columns.size(); ++c) {
+					if (c) out += ',';
+					out += _columns[c]._jsonKey;
+					out += ':';
+					_columns[c]._writeCell(out, i);
+				}
+				out += '}';
+			}
+			out += ']';
+			return out;
+		}
+
+	private:
+		size_t _rows = 0;
+		std::vector<Column> _columns;
+		std::unordered_map<std::string, size_t> _lookup;
+
+		Column &_columnFor (const std::string &name) {
+			const auto [it, inserted] = _lookup.emplace(name, _columns.size());
+			if (inserted) {
+				_columns.emplace_back();
+				_columns.back()._name = name;
+				detail::dynaJsonEscape(_columns.back()._jsonKey, name);
+			}
+			return _columns[it->second];
+		}
+	};
+}
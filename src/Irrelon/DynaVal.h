@@ -1,15 +1,25 @@
 #pragma once
 
+#include <atomic>
+#include <cmath>
 #include <iomanip>  // for std::boolalpha
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <sstream>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 #include <Irrelon/PSRAMAllocator.h>
 #include "DynaError.h"
+#include "DynaParallel.h"
+#include "DynaValString.h"
 #include "DynaValType.h"
+#include "dynaThrow.h"
 
 namespace Irrelon {
 	struct DynaVal;
@@ -19,16 +29,66 @@ namespace Irrelon {
 	using DynaValObject = std::unordered_map<std::string, DynaVal, std::hash<std::string>, std::equal_to<std::string>,
 		PSRAMAllocator<std::pair<const std::string, DynaVal>>>;
 
+	/**
+	 * Values memoized on a container and shared by every copy of it. On a
+	 * frozen container the hash and byte size are filled in by freeze(), the
+	 * JSON on first serialization. On a mutable container with the JSON
+	 * cache enabled only the JSON is kept, and parent links the cache of the
+	 * container it was last serialized inside so a change can clear every
+	 * fragment above it.
+	 */
+	struct DynaValCache {
+		size_t hash = 0;
+		size_t bytes = 0;
+		std::once_flag jsonOnce;
+		std::atomic<bool> jsonReady{false};
+		std::string json;
+		std::weak_ptr<DynaValCache> parent;
+	};
+
+	/**
+	 * The cache state of one DynaVal, allocated only for values that have
+	 * a memo or live inside a cached container, so other values carry a
+	 * single null pointer. cache is the container's memo, shared by every
+	 * copy of it. parent is the cache of the container the slot lives in;
+	 * like solid it belongs to the slot and is never copied.
+	 */
+	struct DynaValCacheLink {
+		std::shared_ptr<DynaValCache> cache;
+		std::weak_ptr<DynaValCache> parent;
+	};
+
+	/**
+	 * Combines lambdas into one visitor for DynaVal::visit(). Overload
+	 * resolution picks the handler for each alternative at compile time.
+	 */
+	template <typename... Fns>
+	struct DynaOverloaded : Fns... {
+		using Fns::operator()...;
+	};
+
+	template <typename... Fns>
+	DynaOverloaded(Fns...) -> DynaOverloaded<Fns...>;
+
+	// What DynaVal::visit() passes for an Undefined (or Any) value
+	struct DynaUndefined {};
+
 	struct DynaVal {
 		bool frozen = false;
 		bool solid = false;
 		DynaValType type = DynaValType::Null;
 		double number = 0.0f;
 		bool boolean = false;
-		std::string string;
+		// Set by editError() once it copied the error for this slot. Like solid it is never copied
+		bool errorOwned = false;
+		// std::string, or DynaSharedString with DYNAVAL_SHARED_STRINGS
+		DynaValString string;
 		std::shared_ptr<DynaValArray> array;
 		std::shared_ptr<DynaValObject> object;
-		std::shared_ptr<DynaError> errorData;
+		// Read only, change an error through editError(). Assign only errors made by make_shared
+		std::shared_ptr<const DynaError> errorData;
+		// Null unless the value is frozen, cached or inside a cached container
+		mutable std::unique_ptr<DynaValCacheLink> cacheLink;
 
 		DynaVal()
 		: frozen(false),
@@ -41,19 +101,25 @@ namespace Irrelon {
 		  object(nullptr),
 		  errorData(nullptr) {}
 
+		// A copy shares frozen storage with the original but is a new slot, so it is never solid
 		DynaVal(const DynaVal &other)
 		: frozen(other.frozen),
-		  solid(other.solid),
+		  solid(false),
 		  type(other.type),
 		  number(other.number),
 		  boolean(other.boolean),
 		  string(other.string),
 		  array(other.array),
 		  object(other.object),
-		  errorData(other.errorData) {}
+		  errorData(other.errorData),
+		  cacheLink(_copyCacheLink(other)) {}
 
+		// Rebinding a handle never touches the storage it pointed at, so only
+		// slots that live inside a frozen container refuse assignment
 		DynaVal &operator= (const DynaVal &other) {
 			if (this != &other) {
+				if (solid) detail::dynaThrow("Attempted to assign to a value inside a frozen DynaVal");
+				_touch();
 				type = other.type;
 				number = other.number;
 				boolean = other.boolean;
@@ -61,8 +127,57 @@ namespace Irrelon {
 				array = other.array;
 				object = other.object;
 				errorData = other.errorData;
+				errorOwned = false;
+				_setCache(other._cachePtr());
 				frozen = other.frozen;
-				solid = other.solid;
+			}
+			return *this;
+		}
+
+		// Moving hands over the storage without touching reference counts. A
+		// slot inside a frozen container can't be emptied, so it is copied
+		DynaVal(DynaVal &&other) noexcept
+		: frozen(other.frozen),
+		  solid(false),
+		  type(other.type),
+		  number(other.number),
+		  boolean(other.boolean) {
+			if (other.solid) {
+				string = other.string;
+				array = other.array;
+				object = other.object;
+				errorData = other.errorData;
+				cacheLink = _copyCacheLink(other);
+				return;
+			}
+
+			string = std::move(other.string);
+			array = std::move(other.array);
+			object = std::move(other.object);
+			errorData = std::move(other.errorData);
+			_takeCache(other);
+			other.type = DynaValType::Null;
+			other.frozen = false;
+		}
+
+		DynaVal &operator= (DynaVal &&other) {
+			if (other.solid) return *this = std::as_const(other);
+
+			if (this != &other) {
+				if (solid) detail::dynaThrow("Attempted to assign to a value inside a frozen DynaVal");
+				_touch();
+				type = other.type;
+				number = other.number;
+				boolean = other.boolean;
+				string = std::move(other.string);
+				array = std::move(other.array);
+				object = std::move(other.object);
+				errorData = std::move(other.errorData);
+				errorOwned = false;
+				_takeCache(other);
+				frozen = other.frozen;
+				other.type = DynaValType::Null;
+				other.frozen = false;
 			}
 			return *this;
 		}
@@ -173,6 +288,11 @@ namespace Irrelon {
 			return boolean;
 		}
 
+		// The string's bytes without copying them, empty for anything but a string
+		[[nodiscard]] std::string_view toStringView () const {
+			return type == DynaValType::String ? std::string_view(string) : std::string_view();
+		}
+
 		[[nodiscard]] std::string toString (const bool interpretArrayData = false) const {
 			if (isNumber()) {
 				return std::to_string(number);
@@ -204,7 +324,7 @@ namespace Irrelon {
 
 		[[nodiscard]] const DynaValArray &toArray () const {
 			if (!isArray()) {
-				throw std::runtime_error("Tried to access non-array DynaVal as array");
+				detail::dynaThrow("Tried to access non-array DynaVal as array");
 			}
 
 			return *array;
@@ -212,42 +332,168 @@ namespace Irrelon {
 
 		[[nodiscard]] const DynaValObject &toObject () const {
 			if (!isObject()) {
-				throw std::runtime_error("Tried to access non-object DynaVal as object");
+				detail::dynaThrow("Tried to access non-object DynaVal as object");
 			}
 
 			return *object;
 		}
 
-		bool isFalsy () const {
+		// The elements of an array, nullptr for any other type
+		[[nodiscard]] const DynaValArray *tryArray () const {
+			return type == DynaValType::Array ? array.get() : nullptr;
+		}
+
+		// The entries of an object, nullptr for any other type
+		[[nodiscard]] const DynaValObject *tryObject () const {
+			return type == DynaValType::Object ? object.get() : nullptr;
+		}
+
+		/**
+		 * The value as T, or std::nullopt when it does not hold one. Nothing
+		 * is coerced: a number converts to an arithmetic T only if it fits
+		 * (integral types need a whole number in range), a bool only to bool
+		 * and a string only to std::string or std::string_view. The view
+		 * points into this value and lives as long as its string does.
+		 */
+		template <typename T>
+		[[nodiscard]] std::optional<T> get () const {
+			if constexpr (std::is_same_v<T, bool>) {
+				if (type == DynaValType::Bool) return boolean;
+			} else if constexpr (std::is_integral_v<T>) {
+				// 2^digits is exactly representable, unlike the type's max
+				const double limit = std::ldexp(1.0, std::numeric_limits<T>::digits);
+				const double lowest = std::is_signed_v<T> ? -limit : 0.0;
+				if (isNumber() && std::trunc(number) == number && number >= lowest && number < limit) {
+					return static_cast<T>(number);
+				}
+			} else if constexpr (std::is_floating_point_v<T>) {
+				if (isNumber()) return static_cast<T>(number);
+			} else if constexpr (std::is_same_v<T, std::string>) {
+				if (type == DynaValType::String) return string;
+			} else if constexpr (std::is_same_v<T, std::string_view>) {
+				if (type == DynaValType::String) return std::string_view(string);
+			} else {
+				static_assert(!sizeof(T), "DynaVal::get<T>() supports bool, arithmetic types, std::string and std::string_view");
+			}
+
+			return std::nullopt;
+		}
+
+		/**
+		 * True when T is the stored alternative, the type visit() would pass:
+		 * int, unsigned int, int64_t (or long), float, double, bool,
+		 * std::string, DynaValArray, DynaValObject, DynaError,
+		 * std::nullptr_t or DynaUndefined. Unlike get<T>() nothing converts,
+		 * so an Int is not a double.
+		 */
+		template <typename T>
+		[[nodiscard]] bool is () const {
+			if constexpr (std::is_same_v<T, DynaUndefined>) {
+				return type == DynaValType::Undefined || type == DynaValType::Any;
+			} else {
+				return type == _typeOf<T>();
+			}
+		}
+
+		/**
+		 * Calls visitor with the stored alternative as its C++ type and
+		 * returns what it returns, which must be the same for every
+		 * alternative:
+		 *
+		 *   Undefined, Any  DynaUndefined
+		 *   Null            std::nullptr_t
+		 *   Bool            bool
+		 *   Int / UInt      int / unsigned int
+		 *   Long            int64_t
+		 *   Float / Double  float / double
+		 *   String          const std::string &
+		 *   Array / Object  const DynaValArray & / const DynaValObject &
+		 *   Error           const DynaError &
+		 *
+		 * A number its type cannot hold (an Int set to 4e9 or 1.5, a UInt
+		 * set to -1) is passed as the stored double rather than narrowed.
+		 *
+		 *   const size_t weight = val.visit(Irrelon::DynaOverloaded{
+		 *       [](const std::string &text) { return text.size(); },
+		 *       [](const Irrelon::DynaValArray &items) { return items.size(); },
+		 *       [](const auto &) { return size_t(1); }
+		 *   });
+		 *
+		 * The type is switched on once; each handler is resolved at compile
+		 * time, and a visitor that misses an alternative does not compile.
+		 */
+		template <typename Visitor>
+		decltype(auto) visit (Visitor &&visitor) const {
 			switch (type) {
-				case DynaValType::Bool:
-					return !boolean;
 				case DynaValType::Null:
-				case DynaValType::Undefined:
-					return true;
+					return std::forward<Visitor>(visitor)(nullptr);
+				case DynaValType::Bool:
+					return std::forward<Visitor>(visitor)(boolean);
 				case DynaValType::Int:
-					return number == 0;
+					if (_numberFits<int>()) return std::forward<Visitor>(visitor)(static_cast<int>(number));
+					return std::forward<Visitor>(visitor)(number);
 				case DynaValType::UInt:
-					return number == 0;
+					if (_numberFits<unsigned int>()) return std::forward<Visitor>(visitor)(static_cast<unsigned int>(number));
+					return std::forward<Visitor>(visitor)(number);
+				case DynaValType::Long:
+					if (_numberFits<int64_t>()) return std::forward<Visitor>(visitor)(static_cast<int64_t>(number));
+					return std::forward<Visitor>(visitor)(number);
 				case DynaValType::Float:
-					return number == 0.0f;
+					if (_numberFits<float>()) return std::forward<Visitor>(visitor)(static_cast<float>(number));
+					return std::forward<Visitor>(visitor)(number);
 				case DynaValType::Double:
-					return number == 0;
-				case DynaValType::Long:
-					return number == 0;
+					return std::forward<Visitor>(visitor)(number);
 				case DynaValType::String:
-					return string.empty();
+					return std::forward<Visitor>(visitor)(static_cast<const std::string &>(string));
 				case DynaValType::Array:
-					return !array || array->empty();
+					return std::forward<Visitor>(visitor)(array ? *array : _emptyArray());
 				case DynaValType::Object:
-					return !object || object->empty();
+					return std::forward<Visitor>(visitor)(object ? *object : _emptyObject());
 				case DynaValType::Error:
-					return false; // Errors are not falsy
+					return std::forward<Visitor>(visitor)(errorData ? *errorData : _emptyError());
 				default:
-					return false;
+					return std::forward<Visitor>(visitor)(DynaUndefined{});
 			}
 		}
 
+		/**
+		 * The child at key, or nullptr when this is not an object or has no
+		 * such key. Unlike operator[] nothing is created.
+		 */
+		[[nodiscard]] const DynaVal *at (const std::string &key) const {
+			if (type != DynaValType::Object || !object) return nullptr;
+			const auto it = object->find(key);
+			return it == object->end() ? nullptr : &it->second;
+		}
+
+		// The element at index, or nullptr when this is not an array or index is out of range
+		[[nodiscard]] const DynaVal *at (const size_t index) const {
+			if (type != DynaValType::Array || !array || index >= array->size()) return nullptr;
+			return &(*array)[index];
+		}
+
+		// As the const form, writes through the returned child invalidate the caches above it themselves
+		[[nodiscard]] DynaVal *at (const std::string &key) {
+			return const_cast<DynaVal *>(std::as_const(*this).at(key));
+		}
+
+		[[nodiscard]] DynaVal *at (const size_t index) {
+			return const_cast<DynaVal *>(std::as_const(*this).at(index));
+		}
+
+		bool isFalsy () const {
+			return visit(DynaOverloaded{
+				[](DynaUndefined) { return true; },
+				[](std::nullptr_t) { return true; },
+				[](const bool value) { return !value; },
+				[](const std::string &value) { return value.empty(); },
+				[](const DynaValArray &items) { return items.empty(); },
+				[](const DynaValObject &entries) { return entries.empty(); },
+				[](const DynaError &) { return false; }, // Errors are not falsy
+				[](const auto number) { return number == 0; }
+			});
+		}
+
 		// Type checkers
 		[[nodiscard]] bool isError () const { return type == DynaValType::Error; }
 
@@ -292,14 +538,147 @@ namespace Irrelon {
 
 		[[nodiscard]] bool isObject () const { return type == DynaValType::Object; }
 
-		void freeze () { frozen = true; }
+		/**
+		 * Freezes this value and everything beneath it. Every mutating API
+		 * throws on a frozen value, and values inside a frozen container
+		 * cannot be reassigned. Frozen containers memoize their hash, byte
+		 * size and JSON, so subtrees that were already frozen cost nothing
+		 * to freeze, hash or serialize again.
+		 *
+		 * Storage still shared with handles copied before the freeze is
+		 * copied first, so those handles stay mutable and writes through
+		 * them never reach the frozen tree.
+		 */
+		void freeze () {
+			if (frozen && (_cache() || (!isArray() && !isObject()))) return;
+
+			if (type == DynaValType::Array && array) {
+				if (array.use_count() > 1) array = std::make_shared<DynaValArray>(*array);
+				for (auto &item : *array) {
+					item.freeze();
+					item.solid = true;
+				}
+			}
+
+			if (type == DynaValType::Object && object) {
+				if (object.use_count() > 1) object = std::make_shared<DynaValObject>(*object);
+				for (auto &[key, val] : *object) {
+					val.freeze();
+					val.solid = true;
+				}
+			}
+
+			frozen = true;
+
+			if (type == DynaValType::Array || type == DynaValType::Object) {
+				auto memo = std::make_shared<DynaValCache>();
+				memo->hash = _computeHash();
+				memo->bytes = _computeBytes();
+				_setCache(std::move(memo));
+			}
+		}
+
+		/**
+		 * Makes this value mutable again. Frozen storage may be shared with
+		 * other copies, so containers get a private shallow copy of their
+		 * storage. Children stay frozen until they are unfrozen themselves.
+		 */
+		void unfreeze () {
+			if (!frozen) return;
+			if (solid) detail::dynaThrow("Attempted to unfreeze a value inside a frozen DynaVal");
 
-		void unfreeze () { frozen = false; }
+			if (type == DynaValType::Array && array) array = std::make_shared<DynaValArray>(*array);
+			if (type == DynaValType::Object && object) object = std::make_shared<DynaValObject>(*object);
+			_setCache(nullptr);
+			frozen = false;
+		}
 
 		[[nodiscard]] bool isFrozen () const { return frozen; }
 
 		void ensureMutable () const {
-			if (frozen) throw std::runtime_error("Attempted to modify a frozen DynaVal");
+			if (frozen || solid) detail::dynaThrow("Attempted to modify a frozen DynaVal");
+		}
+
+		/**
+		 * Keeps a serialized JSON fragment on this container and on every
+		 * container beneath it, including ones added later. A mutator (push,
+		 * set, remove, assignment, operator[] adding an entry) invalidates
+		 * the fragment of the value it changes and of every container above
+		 * it, also when called through a held reference or a copy of a
+		 * container, so toJson() only regenerates branches on the path to a
+		 * change and splices the cached fragments for the rest. Reads don't
+		 * invalidate anything. Costs one extra copy of the JSON per level of
+		 * nesting.
+		 *
+		 * Storage placed in two cached trees at once links to the one that
+		 * serialized it last; changes made through a copy held outside both
+		 * trees need markDirty() on the other.
+		 *
+		 * toJson() on a cached tree that is not frozen writes the fragments,
+		 * so such a tree belongs to one thread, reads included. To serialize
+		 * from several threads, freeze it (frozen fragments are filled once
+		 * under a std::call_once) or publish it through DynaValSnapshotCell.
+		 */
+		void enableJsonCache () {
+			if (frozen || (!isArray() && !isObject())) return;
+			if (!_cache()) _setCache(std::make_shared<DynaValCache>());
+
+			if (type == DynaValType::Array && array) {
+				for (auto &item : *array) item.enableJsonCache();
+			}
+
+			if (type == DynaValType::Object && object) {
+				for (auto &[key, val] : *object) val.enableJsonCache();
+			}
+		}
+
+		// Drops the cached fragments on this value and everything beneath it
+		void disableJsonCache () {
+			if (frozen) return;
+			_setCache(nullptr);
+
+			if (type == DynaValType::Array && array) {
+				for (auto &item : *array) item.disableJsonCache();
+			}
+
+			if (type == DynaValType::Object && object) {
+				for (auto &[key, val] : *object) val.disableJsonCache();
+			}
+		}
+
+		/**
+		 * Invalidates the cached fragment on this value and every container
+		 * above it and, when deep is set, on everything beneath it.
+		 */
+		void markDirty (const bool deep = true) {
+			if (frozen) return;
+			_touch();
+			if (deep) _markSubtreeDirty();
+		}
+
+		// True unless this container holds an up to date serialized fragment
+		[[nodiscard]] bool isDirty () const {
+			const DynaValCache *memo = _cache();
+			return !memo || !memo->jsonReady.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * Content hash consistent with equals(): numbers hash by value and
+		 * object entries hash independently of iteration order. Memoized on
+		 * frozen containers.
+		 */
+		[[nodiscard]] size_t hash () const {
+			if (frozen && _cache()) return _cache()->hash;
+			return _computeHash();
+		}
+
+		/**
+		 * Approximate memory footprint of this value and everything beneath
+		 * it, including container overhead. Memoized on frozen containers.
+		 */
+		[[nodiscard]] size_t sizeInBytes () const {
+			if (frozen && _cache()) return _cache()->bytes;
+			return _computeBytes();
 		}
 
 		[[nodiscard]] std::string getType () const {
@@ -311,7 +690,7 @@ namespace Irrelon {
 			for (size_t i = 0; i < length; ++i) {
 				const auto val = DynaVal(data[i]);
 				if (val.getType() != "u_int") {
-					throw std::runtime_error("fromBytesAsArray(): all elements must be unsigned integers");
+					detail::dynaThrow("fromBytesAsArray(): all elements must be unsigned integers");
 				}
 				push(val);
 			}
@@ -360,34 +739,23 @@ namespace Irrelon {
 		}
 
 		[[nodiscard]] std::string arrayToString() const {
-			if (!isArray()) {
-				throw std::runtime_error("arrayToString() called on non-array DynaVal");
-			}
-
-			const auto& arr = toArray();
 			std::string result;
-			result.reserve(arr.size()); // reserve memory up front
-
-			for (const auto& item : arr) {
-				if (!item.isUInt()) {
-					throw std::runtime_error("arrayToString(): all elements must be unsigned integers");
-				}
-
-				const uint8_t val = item.toUInt(true);
-				if (val < 0 || val > 255) {
-					throw std::runtime_error("arrayToString(): element out of byte range (0–255)");
-				}
-
-				//Serial.printf("ATS: Val of %d is %c ", val, static_cast<char>(val));
-
-				result.push_back(static_cast<char>(val));
-			}
+			const char *error = _arrayToString(result);
+			if (error) detail::dynaThrow(error);
+			return result;
+		}
 
+		// As arrayToString(), std::nullopt where that would throw
+		[[nodiscard]] std::optional<std::string> tryArrayToString () const {
+			std::string result;
+			if (_arrayToString(result)) return std::nullopt;
 			return result;
 		}
 
 		DynaVal &becomeError () {
 			if (type != DynaValType::Error) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Error;
 				errorData = std::make_shared<DynaError>();
 			}
@@ -396,6 +764,8 @@ namespace Irrelon {
 
 		DynaVal &becomeObject () {
 			if (type != DynaValType::Object) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Object;
 				object = std::make_shared<DynaValObject>();
 			}
@@ -404,6 +774,8 @@ namespace Irrelon {
 
 		DynaVal &becomeArray () {
 			if (type != DynaValType::Array) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Array;
 				array = std::make_shared<DynaValArray>();
 				array->clear();
@@ -413,6 +785,8 @@ namespace Irrelon {
 
 		DynaVal &becomeString () {
 			if (type != DynaValType::String) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::String;
 				string.clear();
 			}
@@ -421,6 +795,8 @@ namespace Irrelon {
 
 		DynaVal &becomeFloat () {
 			if (type != DynaValType::Float) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Float;
 				number = 0.0f;
 			}
@@ -429,6 +805,8 @@ namespace Irrelon {
 
 		DynaVal &becomeInt () {
 			if (type != DynaValType::Int) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Int;
 				number = 0;
 			}
@@ -437,6 +815,8 @@ namespace Irrelon {
 
 		DynaVal &becomeUInt () {
 			if (type != DynaValType::UInt) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::UInt;
 				number = 0;
 			}
@@ -445,6 +825,8 @@ namespace Irrelon {
 
 		DynaVal &becomeDouble () {
 			if (type != DynaValType::Double) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Double;
 				number = 0;
 			}
@@ -453,6 +835,8 @@ namespace Irrelon {
 
 		DynaVal &becomeLong () {
 			if (type != DynaValType::Long) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Long;
 				number = 0;
 			}
@@ -461,6 +845,8 @@ namespace Irrelon {
 
 		DynaVal &becomeBool () {
 			if (type != DynaValType::Bool) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Bool;
 				boolean = false;
 			}
@@ -468,21 +854,44 @@ namespace Irrelon {
 		}
 
 		DynaVal &becomeNull () {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Null;
 			return *this;
 		}
 
 		DynaVal &becomeUndefined () {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Undefined;
 			return *this;
 		}
 
 		std::string toJson () const {
+			// Errors are the common failure response, skip setting up a stream for them
+			if (type == DynaValType::Error && errorData) return errorData->toString();
+
 			std::ostringstream out;
 			_toJson(out);
 			return out.str();
 		}
 
+		// Appends the JSON to out, for writers that assemble a document around several values
+		void toJson (std::ostringstream &out) const {
+			_toJson(out);
+		}
+
+		/**
+		 * Serializes like toJson() but splits arrays and objects with at least
+		 * policy.cutoff children into chunks that are serialized on the task
+		 * pool and then concatenated in order, so the output is identical.
+		 */
+		std::string toJson (const DynaParallelPolicy &policy) const {
+			std::ostringstream out;
+			_toJson(out, policy);
+			return out.str();
+		}
+
 		size_t size () const {
 			if (type == DynaValType::Array) {
 				return array
@@ -503,6 +912,8 @@ namespace Irrelon {
 		}
 
 		void clear () {
+			ensureMutable();
+			_touch();
 			switch (type) {
 				case DynaValType::String:
 					string.clear();
@@ -523,10 +934,61 @@ namespace Irrelon {
 
 		void remove (const size_t index) const {
 			if (type != DynaValType::Array || !array) return;
+			ensureMutable();
+			_touch();
 			if (index >= array->size()) return;
 			array->erase(array->begin() + index);
 		}
 
+		/**
+		 * Pre-sizes an array or object for n children so filling it does not
+		 * reallocate or rehash along the way. Other types are left as they are.
+		 */
+		DynaVal &reserve (const size_t n) {
+			if (type == DynaValType::Array) {
+				ensureMutable();
+				if (!array) array = std::make_shared<DynaValArray>();
+				array->reserve(n);
+			} else if (type == DynaValType::Object) {
+				ensureMutable();
+				if (!object) object = std::make_shared<DynaValObject>();
+				object->reserve(n);
+			}
+			return *this;
+		}
+
+		// Removes elements [begin, end) in one pass instead of shifting the tail once per element
+		void eraseRange (const size_t begin, size_t end) {
+			if (type != DynaValType::Array || !array) return;
+			ensureMutable();
+			_touch();
+			end = std::min(end, array->size());
+			if (begin >= end) return;
+			array->erase(array->begin() + begin, array->begin() + end);
+		}
+
+		/**
+		 * Removes deleteCount elements from start and inserts items in their
+		 * place, like JavaScript's Array.prototype.splice. The removed elements
+		 * are returned as a new array. start past the end appends.
+		 */
+		DynaVal splice (size_t start, size_t deleteCount, const std::vector<DynaVal> &items = {}) {
+			DynaValArray removed;
+			if (type != DynaValType::Array) return DynaVal(std::move(removed));
+			ensureMutable();
+			_touch();
+			// clear() leaves no storage, items still go into a fresh one
+			if (!array) array = std::make_shared<DynaValArray>();
+
+			start = std::min(start, array->size());
+			deleteCount = std::min(deleteCount, array->size() - start);
+			const auto first = array->begin() + start;
+			removed.assign(std::make_move_iterator(first), std::make_move_iterator(first + deleteCount));
+			array->erase(first, first + deleteCount);
+			array->insert(array->begin() + start, items.begin(), items.end());
+			return DynaVal(std::move(removed));
+		}
+
 		[[nodiscard]] bool containsKey (const std::string &key) const {
 			if (type != DynaValType::Object || !object) return false;
 			return object->find(key) != object->end();
@@ -548,66 +1010,88 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (float val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Float;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (int8_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Int;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (int16_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Int;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (int32_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Int;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (uint8_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::UInt;
 			number = static_cast<uint>(val);
 			return *this;
 		}
 
 		DynaVal &set (uint16_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::UInt;
 			number = static_cast<uint>(val);
 			return *this;
 		}
 
 		DynaVal &set (uint32_t val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::UInt;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (double val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Double;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (long val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Long;
 			number = val;
 			return *this;
 		}
 
 		DynaVal &set (bool val) {
+			ensureMutable();
+			_touch();
 			type = DynaValType::Bool;
 			boolean = val;
 			return *this;
 		}
 
 		DynaVal &set (const std::string &val) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::String;
 			string = val;
@@ -615,6 +1099,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (const char *val) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::String;
 			string = val;
@@ -622,6 +1108,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (const DynaValArray &arr) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::Array;
 			array = std::make_shared<DynaValArray>(arr);
@@ -629,6 +1117,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (DynaValArray &&arr) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::Array;
 			array = std::make_shared<DynaValArray>(std::move(arr));
@@ -636,6 +1126,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (const DynaValObject &obj) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::Object;
 			object = std::make_shared<DynaValObject>(obj);
@@ -643,6 +1135,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (const DynaError &err) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::Error;
 			errorData = std::make_shared<DynaError>(err); // copies the error
@@ -650,6 +1144,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (DynaError &&err) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = DynaValType::Error;
 			errorData = std::make_shared<DynaError>(std::move(err));
@@ -657,6 +1153,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &set (const DynaVal &other) {
+			ensureMutable();
+			_touch();
 			reset();
 			type = other.type;
 			number = other.number;
@@ -667,6 +1165,8 @@ namespace Irrelon {
 			array = other.array;
 			object = other.object;
 			errorData = other.errorData;
+			_setCache(other._cachePtr());
+			frozen = other.frozen;
 			return *this;
 		}
 
@@ -770,12 +1270,16 @@ namespace Irrelon {
 		// Non-const: allows modifying or creating array elements
 		[[nodiscard]] DynaVal &operator[] (const size_t index) {
 			if (type != DynaValType::Array) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Array;
 				array = std::make_shared<DynaValArray>();
 			}
 
 			if (index >= array->size()) {
 				// Expand the array with new DynaVals if needed
+				ensureMutable();
+				_touch();
 				array->resize(index + 1);
 			}
 
@@ -794,15 +1298,24 @@ namespace Irrelon {
 		}
 
 		[[nodiscard]] DynaVal &operator[] (const int index) {
-			if (index < 0) { return DynaVal().becomeNull(); }
+			if (index < 0) {
+				// Writes through a negative index land in a scratch value and are dropped
+				thread_local DynaVal scratch;
+				scratch = DynaVal();
+				return scratch.becomeNull();
+			}
 
 			if (type != DynaValType::Array) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Array;
 				array = std::make_shared<DynaValArray>();
 			}
 
 			if (index >= array->size()) {
 				// Expand the array with nulls if needed
+				ensureMutable();
+				_touch();
 				array->resize(index + 1);
 			}
 
@@ -824,15 +1337,26 @@ namespace Irrelon {
 		// Non-const version: allows mutation or creation of new keys
 		[[nodiscard]] DynaVal &operator[] (const std::string &key) {
 			if (type == DynaValType::Error) {
-				throw std::runtime_error("Cannot use operator[] on DynaVal of type Error");
+				detail::dynaThrow("Cannot use operator[] on DynaVal of type Error");
 			}
 
 			if (type != DynaValType::Object) {
+				ensureMutable();
+				_touch();
 				type = DynaValType::Object;
 				object = std::make_shared<DynaValObject>();
 			}
 
-			return (*object)[key];
+			if (frozen) {
+				// Existing children are handed out (they are frozen too), new keys are refused
+				const auto it = object->find(key);
+				if (it == object->end()) ensureMutable();
+				return it->second;
+			}
+
+			const auto [it, added] = object->try_emplace(key);
+			if (added) _touch();
+			return it->second;
 		}
 
 		// Const version: safe lookup only
@@ -850,6 +1374,8 @@ namespace Irrelon {
 		}
 
 		DynaVal &push (const DynaVal &val) {
+			ensureMutable();
+			_touch();
 			if (type != DynaValType::Array) {
 				becomeArray(); // ensure array initialized
 			}
@@ -874,113 +1400,361 @@ namespace Irrelon {
 		DynaVal &push (const bool b) { return push(DynaVal(b)); }
 
 		[[nodiscard]] DynaVal deepCopy () const {
+			return visit(DynaOverloaded{
+				[this](const DynaError &err) {
+					// A static error never changes, so the copy can keep referring to it
+					return isStaticError() ? DynaVal::staticError(err) : DynaVal::error(err);
+				},
+				[](DynaUndefined) { return DynaVal().becomeUndefined(); },
+				[](std::nullptr_t) { return DynaVal().becomeNull(); },
+				[](const bool value) { return DynaVal(value); },
+				[this](const std::string &) {
+					// Copies the member rather than the bytes it reads as, so a shared string stays shared
+					DynaVal copy;
+					copy.type = DynaValType::String;
+					copy.string = string;
+					return copy;
+				},
+				[](const DynaValArray &items) {
+					DynaValArray newArray;
+					newArray.reserve(items.size());
+					for (const auto &item : items) {
+						newArray.push_back(item.deepCopy());
+					}
+					return DynaVal(std::move(newArray));
+				},
+				[](const DynaValObject &entries) {
+					DynaValObject newObject;
+					newObject.reserve(entries.size());
+					for (const auto &[k, v] : entries) {
+						newObject[k] = v.deepCopy();
+					}
+					return DynaVal(std::move(newObject));
+				},
+				[this](auto) {
+					// Copies the stored number as is, keeping its type
+					DynaVal copy;
+					copy.type = type;
+					copy.number = number;
+					return copy;
+				}
+			});
+		}
+
+		/**
+		 * Deep copies like deepCopy() but copies the children of large arrays
+		 * and objects on the task pool. Containers smaller than policy.cutoff
+		 * are copied sequentially.
+		 */
+		[[nodiscard]] DynaVal deepCopy (const DynaParallelPolicy &policy) const {
+			if (type == DynaValType::Array && array && policy.shouldSplit(array->size())) {
+				DynaValArray newArray(array->size());
+				dynaParallelFor(policy, array->size(), [&](size_t, const size_t begin, const size_t end) {
+					for (size_t i = begin; i < end; ++i) {
+						newArray[i] = (*array)[i].deepCopy(policy);
+					}
+				});
+				return DynaVal(std::move(newArray));
+			}
+
+			if (type == DynaValType::Object && object && policy.shouldSplit(object->size())) {
+				const auto entries = _objectEntries();
+				std::vector<DynaVal> values(entries.size());
+				dynaParallelFor(policy, entries.size(), [&](size_t, const size_t begin, const size_t end) {
+					for (size_t i = begin; i < end; ++i) {
+						values[i] = entries[i]->second.deepCopy(policy);
+					}
+				});
+
+				DynaValObject newObject;
+				newObject.reserve(entries.size());
+				for (size_t i = 0; i < entries.size(); ++i) {
+					newObject.emplace(entries[i]->first, std::move(values[i]));
+				}
+				return DynaVal(std::move(newObject));
+			}
+
+			if (type == DynaValType::Array && array) {
+				DynaValArray newArray;
+				newArray.reserve(array->size());
+				for (const auto &item : *array) {
+					newArray.push_back(item.deepCopy(policy));
+				}
+				return DynaVal(std::move(newArray));
+			}
+
+			if (type == DynaValType::Object && object) {
+				DynaValObject newObject;
+				newObject.reserve(object->size());
+				for (const auto &[k, v] : *object) {
+					newObject.emplace(k, v.deepCopy(policy));
+				}
+				return DynaVal(std::move(newObject));
+			}
+
+			return deepCopy();
+		}
+
+		/**
+		 * Deep structural equality. Numbers compare by value regardless of
+		 * their numeric type, arrays compare element by element and objects
+		 * compare key by key. Values sharing the same storage short-circuit.
+		 */
+		[[nodiscard]] bool equals (const DynaVal &other) const {
+			if (isNumber() && other.isNumber()) return number == other.number;
+			if (type != other.type) return false;
+
 			switch (type) {
-				case DynaValType::Error:
-					return DynaVal().becomeError();
-				case DynaValType::Any:
-				case DynaValType::Undefined:
-					return DynaVal().becomeUndefined();
-				case DynaValType::Null:
-					return DynaVal().becomeNull();
-				case DynaValType::Int:
-					return DynaVal().becomeInt() = number;
-				case DynaValType::UInt:
-					return DynaVal().becomeUInt() = number;
-				case DynaValType::Float:
-					return DynaVal().becomeFloat() = number;
-				case DynaValType::Double:
-					return DynaVal().becomeDouble() = number;
-				case DynaValType::Long:
-					return DynaVal().becomeLong() = number;
 				case DynaValType::Bool:
-					return DynaVal(boolean);
+					return boolean == other.boolean;
 				case DynaValType::String:
-					return DynaVal(string);
+					return string == other.string;
+				case DynaValType::Error:
+					if (errorData == other.errorData) return true;
+					if (!errorData || !other.errorData) return false;
+					return errorData->message == other.errorData->message &&
+						errorData->statusCode == other.errorData->statusCode;
 				case DynaValType::Array: {
-					DynaValArray newArray;
-					if (array) {
-						for (const auto &item : *array) {
-							newArray.push_back(item.deepCopy());
-						}
+					if (array == other.array) return true;
+					if (size() != other.size()) return false;
+					if (!array) return true;
+					for (size_t i = 0; i < array->size(); ++i) {
+						if (!(*array)[i].equals((*other.array)[i])) return false;
 					}
-					return {std::move(newArray)};
+					return true;
 				}
 				case DynaValType::Object: {
-					DynaValObject newObject;
-					if (object) {
-						for (const auto &[k, v] : *object) {
-							newObject[k] = v.deepCopy();
-						}
+					if (object == other.object) return true;
+					if (size() != other.size()) return false;
+					if (!object) return true;
+					for (const auto &[key, val] : *object) {
+						const auto it = other.object->find(key);
+						if (it == other.object->end() || !val.equals(it->second)) return false;
 					}
-					return {std::move(newObject)};
+					return true;
 				}
+				default:
+					return true;
+			}
+		}
+
+		/**
+		 * Deep equality like equals() but compares the children of large
+		 * arrays and objects on the task pool, stopping early once any chunk
+		 * finds a difference.
+		 */
+		[[nodiscard]] bool equals (const DynaVal &other, const DynaParallelPolicy &policy) const {
+			if (type != other.type || (type != DynaValType::Array && type != DynaValType::Object)) {
+				return equals(other);
+			}
+
+			if (type == DynaValType::Array ? array == other.array : object == other.object) return true;
+			if (size() != other.size()) return false;
+			if (!size()) return true;
+
+			const auto childEquals = [&](const DynaVal &mine, const DynaVal &theirs) {
+				return mine.equals(theirs, policy);
+			};
+
+			if (!policy.shouldSplit(size())) {
+				if (type == DynaValType::Array) {
+					for (size_t i = 0; i < array->size(); ++i) {
+						if (!childEquals((*array)[i], (*other.array)[i])) return false;
+					}
+					return true;
+				}
+
+				for (const auto &[key, val] : *object) {
+					const auto it = other.object->find(key);
+					if (it == other.object->end() || !childEquals(val, it->second)) return false;
+				}
+				return true;
+			}
+
+			std::atomic<bool> same{true};
+
+			if (type == DynaValType::Array) {
+				dynaParallelFor(policy, array->size(), [&](size_t, const size_t begin, const size_t end) {
+					for (size_t i = begin; i < end && same.load(std::memory_order_relaxed); ++i) {
+						if (!childEquals((*array)[i], (*other.array)[i])) same = false;
+					}
+				});
+				return same;
 			}
 
-			// Fallback shouldn't happen
-			return {};
+			const auto entries = _objectEntries();
+			dynaParallelFor(policy, entries.size(), [&](size_t, const size_t begin, const size_t end) {
+				for (size_t i = begin; i < end && same.load(std::memory_order_relaxed); ++i) {
+					const auto it = other.object->find(entries[i]->first);
+					if (it == other.object->end() || !childEquals(entries[i]->second, it->second)) same = false;
+				}
+			});
+			return same;
 		}
 
-		static DynaVal error (const DynaError err) {
+		/**
+		 * Computes the RFC 6902 JSON Patch that turns `from` into `to`, as an
+		 * array of operation objects. Subtrees that share storage are skipped
+		 * without being walked. Defined in dynaPatch.h.
+		 */
+		[[nodiscard]] static DynaVal diff (const DynaVal &from, const DynaVal &to);
+
+		/**
+		 * Applies an RFC 6902 JSON Patch to this value in place. Operations
+		 * are applied in order and the first failing operation stops the
+		 * patch, leaving earlier operations applied. Returns an error value
+		 * describing the failure, or null on success. The rvalue overload
+		 * moves values out of the patch instead of copying them, unless
+		 * another handle shares the patch's storage. Defined in dynaPatch.h.
+		 */
+		DynaVal applyPatch (const DynaVal &patch);
+
+		DynaVal applyPatch (DynaVal &&patch);
+
+		static DynaVal error (DynaError err) {
 			auto val = DynaVal();
 			val.type = DynaValType::Error;
-			val.errorData = std::make_shared<DynaError>(err); // copy into shared_ptr
+			val.errorData = std::make_shared<DynaError>(std::move(err));
 			return val;
 		}
 
 		static DynaVal error (
-			const std::string &message,
+			std::string message,
 			const int statusCode = 0,
 			const std::vector<std::string> &stack = {}
 		) {
 			DynaVal val;
 			val.type = DynaValType::Error;
-			val.errorData = std::make_shared<DynaError>();
-			val.errorData->message = message;
-			val.errorData->statusCode = statusCode;
-			val.errorData->stack = std::make_shared<DynaVal>();
-			val.errorData->stack->becomeArray().clear();
-
-			for (const auto &frame : stack) {
-				val.errorData->stack->push(DynaVal(frame));
+			auto err = std::make_shared<DynaError>(std::move(message), statusCode);
+			if (!stack.empty()) {
+				err->stack = std::make_shared<DynaVal>();
+				err->stack->becomeArray().reserve(stack.size());
+				for (const auto &frame : stack) {
+					err->stack->push(DynaVal(frame));
+				}
 			}
+			val.errorData = std::move(err);
+			return val;
+		}
+
+		/**
+		 * An error value that refers to err instead of copying it, so making
+		 * and copying it allocates nothing. err must outlive every value that
+		 * refers to it, which a function-local static does:
+		 *
+		 *   static const Irrelon::DynaError notFound("Not found", 404);
+		 *   return Irrelon::DynaVal::staticError(notFound);
+		 *
+		 * Use editError() to change such a value, it copies err first.
+		 */
+		static DynaVal staticError (const DynaError &err) {
+			DynaVal val;
+			val.type = DynaValType::Error;
+			// Aliasing an empty owner gives a pointer without a control block or count
+			val.errorData = std::shared_ptr<const DynaError>(std::shared_ptr<const DynaError>(), &err);
 			return val;
 		}
 
+		// True for a value made by staticError() (or copied from one)
+		[[nodiscard]] bool isStaticError () const {
+			return type == DynaValType::Error && errorData && errorData.use_count() == 0;
+		}
+
+		/**
+		 * The error for changing in place. The first call copies the error,
+		 * so the change stays local to this value; later calls change that
+		 * copy as long as no other value shares it.
+		 */
+		DynaError &editError () {
+			ensureMutable();
+			_touch();
+			becomeError();
+			// The copy below, or an error assigned to errorData since, which make_shared builds non-const either way
+			if (errorOwned && errorData.use_count() == 1) return const_cast<DynaError &>(*errorData);
+
+			auto owned = errorData ? std::make_shared<DynaError>(*errorData) : std::make_shared<DynaError>();
+			DynaError &err = *owned;
+			errorData = std::move(owned);
+			errorOwned = true;
+			return err;
+		}
+
+		// The error's stack frames, an empty array when it has none
+		[[nodiscard]] const DynaVal &errorStack () const {
+			if (type == DynaValType::Error && errorData && errorData->stack) return *errorData->stack;
+			return _emptyStack();
+		}
+
+		// The error's stack frames for changing, allocated on the first call
+		DynaVal &editErrorStack () {
+			DynaError &err = editError();
+			if (!err.stack) {
+				err.stack = std::make_shared<DynaVal>();
+				err.stack->becomeArray();
+			} else if (err.stack.use_count() != 1) {
+				err.stack = std::make_shared<DynaVal>(err.stack->deepCopy());
+			}
+			return *err.stack;
+		}
+
 	private:
-		void _toJson (std::ostringstream &out) const {
-			switch (type) {
-				case DynaValType::Error:
-					out << errorData->toString();
-					break;
+		/**
+		 * Frozen containers emit their memoized JSON. The first serialization
+		 * of a frozen container fills its memo; containers below it are then
+		 * written without filling their own so the memo is not repeated at
+		 * every depth of the tree.
+		 */
+		void _toJson (std::ostringstream &out, const bool fillCache = true, const bool inheritCache = false) const {
+			if (!frozen && (type == DynaValType::Array || type == DynaValType::Object)) {
+				if (inheritCache && !_cache()) _setCache(std::make_shared<DynaValCache>());
+
+				// Unsynchronized: a cached tree that is not frozen is serialized from one thread only
+				if (DynaValCache *cache = _cache()) {
+					cache->parent = cacheLink->parent;
+
+					if (!cache->jsonReady.load(std::memory_order_relaxed)) {
+						std::ostringstream fragment;
+						_writeJson(fragment, fillCache, true);
+						cache->json = fragment.str();
+						cache->jsonReady.store(true, std::memory_order_release);
+					}
 
-				case DynaValType::Any:
-				case DynaValType::Undefined:
-					out << "undefined";
-					break;
-				case DynaValType::Null:
-					out << "null";
-					break;
-				case DynaValType::Float:
-					out << number;
-					break;
-				case DynaValType::Int:
-					out << number;
-					break;
-				case DynaValType::UInt:
-					out << number;
-					break;
-				case DynaValType::Double:
-					out << number;
-					break;
-				case DynaValType::Long:
-					out << number;
-					break;
-				case DynaValType::Bool:
-					out << std::boolalpha << boolean;
-					break;
-				case DynaValType::String:
+					out << cache->json;
+					return;
+				}
+			}
+
+			if (DynaValCache *cache = frozen ? _cache() : nullptr) {
+				if (!cache->jsonReady.load(std::memory_order_acquire)) {
+					if (!fillCache) {
+						_writeJson(out, false, false);
+						return;
+					}
+
+					std::call_once(cache->jsonOnce, [this, cache] {
+						std::ostringstream fragment;
+						_writeJson(fragment, false, false);
+						cache->json = fragment.str();
+						cache->jsonReady.store(true, std::memory_order_release);
+					});
+				}
+
+				out << cache->json;
+				return;
+			}
+
+			_writeJson(out, fillCache, false);
+		}
+
+		void _writeJson (std::ostringstream &out, const bool fillCache, const bool inheritCache) const {
+			visit(DynaOverloaded{
+				[&out](const DynaError &err) { err.writeTo(out); },
+				[&out](DynaUndefined) { out << "undefined"; },
+				[&out](std::nullptr_t) { out << "null"; },
+				[&out](const bool value) { out << std::boolalpha << value; },
+				[&out](const std::string &value) {
 					out << '"';
-					for (const char stringChar : string) {
+					for (const char stringChar : value) {
 						switch (stringChar) {
 							case '"':
 								out << "\\\"";
@@ -1010,32 +1784,352 @@ namespace Irrelon {
 						}
 					}
 					out << '"';
-					break;
-				case DynaValType::Array:
+				},
+				[&](const DynaValArray &items) {
 					out << '[';
-					for (size_t i = 0; i < array->size(); ++i) {
-						if (i > 0) out << ',';
-						if ((*array)[i]) {
-							(*array)[i]._toJson(out);
-						} else {
-							out << "nullptr";
-							//throw std::runtime_error("WARNING: Null pointer value detected as an array entry!");
-						}
-					}
+					_arrayRangeToJson(out, 0, items.size(), nullptr, fillCache, inheritCache);
 					out << "]";
-					break;
-				case DynaValType::Object:
+				},
+				[&](const DynaValObject &entries) {
 					out << '{';
 					bool first = true;
-					for (const auto &[key, val] : *object) {
+					for (const auto &[key, val] : entries) {
 						if (!first) out << ',';
 						first = false;
-						out << '"' << key << "\":";
-						val._toJson(out);
+						if (inheritCache) val._setParentCache(_cachePtr());
+						_objectEntryToJson(out, key, val, nullptr, fillCache, inheritCache);
 					}
 					out << '}';
-					break;
+				},
+				// Every numeric type prints its value as a double
+				[&out](const auto number) { out << static_cast<double>(number); }
+			});
+		}
+
+		void _toJson (std::ostringstream &out, const DynaParallelPolicy &policy) const {
+			if (_cache() && (frozen || !isDirty())) {
+				_toJson(out);
+				return;
+			}
+
+			if (type == DynaValType::Array && array && policy.shouldSplit(array->size())) {
+				std::vector<std::string> chunks(policy.chunkCount(array->size()));
+				dynaParallelFor(policy, array->size(), [&](const size_t chunk, const size_t begin, const size_t end) {
+					std::ostringstream chunkOut;
+					if (begin > 0) chunkOut << ',';
+					_arrayRangeToJson(chunkOut, begin, end, &policy);
+					chunks[chunk] = chunkOut.str();
+				});
+
+				out << '[';
+				for (const auto &chunk : chunks) out << chunk;
+				out << ']';
+				return;
+			}
+
+			if (type == DynaValType::Object && object && policy.shouldSplit(object->size())) {
+				const auto entries = _objectEntries();
+				std::vector<std::string> chunks(policy.chunkCount(entries.size()));
+				dynaParallelFor(policy, entries.size(), [&](const size_t chunk, const size_t begin, const size_t end) {
+					std::ostringstream chunkOut;
+					for (size_t i = begin; i < end; ++i) {
+						if (i > 0) chunkOut << ',';
+						_objectEntryToJson(chunkOut, entries[i]->first, entries[i]->second, &policy);
+					}
+					chunks[chunk] = chunkOut.str();
+				});
+
+				out << '{';
+				for (const auto &chunk : chunks) out << chunk;
+				out << '}';
+				return;
+			}
+
+			if (type == DynaValType::Array && array) {
+				out << '[';
+				_arrayRangeToJson(out, 0, array->size(), &policy);
+				out << ']';
+				return;
 			}
+
+			if (type == DynaValType::Object && object) {
+				out << '{';
+				bool first = true;
+				for (const auto &[key, val] : *object) {
+					if (!first) out << ',';
+					first = false;
+					_objectEntryToJson(out, key, val, &policy);
+				}
+				out << '}';
+				return;
+			}
+
+			_toJson(out);
+		}
+
+		void _arrayRangeToJson (
+			std::ostringstream &out,
+			const size_t begin,
+			const size_t end,
+			const DynaParallelPolicy *policy = nullptr,
+			const bool fillCache = true,
+			const bool inheritCache = false
+		) const {
+			for (size_t i = begin; i < end; ++i) {
+				if (i > begin) out << ',';
+				if ((*array)[i]) {
+					if (policy) {
+						(*array)[i]._toJson(out, *policy);
+					} else {
+						if (inheritCache) (*array)[i]._setParentCache(_cachePtr());
+						(*array)[i]._toJson(out, fillCache, inheritCache);
+					}
+				} else {
+					out << "nullptr";
+					//throw std::runtime_error("WARNING: Null pointer value detected as an array entry!");
+				}
+			}
+		}
+
+		static void _objectEntryToJson (
+			std::ostringstream &out,
+			const std::string &key,
+			const DynaVal &val,
+			const DynaParallelPolicy *policy = nullptr,
+			const bool fillCache = true,
+			const bool inheritCache = false
+		) {
+			out << '"' << key << "\":";
+			if (policy) {
+				val._toJson(out, *policy);
+			} else {
+				val._toJson(out, fillCache, inheritCache);
+			}
+		}
+
+		// Stable list of object entries so chunks can be addressed by index
+		[[nodiscard]] std::vector<const DynaValObject::value_type *> _objectEntries () const {
+			std::vector<const DynaValObject::value_type *> entries;
+			entries.reserve(object->size());
+			for (const auto &entry : *object) entries.push_back(&entry);
+			return entries;
+		}
+
+		// Whether number converts to T without leaving its range or, for integers, dropping a fraction
+		template <typename T>
+		[[nodiscard]] bool _numberFits () const {
+			if constexpr (std::is_floating_point_v<T>) {
+				return !std::isfinite(number) || std::fabs(number) <= static_cast<double>(std::numeric_limits<T>::max());
+			} else {
+				// max() + 1 is a power of two, so it is exact as a double where max() is not
+				return std::trunc(number) == number && number >= static_cast<double>(std::numeric_limits<T>::min()) &&
+					number < static_cast<double>(std::numeric_limits<T>::max() / 2 + 1) * 2;
+			}
+		}
+
+		// The DynaValType whose visit() alternative is T
+		template <typename T>
+		static constexpr DynaValType _typeOf () {
+			if constexpr (std::is_same_v<T, bool>) return DynaValType::Bool;
+			else if constexpr (std::is_same_v<T, int>) return DynaValType::Int;
+			else if constexpr (std::is_same_v<T, unsigned int>) return DynaValType::UInt;
+			else if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, long> || std::is_same_v<T, long long>) return DynaValType::Long;
+			else if constexpr (std::is_same_v<T, float>) return DynaValType::Float;
+			else if constexpr (std::is_same_v<T, double>) return DynaValType::Double;
+			else if constexpr (std::is_same_v<T, std::string>) return DynaValType::String;
+			else if constexpr (std::is_same_v<T, DynaValArray>) return DynaValType::Array;
+			else if constexpr (std::is_same_v<T, DynaValObject>) return DynaValType::Object;
+			else if constexpr (std::is_same_v<T, DynaError>) return DynaValType::Error;
+			else if constexpr (std::is_same_v<T, std::nullptr_t>) return DynaValType::Null;
+			else static_assert(!sizeof(T), "DynaVal::is<T>() needs a type that visit() passes");
+		}
+
+		// Stand-ins visit() passes for a container or error whose storage was never allocated
+		static const DynaValArray &_emptyArray () {
+			static const DynaValArray empty;
+			return empty;
+		}
+
+		static const DynaValObject &_emptyObject () {
+			static const DynaValObject empty;
+			return empty;
+		}
+
+		static const DynaError &_emptyError () {
+			static const DynaError empty;
+			return empty;
+		}
+
+		static const DynaVal &_emptyStack () {
+			static const DynaVal empty = [] {
+				DynaVal stack;
+				stack.becomeArray().freeze();
+				return stack;
+			}();
+			return empty;
+		}
+
+		// Fills out from a byte array, returns why it cannot or nullptr on success
+		const char *_arrayToString (std::string &out) const {
+			if (!isArray()) {
+				return "arrayToString() called on non-array DynaVal";
+			}
+
+			const auto& arr = toArray();
+			out.reserve(arr.size()); // reserve memory up front
+
+			for (const auto& item : arr) {
+				if (!item.isUInt()) {
+					return "arrayToString(): all elements must be unsigned integers";
+				}
+
+				const unsigned int val = item.toUInt();
+				if (val > 255) {
+					return "arrayToString(): element out of byte range (0–255)";
+				}
+
+				out.push_back(static_cast<char>(static_cast<uint8_t>(val)));
+			}
+
+			return nullptr;
+		}
+
+		// Invalidates the cached fragment of mutable storage before it changes
+		void _touch () const {
+			// Values outside cached trees have nothing to invalidate
+			if (!cacheLink) return;
+			const auto parent = cacheLink->parent.lock();
+			DynaValCache *cache = cacheLink->cache.get();
+
+			if (cache && !frozen) {
+				cache->jsonReady.store(false, std::memory_order_relaxed);
+				// A copy held outside the tree only reaches the containers above through its cache
+				const auto cacheParent = cache->parent.lock();
+				if (cacheParent != parent) _invalidateUpwards(cacheParent);
+			}
+
+			_invalidateUpwards(parent);
+		}
+
+		void _markSubtreeDirty () const {
+			if (frozen) return;
+			if (DynaValCache *cache = _cache()) cache->jsonReady.store(false, std::memory_order_relaxed);
+
+			if (type == DynaValType::Array && array) {
+				for (const auto &item : *array) item._markSubtreeDirty();
+			}
+
+			if (type == DynaValType::Object && object) {
+				for (const auto &[key, val] : *object) val._markSubtreeDirty();
+			}
+		}
+
+		// The memo of this value, or nullptr
+		[[nodiscard]] DynaValCache *_cache () const {
+			return cacheLink ? cacheLink->cache.get() : nullptr;
+		}
+
+		[[nodiscard]] const std::shared_ptr<DynaValCache> &_cachePtr () const {
+			static const std::shared_ptr<DynaValCache> none;
+			return cacheLink ? cacheLink->cache : none;
+		}
+
+		// Points this slot at memo, keeping its parent link
+		void _setCache (std::shared_ptr<DynaValCache> memo) const {
+			if (cacheLink) cacheLink->cache = std::move(memo);
+			else if (memo) cacheLink = std::make_unique<DynaValCacheLink>(DynaValCacheLink{std::move(memo), {}});
+		}
+
+		void _setParentCache (const std::shared_ptr<DynaValCache> &parent) const {
+			if (cacheLink) cacheLink->parent = parent;
+			else if (parent) cacheLink = std::make_unique<DynaValCacheLink>(DynaValCacheLink{nullptr, parent});
+		}
+
+		// A link carrying only other's memo, for a new slot copied from it
+		static std::unique_ptr<DynaValCacheLink> _copyCacheLink (const DynaVal &other) {
+			if (!other.cacheLink || !other.cacheLink->cache) return nullptr;
+			return std::make_unique<DynaValCacheLink>(DynaValCacheLink{other.cacheLink->cache, {}});
+		}
+
+		// Takes other's memo; other keeps its parent link, which still describes its slot
+		void _takeCache (DynaVal &other) {
+			if (!other.cacheLink) {
+				_setCache(nullptr);
+			} else if (!cacheLink && other.cacheLink->parent.expired()) {
+				cacheLink = std::move(other.cacheLink);
+			} else {
+				_setCache(std::move(other.cacheLink->cache));
+			}
+		}
+
+		static void _invalidateUpwards (std::shared_ptr<DynaValCache> cache) {
+			while (cache) {
+				cache->jsonReady.store(false, std::memory_order_relaxed);
+				cache = cache->parent.lock();
+			}
+		}
+
+		static size_t _hashCombine (const size_t seed, const size_t value) {
+			return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+		}
+
+		[[nodiscard]] size_t _computeHash () const {
+			if (isNumber()) return _hashCombine(1, std::hash<double>{}(number));
+
+			const size_t seed = static_cast<size_t>(type) + 2;
+
+			switch (type) {
+				case DynaValType::Bool:
+					return _hashCombine(seed, boolean);
+				case DynaValType::String:
+					return _hashCombine(seed, std::hash<std::string>{}(string));
+				case DynaValType::Error:
+					if (!errorData) return seed;
+					return _hashCombine(_hashCombine(seed, std::hash<std::string>{}(errorData->message)), errorData->statusCode);
+				case DynaValType::Array: {
+					size_t result = seed;
+					if (array) {
+						for (const auto &item : *array) result = _hashCombine(result, item.hash());
+					}
+					return result;
+				}
+				case DynaValType::Object: {
+					// Summing keeps the result independent of bucket iteration order
+					size_t sum = 0;
+					if (object) {
+						for (const auto &[key, val] : *object) {
+							sum += _hashCombine(std::hash<std::string>{}(key), val.hash());
+						}
+					}
+					return _hashCombine(seed, sum);
+				}
+				default:
+					return seed;
+			}
+		}
+
+		[[nodiscard]] size_t _computeBytes () const {
+			size_t bytes = sizeof(DynaVal) + string.capacity();
+
+			if (type == DynaValType::Array && array) {
+				bytes += sizeof(DynaValArray) + (array->capacity() - array->size()) * sizeof(DynaVal);
+				for (const auto &item : *array) bytes += item.sizeInBytes();
+			}
+
+			if (type == DynaValType::Object && object) {
+				bytes += sizeof(DynaValObject) + object->bucket_count() * sizeof(void *);
+				for (const auto &[key, val] : *object) {
+					// Each node holds the key, the value and a next pointer
+					bytes += sizeof(std::string) + key.capacity() + sizeof(void *) + val.sizeInBytes();
+				}
+			}
+
+			// A static error's storage belongs to no value
+			if (type == DynaValType::Error && errorData && !isStaticError()) {
+				bytes += sizeof(DynaError) + errorData->message.capacity();
+			}
+
+			return bytes;
 		}
 	};
 
@@ -1126,4 +2220,6 @@ namespace Irrelon {
 
 		return node;
 	}
-}
\ No newline at end of file
+}
+
+#include "dynaPatch.h"
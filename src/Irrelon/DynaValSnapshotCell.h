@@ -0,0 +1,204 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	/**
+	 * Publishes immutable versions of a DynaVal tree from a single writer to
+	 * any number of concurrent readers.
+	 *
+	 * The writer calls publish() with its working tree. A frozen deep copy is
+	 * swapped in atomically, so the writer keeps mutating its own tree freely
+	 * and never waits on readers. Readers register once with reader() and then
+	 * call read(), which takes a few atomic operations and never blocks.
+	 *
+	 * Old versions are reclaimed with epoch-based reclamation: every read()
+	 * announces the epoch it started in, and a retired version is only deleted
+	 * once every active reader announced a later epoch.
+	 */
+	class DynaValSnapshotCell {
+		struct Version {
+			DynaVal value;
+			uint64_t number;
+		};
+
+		struct Retired {
+			Version *version;
+			uint64_t epoch;
+		};
+
+		static constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+
+		struct alignas(64) Slot {
+			std::atomic<uint64_t> epoch{kIdle};
+			std::atomic<bool> claimed{false};
+			// Live snapshots read through this slot, only touched by the reader's own thread
+			uint32_t pins = 0;
+		};
+
+	public:
+		/**
+		 * A pinned version of the published tree. The referenced value stays
+		 * valid and unchanged until the snapshot is destroyed.
+		 */
+		class Snapshot {
+		public:
+			Snapshot (const Snapshot &) = delete;
+			Snapshot &operator= (const Snapshot &) = delete;
+
+			Snapshot (Snapshot &&other) noexcept : _slot(other._slot), _version(other._version) {
+				other._slot = nullptr;
+				other._version = nullptr;
+			}
+
+			~Snapshot () {
+				if (_slot && --_slot->pins == 0) _slot->epoch.store(kIdle, std::memory_order_release);
+			}
+
+			[[nodiscard]] const DynaVal &operator* () const { return _version->value; }
+
+			[[nodiscard]] const DynaVal *operator-> () const { return &_version->value; }
+
+			[[nodiscard]] uint64_t version () const { return _version->number; }
+
+		private:
+			friend class DynaValSnapshotCell;
+
+			Snapshot (Slot *slot, const Version *version) : _slot(slot), _version(version) {}
+
+			Slot *_slot;
+			const Version *_version;
+		};
+
+		/**
+		 * A registered reader. Each reader owns one announcement slot, so a
+		 * reader and its snapshots must only be used from one thread. It may
+		 * hold several snapshots at once: the slot keeps the epoch of the
+		 * oldest until the last one is released, which pins every version
+		 * published since.
+		 */
+		class Reader {
+		public:
+			Reader (const Reader &) = delete;
+			Reader &operator= (const Reader &) = delete;
+
+			Reader (Reader &&other) noexcept : _cell(other._cell), _slot(other._slot) {
+				other._cell = nullptr;
+				other._slot = nullptr;
+			}
+
+			~Reader () {
+				if (_slot) _slot->claimed.store(false, std::memory_order_release);
+			}
+
+			[[nodiscard]] Snapshot read () const {
+				// A later read keeps the earlier epoch, so a snapshot still held stays pinned
+				if (_slot->pins++ == 0) _slot->epoch.store(_cell->_epoch.load());
+				return {_slot, _cell->_current.load()};
+			}
+
+		private:
+			friend class DynaValSnapshotCell;
+
+			Reader (const DynaValSnapshotCell *cell, Slot *slot) : _cell(cell), _slot(slot) {}
+
+			const DynaValSnapshotCell *_cell;
+			Slot *_slot;
+		};
+
+		explicit DynaValSnapshotCell (const size_t maxReaders = 16)
+			: DynaValSnapshotCell(DynaVal(), maxReaders) {}
+
+		explicit DynaValSnapshotCell (const DynaVal &initial, const size_t maxReaders = 16)
+			: _slots(new Slot[maxReaders]),
+			  _slotCount(maxReaders),
+			  _current(new Version{_frozenCopy(initial), 0}) {}
+
+		DynaValSnapshotCell (const DynaValSnapshotCell &) = delete;
+		DynaValSnapshotCell &operator= (const DynaValSnapshotCell &) = delete;
+
+		// All readers and snapshots must be released before the cell is destroyed
+		~DynaValSnapshotCell () {
+			for (const auto &retired : _retired) delete retired.version;
+			delete _current.load();
+		}
+
+		/**
+		 * Registers a reader, throwing if every slot is already claimed. Lock
+		 * free, safe to call from any thread.
+		 */
+		[[nodiscard]] Reader reader () const {
+			for (size_t i = 0; i < _slotCount; ++i) {
+				bool expected = false;
+				if (_slots[i].claimed.compare_exchange_strong(expected, true)) {
+					return {this, &_slots[i]};
+				}
+			}
+
+			detail::dynaThrow("DynaValSnapshotCell: no free reader slots");
+		}
+
+		/**
+		 * Publishes a frozen deep copy of `value` as the new current version
+		 * and reclaims any retired versions no reader can still observe.
+		 * Must only be called from the single writer.
+		 */
+		uint64_t publish (const DynaVal &value) {
+			auto *next = new Version{_frozenCopy(value), ++_published};
+			Version *previous = _current.exchange(next);
+			_retired.push_back({previous, _epoch.fetch_add(1)});
+			reclaim();
+			return next->number;
+		}
+
+		/**
+		 * Deletes retired versions that were superseded before every active
+		 * reader started its read. Returns the number still pending. Writer only.
+		 */
+		size_t reclaim () {
+			uint64_t oldestActive = kIdle;
+			for (size_t i = 0; i < _slotCount; ++i) {
+				const uint64_t epoch = _slots[i].epoch.load();
+				if (epoch < oldestActive) oldestActive = epoch;
+			}
+
+			size_t kept = 0;
+			for (auto &retired : _retired) {
+				if (retired.epoch < oldestActive) {
+					delete retired.version;
+				} else {
+					_retired[kept++] = retired;
+				}
+			}
+			_retired.resize(kept);
+
+			return kept;
+		}
+
+		// Retired versions waiting on readers. Writer only.
+		[[nodiscard]] size_t pending () const { return _retired.size(); }
+
+		// Number of the most recently published version, 0 for the initial value
+		[[nodiscard]] uint64_t version () const { return _current.load()->number; }
+
+	private:
+		std::unique_ptr<Slot[]> _slots;
+		size_t _slotCount;
+		std::atomic<Version *> _current;
+		std::atomic<uint64_t> _epoch{0};
+		uint64_t _published = 0;
+		std::vector<Retired> _retired;
+
+		static DynaVal _frozenCopy (const DynaVal &value) {
+			DynaVal copy = value.deepCopy();
+			copy.freeze();
+			return copy;
+		}
+	};
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace Irrelon {
+	/**
+	 * An immutable string whose copies share one buffer. Strings of up to
+	 * kInlineSize bytes fit std::string's own small buffer and are held
+	 * inline; longer ones live in a reference counted block, so copying a
+	 * DynaVal (assignment, push(), deepCopy(), array growth) bumps a count
+	 * instead of copying the bytes.
+	 *
+	 * It reads as a const std::string &, so code written against
+	 * DynaVal::string compiles either way. Changing it means assigning a
+	 * new value.
+	 */
+	class DynaSharedString {
+	public:
+		// Longest string kept inline, the small-string capacity of common std::string implementations
+		static constexpr size_t kInlineSize = 15;
+
+		DynaSharedString () noexcept : _inline() {}
+
+		DynaSharedString (std::string text) {
+			_init(std::move(text));
+		}
+
+		DynaSharedString (const char *text) : DynaSharedString(std::string(text)) {}
+
+		DynaSharedString (const DynaSharedString &other) : _shared(other._shared) {
+			if (_shared) new (&_block) Block(other._block);
+			else new (&_inline) std::string(other._inline);
+		}
+
+		DynaSharedString (DynaSharedString &&other) noexcept {
+			_moveFrom(other);
+		}
+
+		~DynaSharedString () {
+			_destroy();
+		}
+
+		DynaSharedString &operator= (const DynaSharedString &other) {
+			if (this != &other) *this = DynaSharedString(other);
+			return *this;
+		}
+
+		DynaSharedString &operator= (DynaSharedString &&other) noexcept {
+			if (this != &other) {
+				_destroy();
+				_moveFrom(other);
+			}
+			return *this;
+		}
+
+		[[nodiscard]] const std::string &str () const noexcept {
+			return _shared ? *_block : _inline;
+		}
+
+		operator const std::string & () const noexcept {
+			return str();
+		}
+
+		operator std::string_view () const noexcept {
+			return str();
+		}
+
+		[[nodiscard]] const char *c_str () const noexcept { return str().c_str(); }
+		[[nodiscard]] const char *data () const noexcept { return str().data(); }
+		[[nodiscard]] size_t size () const noexcept { return str().size(); }
+		[[nodiscard]] size_t length () const noexcept { return str().size(); }
+		[[nodiscard]] bool empty () const noexcept { return str().empty(); }
+		[[nodiscard]] size_t capacity () const noexcept { return str().capacity(); }
+
+		// True when the bytes are in a block other copies may share
+		[[nodiscard]] bool isShared () const noexcept { return _shared; }
+
+		[[nodiscard]] int compare (const std::string_view other) const noexcept {
+			return std::string_view(str()).compare(other);
+		}
+
+		void clear () noexcept {
+			*this = DynaSharedString();
+		}
+
+		void assign (const char *text, const size_t count) {
+			*this = DynaSharedString(std::string(text, count));
+		}
+
+		friend bool operator== (const DynaSharedString &a, const DynaSharedString &b) noexcept {
+			return (a._shared && b._shared && a._block == b._block) || a.str() == b.str();
+		}
+
+		friend bool operator== (const DynaSharedString &a, const std::string &b) noexcept { return a.str() == b; }
+		friend bool operator== (const DynaSharedString &a, const char *b) noexcept { return a.str() == b; }
+		friend bool operator< (const DynaSharedString &a, const DynaSharedString &b) noexcept { return a.str() < b.str(); }
+
+		friend std::string operator+ (const std::string &a, const DynaSharedString &b) { return a + b.str(); }
+		friend std::string operator+ (const DynaSharedString &a, const std::string &b) { return a.str() + b; }
+		friend std::string operator+ (const char *a, const DynaSharedString &b) { return a + b.str(); }
+		friend std::string operator+ (const DynaSharedString &a, const char *b) { return a.str() + b; }
+
+	private:
+		using Block = std::shared_ptr<const std::string>;
+
+		union {
+			std::string _inline;
+			Block _block;
+		};
+		bool _shared = false;
+
+		void _init (std::string &&text) {
+			if (text.size() <= kInlineSize) {
+				new (&_inline) std::string(std::move(text));
+			} else {
+				new (&_block) Block(std::make_shared<const std::string>(std::move(text)));
+				_shared = true;
+			}
+		}
+
+		// Takes other's storage and leaves it an empty inline string
+		void _moveFrom (DynaSharedString &other) noexcept {
+			_shared = other._shared;
+			if (_shared) new (&_block) Block(std::move(other._block));
+			else new (&_inline) std::string(std::move(other._inline));
+			other._destroy();
+			new (&other._inline) std::string();
+			other._shared = false;
+		}
+
+		void _destroy () noexcept {
+			if (_shared) _block.~Block();
+			else _inline.~basic_string();
+		}
+	};
+
+	/**
+	 * The type of DynaVal::string. Define DYNAVAL_SHARED_STRINGS to store
+	 * strings as DynaSharedString, so copies of a value share long string
+	 * bytes instead of duplicating them.
+	 */
+#ifdef DYNAVAL_SHARED_STRINGS
+	using DynaValString = DynaSharedString;
+#else
+	using DynaValString = std::string;
+#endif
+}
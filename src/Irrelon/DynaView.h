@@ -0,0 +1,484 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DynaVal.h"
+
+/**
+ * Flattened, read-only snapshot format for DynaVal trees.
+ *
+ * The whole tree lives in one contiguous little-endian buffer that can be
+ * written to a file or flash partition and read back in place through
+ * DynaView without deserializing. Offsets are relative to the buffer start.
+ *
+ *   Header   "DYNV", u8 version, 3 reserved bytes, u32 root offset, u32 total size
+ *   Node     u8 DynaValType followed by its payload:
+ *     Null, Undefined, Any  (none)
+ *     Bool                  u8
+ *     Int, UInt, Float,
+ *     Double, Long          8 byte IEEE 754 double
+ *     String                u32 length, bytes, NUL
+ *     Array                 u32 count, count x u32 element offset
+ *     Object                u32 count, count x (u32 key offset, u32 key length, u32 value offset)
+ *                           entries sorted by key bytes so lookups binary search
+ *     Error                 i32 status code, u32 message length, bytes, NUL
+ */
+namespace Irrelon {
+	namespace detail {
+		constexpr uint8_t kDynaSnapshotVersion = 1;
+		constexpr uint32_t kDynaSnapshotHeaderSize = 16;
+
+		// Byte is char or uint8_t, char keeps the readers usable in constant expressions
+		template <typename Byte>
+		constexpr uint32_t dynaReadU32 (const Byte *p) {
+			return static_cast<uint32_t>(static_cast<uint8_t>(p[0])) |
+				static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8 |
+				static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16 |
+				static_cast<uint32_t>(static_cast<uint8_t>(p[3])) << 24;
+		}
+
+		template <typename Byte>
+		constexpr double dynaReadDouble (const Byte *p) {
+			uint64_t bits = 0;
+			for (int i = 7; i >= 0; --i) bits = bits << 8 | static_cast<uint8_t>(p[i]);
+			return std::bit_cast<double>(bits);
+		}
+
+		class DynaSnapshotWriter {
+		public:
+			std::vector<uint8_t> write (const DynaVal &root) {
+				_out.assign(kDynaSnapshotHeaderSize, 0);
+				const uint32_t rootOffset = node(root);
+
+				_out[0] = 'D';
+				_out[1] = 'Y';
+				_out[2] = 'N';
+				_out[3] = 'V';
+				_out[4] = kDynaSnapshotVersion;
+				patchU32(8, rootOffset);
+				patchU32(12, static_cast<uint32_t>(_out.size()));
+
+				return std::move(_out);
+			}
+
+		private:
+			std::vector<uint8_t> _out;
+
+			[[nodiscard]] uint32_t here () const { return static_cast<uint32_t>(_out.size()); }
+
+			void u32 (const uint32_t value) {
+				for (int shift = 0; shift < 32; shift += 8) _out.push_back(static_cast<uint8_t>(value >> shift));
+			}
+
+			void patchU32 (const size_t at, const uint32_t value) {
+				for (int i = 0; i < 4; ++i) _out[at + i] = static_cast<uint8_t>(value >> (i * 8));
+			}
+
+			void bytes (const std::string &text) {
+				u32(static_cast<uint32_t>(text.size()));
+				_out.insert(_out.end(), text.begin(), text.end());
+				_out.push_back(0);
+			}
+
+			uint32_t node (const DynaVal &val) {
+				const uint32_t offset = here();
+				_out.push_back(static_cast<uint8_t>(val.type));
+
+				if (val.isNumber()) {
+					const auto bits = std::bit_cast<uint64_t>(val.number);
+					for (int shift = 0; shift < 64; shift += 8) _out.push_back(static_cast<uint8_t>(bits >> shift));
+					return offset;
+				}
+
+				switch (val.type) {
+					case DynaValType::Bool:
+						_out.push_back(val.boolean ? 1 : 0);
+						break;
+					case DynaValType::String:
+						bytes(val.string);
+						break;
+					case DynaValType::Error:
+						u32(static_cast<uint32_t>(val.errorData ? val.errorData->statusCode : 0));
+						bytes(val.errorData ? val.errorData->message : std::string());
+						break;
+					case DynaValType::Array: {
+						// clear() leaves no storage, which is a zero length array
+						if (!val.array) {
+							u32(0);
+							break;
+						}
+						const auto &arr = *val.array;
+						u32(static_cast<uint32_t>(arr.size()));
+						const size_t table = _out.size();
+						_out.resize(table + arr.size() * 4);
+						for (size_t i = 0; i < arr.size(); ++i) {
+							patchU32(table + i * 4, node(arr[i]));
+						}
+						break;
+					}
+					case DynaValType::Object: {
+						std::vector<const DynaValObject::value_type *> entries;
+						if (val.object) {
+							entries.reserve(val.object->size());
+							for (const auto &entry : *val.object) entries.push_back(&entry);
+						}
+						std::sort(entries.begin(), entries.end(), [](const auto *a, const auto *b) {
+							return std::string_view(a->first) < std::string_view(b->first);
+						});
+
+						u32(static_cast<uint32_t>(entries.size()));
+						const size_t table = _out.size();
+						_out.resize(table + entries.size() * 12);
+						for (size_t i = 0; i < entries.size(); ++i) {
+							const size_t row = table + i * 12;
+							patchU32(row, here());
+							patchU32(row + 4, static_cast<uint32_t>(entries[i]->first.size()));
+							_out.insert(_out.end(), entries[i]->first.begin(), entries[i]->first.end());
+							patchU32(row + 8, node(entries[i]->second));
+						}
+						break;
+					}
+					default:
+						break;
+				}
+
+				return offset;
+			}
+		};
+	}
+
+	// Flattens val into the snapshot format read by DynaView
+	[[nodiscard]] inline std::vector<uint8_t> dynaSnapshotWrite (const DynaVal &val) {
+		return detail::DynaSnapshotWriter().write(val);
+	}
+
+	/**
+	 * Read-only accessor over a snapshot buffer. A view is two words and
+	 * never allocates or copies; navigation only touches the bytes of the
+	 * nodes it visits. Missing keys and out of range indexes give a null
+	 * view, mirroring the const DynaVal accessors.
+	 *
+	 * The buffer must outlive every view into it. Views do not bounds check
+	 * on access, so call dynaSnapshotValidate() once for untrusted input.
+	 */
+	class DynaView {
+	public:
+		class Iterator {
+		public:
+			constexpr Iterator (const DynaView &parent, const uint32_t index)
+				: _base(parent._base), _offset(parent._offset), _index(index) {}
+
+			constexpr DynaView operator* () const { return DynaView(_base, _offset).valueAt(_index); }
+
+			// The key of the current object entry, empty when iterating an array
+			[[nodiscard]] constexpr std::string_view key () const { return DynaView(_base, _offset).keyAt(_index); }
+
+			constexpr Iterator &operator++ () {
+				++_index;
+				return *this;
+			}
+
+			constexpr bool operator!= (const Iterator &other) const { return _index != other._index; }
+
+			constexpr bool operator== (const Iterator &other) const { return _index == other._index; }
+
+		private:
+			const char *_base;
+			uint32_t _offset;
+			uint32_t _index;
+		};
+
+		constexpr DynaView () = default;
+
+		// Views the root node of a snapshot buffer, or null if the header is not valid
+		explicit DynaView (const uint8_t *snapshot) : DynaView(reinterpret_cast<const char *>(snapshot)) {}
+
+		// Same as above, usable in constant expressions over a char buffer
+		constexpr explicit DynaView (const char *snapshot) {
+			if (snapshot && snapshot[0] == 'D' && snapshot[1] == 'Y' && snapshot[2] == 'N' && snapshot[3] == 'V' &&
+				snapshot[4] == detail::kDynaSnapshotVersion) {
+				_base = snapshot;
+				_offset = detail::dynaReadU32(snapshot + 8);
+			}
+		}
+
+		[[nodiscard]] constexpr DynaValType type () const {
+			return _base ? static_cast<DynaValType>(_base[_offset]) : DynaValType::Null;
+		}
+
+		[[nodiscard]] constexpr bool isNull () const { return type() == DynaValType::Null; }
+
+		[[nodiscard]] constexpr bool isUndefined () const { return type() == DynaValType::Undefined; }
+
+		[[nodiscard]] constexpr bool isError () const { return type() == DynaValType::Error; }
+
+		[[nodiscard]] constexpr bool isBool () const { return type() == DynaValType::Bool; }
+
+		[[nodiscard]] constexpr bool isString () const { return type() == DynaValType::String; }
+
+		[[nodiscard]] constexpr bool isArray () const { return type() == DynaValType::Array; }
+
+		[[nodiscard]] constexpr bool isObject () const { return type() == DynaValType::Object; }
+
+		[[nodiscard]] constexpr bool isNumber () const {
+			const DynaValType t = type();
+			return t == DynaValType::Int || t == DynaValType::UInt || t == DynaValType::Float ||
+				t == DynaValType::Double || t == DynaValType::Long;
+		}
+
+		[[nodiscard]] constexpr size_t size () const {
+			return isArray() || isObject() ? detail::dynaReadU32(_payload()) : 0;
+		}
+
+		[[nodiscard]] constexpr double toDouble () const {
+			if (isNumber()) return detail::dynaReadDouble(_payload());
+			if (isBool()) return _payload()[0] ? 1 : 0;
+			return 0;
+		}
+
+		[[nodiscard]] constexpr float toFloat () const { return static_cast<float>(toDouble()); }
+
+		[[nodiscard]] constexpr int toInt () const { return static_cast<int>(toDouble()); }
+
+		[[nodiscard]] constexpr uint32_t toUInt () const { return static_cast<uint32_t>(toDouble()); }
+
+		[[nodiscard]] constexpr long toLong () const { return static_cast<long>(toDouble()); }
+
+		[[nodiscard]] constexpr bool toBool () const { return isBool() && _payload()[0] != 0; }
+
+		// Borrowed view of a string value (or error message) inside the buffer
+		[[nodiscard]] constexpr std::string_view toStringView () const {
+			if (isString()) return _text(_payload());
+			if (isError()) return _text(_payload() + 4);
+			return {};
+		}
+
+		[[nodiscard]] std::string toString () const {
+			if (isString()) return std::string(toStringView());
+			return toDynaVal().toString();
+		}
+
+		[[nodiscard]] constexpr int errorStatusCode () const {
+			return isError() ? static_cast<int>(detail::dynaReadU32(_payload())) : 0;
+		}
+
+		[[nodiscard]] constexpr DynaView operator[] (const size_t index) const {
+			return isArray() && index < size() ? valueAt(static_cast<uint32_t>(index)) : DynaView();
+		}
+
+		[[nodiscard]] constexpr DynaView operator[] (const int index) const {
+			return index < 0 ? DynaView() : (*this)[static_cast<size_t>(index)];
+		}
+
+		[[nodiscard]] constexpr DynaView operator[] (const std::string_view key) const {
+			uint32_t index = 0;
+			return _find(key, index) ? valueAt(index) : DynaView();
+		}
+
+		[[nodiscard]] constexpr DynaView operator[] (const char *key) const { return (*this)[std::string_view(key)]; }
+
+		[[nodiscard]] constexpr bool containsKey (const std::string_view key) const {
+			uint32_t index = 0;
+			return _find(key, index);
+		}
+
+		[[nodiscard]] constexpr Iterator begin () const { return {*this, 0}; }
+
+		[[nodiscard]] constexpr Iterator end () const { return {*this, static_cast<uint32_t>(size())}; }
+
+		// Key of the i-th object entry in sorted order, empty for arrays
+		[[nodiscard]] constexpr std::string_view keyAt (const uint32_t index) const {
+			if (!isObject()) return {};
+			const char *row = _payload() + 4 + index * 12;
+			return {_base + detail::dynaReadU32(row), detail::dynaReadU32(row + 4)};
+		}
+
+		// Value of the i-th array element or object entry
+		[[nodiscard]] constexpr DynaView valueAt (const uint32_t index) const {
+			if (isArray()) return {_base, detail::dynaReadU32(_payload() + 4 + index * 4)};
+			if (isObject()) return {_base, detail::dynaReadU32(_payload() + 4 + index * 12 + 8)};
+			return {};
+		}
+
+		// Copies this view and everything beneath it into a mutable DynaVal
+		[[nodiscard]] DynaVal toDynaVal () const {
+			DynaVal out;
+
+			switch (type()) {
+				case DynaValType::Undefined:
+				case DynaValType::Any:
+					out.becomeUndefined();
+					break;
+				case DynaValType::Bool:
+					out.set(toBool());
+					break;
+				case DynaValType::Int:
+				case DynaValType::UInt:
+				case DynaValType::Float:
+				case DynaValType::Double:
+				case DynaValType::Long:
+					out.type = type();
+					out.number = toDouble();
+					break;
+				case DynaValType::String:
+					out.set(std::string(toStringView()));
+					break;
+				case DynaValType::Error:
+					out = DynaVal::error(std::string(toStringView()), errorStatusCode());
+					break;
+				case DynaValType::Array: {
+					DynaValArray arr;
+					arr.reserve(size());
+					for (const DynaView item : *this) arr.push_back(item.toDynaVal());
+					out = DynaVal(std::move(arr));
+					break;
+				}
+				case DynaValType::Object: {
+					DynaValObject obj;
+					obj.reserve(size());
+					for (auto it = begin(); it != end(); ++it) obj.emplace(std::string(it.key()), (*it).toDynaVal());
+					out = DynaVal(std::move(obj));
+					break;
+				}
+				default:
+					break;
+			}
+
+			return out;
+		}
+
+		[[nodiscard]] std::string toJson () const { return toDynaVal().toJson(); }
+
+	private:
+		const char *_base = nullptr;
+		uint32_t _offset = 0;
+
+		constexpr DynaView (const char *base, const uint32_t offset) : _base(base), _offset(offset) {}
+
+		[[nodiscard]] constexpr const char *_payload () const { return _base + _offset + 1; }
+
+		[[nodiscard]] constexpr std::string_view _text (const char *lengthPrefixed) const {
+			return {lengthPrefixed + 4, detail::dynaReadU32(lengthPrefixed)};
+		}
+
+		// Binary search over the sorted key table
+		[[nodiscard]] constexpr bool _find (const std::string_view key, uint32_t &index) const {
+			if (!isObject()) return false;
+
+			uint32_t low = 0;
+			auto high = static_cast<uint32_t>(size());
+			while (low < high) {
+				const uint32_t mid = low + (high - low) / 2;
+				const std::string_view candidate = keyAt(mid);
+				if (candidate == key) {
+					index = mid;
+					return true;
+				}
+				if (candidate < key) low = mid + 1;
+				else high = mid;
+			}
+
+			return false;
+		}
+	};
+
+	namespace detail {
+		// Marks [begin, begin + count) as used, false if any of it already belongs to another node or key
+		inline bool dynaSnapshotClaim (std::vector<bool> &owned, const size_t begin, const size_t count) {
+			for (size_t i = begin; i < begin + count; ++i) {
+				if (owned[i]) return false;
+				owned[i] = true;
+			}
+			return true;
+		}
+
+		/**
+		 * Every node and key must occupy its own bytes. A buffer whose
+		 * offsets point back at a node already visited, or into the middle
+		 * of one, is rejected, so the work done is linear in the buffer size
+		 * however the offsets are arranged.
+		 */
+		inline bool dynaSnapshotValidateNode (
+			const uint8_t *data,
+			const size_t length,
+			const uint32_t offset,
+			const int depth,
+			std::vector<bool> &owned
+		) {
+			if (depth > 256 || offset >= length) return false;
+			const size_t remaining = length - offset - 1;
+			const uint8_t *payload = data + offset + 1;
+
+			switch (static_cast<DynaValType>(data[offset])) {
+				case DynaValType::Null:
+				case DynaValType::Undefined:
+				case DynaValType::Any:
+					return dynaSnapshotClaim(owned, offset, 1);
+				case DynaValType::Bool:
+					return remaining >= 1 && dynaSnapshotClaim(owned, offset, 2);
+				case DynaValType::Int:
+				case DynaValType::UInt:
+				case DynaValType::Float:
+				case DynaValType::Double:
+				case DynaValType::Long:
+					return remaining >= 8 && dynaSnapshotClaim(owned, offset, 9);
+				case DynaValType::String:
+					return remaining >= 4 && dynaReadU32(payload) < remaining - 4 &&
+						dynaSnapshotClaim(owned, offset, 6 + static_cast<size_t>(dynaReadU32(payload)));
+				case DynaValType::Error:
+					return remaining >= 8 && dynaReadU32(payload + 4) < remaining - 8 &&
+						dynaSnapshotClaim(owned, offset, 10 + static_cast<size_t>(dynaReadU32(payload + 4)));
+				case DynaValType::Array: {
+					if (remaining < 4) return false;
+					const uint64_t count = dynaReadU32(payload);
+					if (count * 4 > remaining - 4) return false;
+					if (!dynaSnapshotClaim(owned, offset, 5 + count * 4)) return false;
+					for (uint32_t i = 0; i < count; ++i) {
+						if (!dynaSnapshotValidateNode(data, length, dynaReadU32(payload + 4 + i * 4), depth + 1, owned)) return false;
+					}
+					return true;
+				}
+				case DynaValType::Object: {
+					if (remaining < 4) return false;
+					const uint64_t count = dynaReadU32(payload);
+					if (count * 12 > remaining - 4) return false;
+					if (!dynaSnapshotClaim(owned, offset, 5 + count * 12)) return false;
+					std::string_view previous;
+					for (uint32_t i = 0; i < count; ++i) {
+						const uint8_t *row = payload + 4 + i * 12;
+						const uint64_t keyOffset = dynaReadU32(row);
+						const uint64_t keyLength = dynaReadU32(row + 4);
+						if (keyOffset + keyLength > length || !dynaSnapshotClaim(owned, keyOffset, keyLength)) return false;
+						const std::string_view key(reinterpret_cast<const char *>(data + keyOffset), keyLength);
+						if (i > 0 && !(previous < key)) return false;
+						previous = key;
+						if (!dynaSnapshotValidateNode(data, length, dynaReadU32(row + 8), depth + 1, owned)) return false;
+					}
+					return true;
+				}
+				default:
+					return false;
+			}
+		}
+	}
+
+	/**
+	 * Checks that a snapshot buffer is well formed: header, every offset and
+	 * length in bounds, object keys sorted, and no two nodes or keys sharing
+	 * bytes. Only needed for buffers that did not come from
+	 * dynaSnapshotWrite() or a trusted partition.
+	 */
+	[[nodiscard]] inline bool dynaSnapshotValidate (const uint8_t *data, const size_t length) {
+		if (!data || length < detail::kDynaSnapshotHeaderSize) return false;
+		if (std::memcmp(data, "DYNV", 4) != 0 || data[4] != detail::kDynaSnapshotVersion) return false;
+		if (detail::dynaReadU32(data + 12) != length) return false;
+		std::vector<bool> owned(length);
+		if (!detail::dynaSnapshotClaim(owned, 0, detail::kDynaSnapshotHeaderSize)) return false;
+		return detail::dynaSnapshotValidateNode(data, length, detail::dynaReadU32(data + 8), 0, owned);
+	}
+}
@@ -0,0 +1,340 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "DynaVal.h"
+
+namespace Irrelon {
+	namespace detail {
+		inline std::string dynaPointerEscape (const std::string &token) {
+			std::string out;
+			out.reserve(token.size());
+			for (const char c : token) {
+				if (c == '~') out += "~0";
+				else if (c == '/') out += "~1";
+				else out += c;
+			}
+			return out;
+		}
+
+		// Splits a JSON Pointer into unescaped reference tokens, false if malformed
+		inline bool dynaPointerParse (const std::string &pointer, std::vector<std::string> &tokens) {
+			tokens.clear();
+			if (pointer.empty()) return true;
+			if (pointer[0] != '/') return false;
+
+			std::string token;
+			for (size_t i = 1; i <= pointer.size(); ++i) {
+				if (i == pointer.size() || pointer[i] == '/') {
+					tokens.push_back(std::move(token));
+					token.clear();
+				} else if (pointer[i] == '~') {
+					if (i + 1 >= pointer.size()) return false;
+					const char next = pointer[++i];
+					if (next == '0') token += '~';
+					else if (next == '1') token += '/';
+					else return false;
+				} else {
+					token += pointer[i];
+				}
+			}
+
+			return true;
+		}
+
+		// Parses an array index token, false for "-", leading zeros or non digits
+		inline bool dynaPointerIndex (const std::string &token, size_t &index) {
+			if (token.empty() || (token.size() > 1 && token[0] == '0')) return false;
+			index = 0;
+			for (const char c : token) {
+				if (c < '0' || c > '9') return false;
+				index = index * 10 + static_cast<size_t>(c - '0');
+			}
+			return true;
+		}
+
+		inline DynaVal dynaPatchOp (const char *op, const std::string &path) {
+			DynaVal node;
+			node["op"] = op;
+			node["path"] = path;
+			return node;
+		}
+
+		inline void dynaDiff (const DynaVal &from, const DynaVal &to, const std::string &path, DynaVal &ops) {
+			if (from.type != to.type) {
+				DynaVal op = dynaPatchOp("replace", path);
+				op["value"] = to.deepCopy();
+				ops.push(std::move(op));
+				return;
+			}
+
+			if (from.isArray()) {
+				if (from.array == to.array) return;
+
+				const size_t fromSize = from.size();
+				const size_t toSize = to.size();
+				const size_t common = std::min(fromSize, toSize);
+
+				for (size_t i = 0; i < common; ++i) {
+					dynaDiff((*from.array)[i], (*to.array)[i], path + "/" + std::to_string(i), ops);
+				}
+
+				// Remove from the end so the remaining indexes stay valid
+				for (size_t i = fromSize; i > toSize; --i) {
+					ops.push(dynaPatchOp("remove", path + "/" + std::to_string(i - 1)));
+				}
+
+				for (size_t i = common; i < toSize; ++i) {
+					DynaVal op = dynaPatchOp("add", path + "/-");
+					op["value"] = (*to.array)[i].deepCopy();
+					ops.push(std::move(op));
+				}
+				return;
+			}
+
+			if (from.isObject()) {
+				if (from.object == to.object) return;
+
+				if (from.object) {
+					for (const auto &[key, val] : *from.object) {
+						const std::string childPath = path + "/" + dynaPointerEscape(key);
+						if (!to.object || !to.containsKey(key)) {
+							ops.push(dynaPatchOp("remove", childPath));
+						} else {
+							dynaDiff(val, to.object->find(key)->second, childPath, ops);
+						}
+					}
+				}
+
+				if (to.object) {
+					for (const auto &[key, val] : *to.object) {
+						if (from.object && from.object->find(key) != from.object->end()) continue;
+						DynaVal op = dynaPatchOp("add", path + "/" + dynaPointerEscape(key));
+						op["value"] = val.deepCopy();
+						ops.push(std::move(op));
+					}
+				}
+				return;
+			}
+
+			if (!from.equals(to)) {
+				DynaVal op = dynaPatchOp("replace", path);
+				op["value"] = to.deepCopy();
+				ops.push(std::move(op));
+			}
+		}
+
+		/**
+		 * Walks tokens[0, count) from root without auto-vivifying. When the
+		 * caller is about to change what it reaches, every container on the
+		 * way is marked dirty; read-only walks leave the JSON cache alone.
+		 * Returns nullptr if a token does not resolve.
+		 */
+		inline DynaVal *dynaPointerWalk (DynaVal &root, const std::vector<std::string> &tokens, const size_t count, const bool mutating) {
+			DynaVal *current = &root;
+
+			for (size_t i = 0; i < count; ++i) {
+				if (current->isObject() && current->object) {
+					const auto it = current->object->find(tokens[i]);
+					if (it == current->object->end()) return nullptr;
+					if (mutating) current->markDirty(false);
+					current = &it->second;
+				} else if (current->isArray() && current->array) {
+					size_t index;
+					if (!dynaPointerIndex(tokens[i], index) || index >= current->array->size()) return nullptr;
+					if (mutating) current->markDirty(false);
+					current = &(*current->array)[index];
+				} else {
+					return nullptr;
+				}
+			}
+
+			return current;
+		}
+
+		inline DynaVal dynaPatchError (const size_t index, const std::string &message) {
+			return DynaVal::error("Patch operation " + std::to_string(index) + ": " + message, 422);
+		}
+
+		inline DynaVal dynaPatchFrozen (const size_t index) {
+			return DynaVal::error("Patch operation " + std::to_string(index) + ": target is frozen", 409);
+		}
+
+		enum class DynaPatchStep {
+			Applied,
+			NotFound,
+			Frozen
+		};
+
+		// Removes the value at tokens from root and hands it to out
+		inline DynaPatchStep dynaPatchTake (DynaVal &root, const std::vector<std::string> &tokens, DynaVal &out) {
+			if (tokens.empty()) {
+				out = std::move(root);
+				root.becomeNull();
+				return DynaPatchStep::Applied;
+			}
+
+			DynaVal *parent = dynaPointerWalk(root, tokens, tokens.size() - 1, true);
+			if (!parent) return DynaPatchStep::NotFound;
+			const std::string &last = tokens.back();
+
+			if (parent->isObject() && parent->object) {
+				const auto it = parent->object->find(last);
+				if (it == parent->object->end()) return DynaPatchStep::NotFound;
+				if (parent->isFrozen()) return DynaPatchStep::Frozen;
+				parent->markDirty(false);
+				out = std::move(it->second);
+				parent->object->erase(it);
+				return DynaPatchStep::Applied;
+			}
+
+			size_t index;
+			if (!parent->isArray() || !parent->array || !dynaPointerIndex(last, index) || index >= parent->array->size()) {
+				return DynaPatchStep::NotFound;
+			}
+
+			if (parent->isFrozen()) return DynaPatchStep::Frozen;
+			parent->markDirty(false);
+			out = std::move((*parent->array)[index]);
+			parent->array->erase(parent->array->begin() + static_cast<std::ptrdiff_t>(index));
+			return DynaPatchStep::Applied;
+		}
+
+		// Adds value at tokens following the RFC 6902 "add" rules
+		inline DynaPatchStep dynaPatchAdd (DynaVal &root, const std::vector<std::string> &tokens, DynaVal &&value) {
+			if (tokens.empty()) {
+				root = std::move(value);
+				return DynaPatchStep::Applied;
+			}
+
+			DynaVal *parent = dynaPointerWalk(root, tokens, tokens.size() - 1, true);
+			if (!parent) return DynaPatchStep::NotFound;
+			const std::string &last = tokens.back();
+
+			if (parent->isObject() && parent->object) {
+				if (parent->isFrozen()) return DynaPatchStep::Frozen;
+				parent->markDirty(false);
+				(*parent->object)[last] = std::move(value);
+				return DynaPatchStep::Applied;
+			}
+
+			if (!parent->isArray() || !parent->array) return DynaPatchStep::NotFound;
+
+			size_t index = parent->array->size();
+			if (last != "-" && (!dynaPointerIndex(last, index) || index > parent->array->size())) return DynaPatchStep::NotFound;
+
+			if (parent->isFrozen()) return DynaPatchStep::Frozen;
+			parent->markDirty(false);
+			parent->array->insert(parent->array->begin() + static_cast<std::ptrdiff_t>(index), std::move(value));
+			return DynaPatchStep::Applied;
+		}
+
+		template <typename Patch>
+		DynaVal dynaApplyPatch (DynaVal &target, Patch &&patch) {
+			// Values are moved out of the patch only when the caller gave it up
+			constexpr bool canMove = !std::is_const_v<std::remove_reference_t<Patch>>;
+
+			if (!patch.isArray()) {
+				static const DynaError notArray("Patch must be an array of operations", 400);
+				return DynaVal::staticError(notArray);
+			}
+
+			if (target.isFrozen()) {
+				static const DynaError frozenTarget("Cannot apply a patch to a frozen value", 409);
+				return DynaVal::staticError(frozenTarget);
+			}
+
+			std::vector<std::string> tokens;
+			std::vector<std::string> fromTokens;
+
+			// Copies of a DynaVal share its storage, so only storage no other handle can see is moved from
+			const bool ownsPatch = canMove && !patch.frozen && patch.array && patch.array.use_count() == 1;
+
+			for (size_t i = 0; i < patch.size(); ++i) {
+				const DynaVal &operation = (*patch.array)[i];
+				const bool ownsOperation = ownsPatch && operation.object && operation.object.use_count() == 1;
+				const DynaVal &opName = operation["op"];
+				const DynaVal &path = operation["path"];
+
+				if (!opName.isString()) return dynaPatchError(i, "missing op");
+				if (!path.isString() || !dynaPointerParse(path.string, tokens)) return dynaPatchError(i, "invalid path");
+
+				const std::string &op = opName.string;
+
+				const auto takeValue = [&operation, ownsOperation]() -> DynaVal {
+					const DynaVal &value = operation["value"];
+					if constexpr (canMove) {
+						if (ownsOperation) return std::move(const_cast<DynaVal &>(value));
+					}
+					return value;
+				};
+
+				if (op == "add") {
+					if (!operation.containsKey("value")) return dynaPatchError(i, "missing value");
+					const auto step = dynaPatchAdd(target, tokens, takeValue());
+					if (step == DynaPatchStep::Frozen) return dynaPatchFrozen(i);
+					if (step == DynaPatchStep::NotFound) return dynaPatchError(i, "path not found");
+				} else if (op == "replace") {
+					if (!operation.containsKey("value")) return dynaPatchError(i, "missing value");
+					DynaVal *current = dynaPointerWalk(target, tokens, tokens.size(), true);
+					if (!current) return dynaPatchError(i, "path not found");
+					if (current->solid) return dynaPatchFrozen(i);
+					*current = takeValue();
+				} else if (op == "remove") {
+					DynaVal removed;
+					const auto step = tokens.empty() ? DynaPatchStep::NotFound : dynaPatchTake(target, tokens, removed);
+					if (step == DynaPatchStep::Frozen) return dynaPatchFrozen(i);
+					if (step == DynaPatchStep::NotFound) return dynaPatchError(i, "path not found");
+				} else if (op == "move" || op == "copy") {
+					const DynaVal &from = operation["from"];
+					if (!from.isString() || !dynaPointerParse(from.string, fromTokens)) return dynaPatchError(i, "invalid from");
+
+					DynaVal value;
+					if (op == "move") {
+						if (fromTokens.size() < tokens.size() && std::equal(fromTokens.begin(), fromTokens.end(), tokens.begin())) {
+							return dynaPatchError(i, "cannot move a value into itself");
+						}
+						const auto step = dynaPatchTake(target, fromTokens, value);
+						if (step == DynaPatchStep::Frozen) return dynaPatchFrozen(i);
+						if (step == DynaPatchStep::NotFound) return dynaPatchError(i, "from not found");
+					} else {
+						const DynaVal *source = dynaPointerWalk(target, fromTokens, fromTokens.size(), false);
+						if (!source) return dynaPatchError(i, "from not found");
+						value = source->deepCopy();
+					}
+
+					const auto step = dynaPatchAdd(target, tokens, std::move(value));
+					if (step != DynaPatchStep::Applied && op == "move") {
+						// The add left value untouched, so it goes back where it was taken from
+						dynaPatchAdd(target, fromTokens, std::move(value));
+					}
+					if (step == DynaPatchStep::Frozen) return dynaPatchFrozen(i);
+					if (step == DynaPatchStep::NotFound) return dynaPatchError(i, "path not found");
+				} else if (op == "test") {
+					const DynaVal *current = dynaPointerWalk(target, tokens, tokens.size(), false);
+					if (!current || !current->equals(operation["value"])) return dynaPatchError(i, "test failed");
+				} else {
+					return dynaPatchError(i, "unknown op \"" + op + "\"");
+				}
+			}
+
+			return {};
+		}
+	}
+
+	inline DynaVal DynaVal::diff (const DynaVal &from, const DynaVal &to) {
+		DynaVal ops;
+		ops.becomeArray();
+		detail::dynaDiff(from, to, "", ops);
+		return ops;
+	}
+
+	inline DynaVal DynaVal::applyPatch (const DynaVal &patch) {
+		return detail::dynaApplyPatch(*this, patch);
+	}
+
+	inline DynaVal DynaVal::applyPatch (DynaVal &&patch) {
+		return detail::dynaApplyPatch(*this, patch);
+	}
+}
@@ -0,0 +1,288 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DynaVal.h"
+#include "dynaThrow.h"
+
+namespace Irrelon {
+	namespace detail {
+		/**
+		 * A sort key extracted once per element. Numbers, strings and bools
+		 * are reduced to 64 ordered bits (strings to their first 8 bytes) so
+		 * most comparisons never touch the element again.
+		 */
+		struct DynaSortKey {
+			// 0 numbers, 1 strings, 2 bools, 3 + type for anything else, kDynaSortMissing for no key
+			uint8_t rank = 0;
+			uint64_t bits = 0;
+			const std::string *text = nullptr;
+			size_t index = 0;
+		};
+
+		// Compact key for the all-numeric radix path
+		struct DynaSortBits {
+			uint64_t bits;
+			size_t index;
+		};
+
+		constexpr uint8_t kDynaSortMissing = 255;
+
+		// Maps a double onto unsigned bits that sort in the same order
+		inline uint64_t dynaSortableBits (const double value) {
+			const uint64_t bits = std::bit_cast<uint64_t>(value == 0 ? 0.0 : value);
+			return bits & 0x8000000000000000ull ? ~bits : bits | 0x8000000000000000ull;
+		}
+
+		// The first 8 bytes of a string, big endian and zero padded
+		inline uint64_t dynaStringPrefix (const std::string &text) {
+			uint64_t prefix = 0;
+			for (size_t i = 0; i < 8; ++i) {
+				prefix <<= 8;
+				if (i < text.size()) prefix |= static_cast<unsigned char>(text[i]);
+			}
+			return prefix;
+		}
+
+		inline std::vector<std::string> dynaSortPath (const std::string &path) {
+			std::vector<std::string> segments;
+			if (path.empty()) return segments;
+			size_t start = 0;
+			while (true) {
+				const size_t dot = path.find('.', start);
+				segments.push_back(path.substr(start, dot == std::string::npos ? std::string::npos : dot - start));
+				if (dot == std::string::npos) return segments;
+				start = dot + 1;
+			}
+		}
+
+		// The value at path inside item, nullptr when it is missing. An empty path is the item itself
+		inline const DynaVal *dynaSortFind (const DynaVal &item, const std::vector<std::string> &path) {
+			const DynaVal *current = &item;
+			for (const auto &segment : path) {
+				if (!current->isObject() || !current->object) return nullptr;
+				const auto it = current->object->find(segment);
+				if (it == current->object->end()) return nullptr;
+				current = &it->second;
+			}
+			return current;
+		}
+
+		inline DynaSortKey dynaSortKeyOf (const DynaVal &item, const std::vector<std::string> &path, const size_t index) {
+			DynaSortKey key;
+			key.index = index;
+
+			const DynaVal *current = dynaSortFind(item, path);
+			if (!current) {
+				key.rank = kDynaSortMissing;
+				return key;
+			}
+
+			if (current->isNumber()) {
+				key.bits = dynaSortableBits(current->number);
+			} else if (current->isString()) {
+				key.rank = 1;
+				key.bits = dynaStringPrefix(current->string);
+				key.text = &static_cast<const std::string &>(current->string);
+			} else if (current->isBool()) {
+				key.rank = 2;
+				key.bits = current->boolean;
+			} else if (current->isNull() || current->isUndefined()) {
+				key.rank = kDynaSortMissing;
+			} else {
+				key.rank = static_cast<uint8_t>(3 + static_cast<int>(current->type));
+			}
+			return key;
+		}
+
+		/**
+		 * Strict ordering over keys. Missing keys always go last, ties fall
+		 * back to the original position so every sort using it is stable.
+		 */
+		struct DynaSortLess {
+			bool descending = false;
+
+			bool operator() (const DynaSortKey &a, const DynaSortKey &b) const {
+				if ((a.rank == kDynaSortMissing) != (b.rank == kDynaSortMissing)) return b.rank == kDynaSortMissing;
+				if (a.rank != b.rank) return descending ? a.rank > b.rank : a.rank < b.rank;
+				if (a.bits != b.bits) return descending ? a.bits > b.bits : a.bits < b.bits;
+				if (a.rank == 1) {
+					const int order = a.text->compare(*b.text);
+					if (order) return descending ? order > 0 : order < 0;
+				}
+				return a.index < b.index;
+			}
+		};
+
+		// Stable LSD radix sort on 8 bit digits, skipping digits every key shares
+		inline void dynaRadixSort (DynaSortBits *keys, const size_t count) {
+			std::vector<DynaSortBits> scratch(count);
+			DynaSortBits *from = keys;
+			DynaSortBits *to = scratch.data();
+
+			for (int shift = 0; shift < 64; shift += 8) {
+				size_t offsets[256] = {};
+				for (size_t i = 0; i < count; ++i) ++offsets[from[i].bits >> shift & 0xff];
+				if (offsets[from[0].bits >> shift & 0xff] == count) continue;
+
+				size_t total = 0;
+				for (auto &offset : offsets) {
+					const size_t bucket = offset;
+					offset = total;
+					total += bucket;
+				}
+				for (size_t i = 0; i < count; ++i) to[offsets[from[i].bits >> shift & 0xff]++] = from[i];
+				std::swap(from, to);
+			}
+
+			if (from != keys) std::copy(from, from + count, keys);
+		}
+
+		inline std::vector<DynaSortKey> dynaSortKeys (const DynaVal &arr, const std::vector<std::string> &path, const DynaParallelPolicy *policy) {
+			const size_t count = arr.array ? arr.array->size() : 0;
+			std::vector<DynaSortKey> keys(count);
+			const auto extract = [&](size_t, const size_t begin, const size_t end) {
+				for (size_t i = begin; i < end; ++i) keys[i] = dynaSortKeyOf((*arr.array)[i], path, i);
+			};
+
+			if (policy && policy->shouldSplit(count)) dynaParallelFor(*policy, count, extract);
+			else extract(0, 0, count);
+			return keys;
+		}
+
+		// Sorts [begin, end) of keys, radix when every key there is a number
+		inline void dynaSortRange (std::vector<DynaSortKey> &keys, const size_t begin, const size_t end, const bool descending) {
+			const bool numeric = std::all_of(keys.begin() + begin, keys.begin() + end, [](const DynaSortKey &key) {
+				return key.rank == 0;
+			});
+
+			if (!numeric || end - begin < 2) {
+				std::sort(keys.begin() + begin, keys.begin() + end, DynaSortLess {descending});
+				return;
+			}
+
+			std::vector<DynaSortBits> bits(end - begin);
+			for (size_t i = begin; i < end; ++i) bits[i - begin] = {descending ? ~keys[i].bits : keys[i].bits, keys[i].index};
+			dynaRadixSort(bits.data(), bits.size());
+			for (size_t i = begin; i < end; ++i) {
+				keys[i].bits = descending ? ~bits[i - begin].bits : bits[i - begin].bits;
+				keys[i].index = bits[i - begin].index;
+			}
+		}
+
+		inline void dynaSortKeysInPlace (std::vector<DynaSortKey> &keys, const bool descending, const DynaParallelPolicy *policy) {
+			if (!policy || !policy->shouldSplit(keys.size())) {
+				dynaSortRange(keys, 0, keys.size(), descending);
+				return;
+			}
+
+			// Sort chunks on the pool, then merge neighbouring runs until one is left
+			const size_t chunks = policy->chunkCount(keys.size());
+			const size_t perChunk = (keys.size() + chunks - 1) / chunks;
+			dynaParallelFor(*policy, keys.size(), [&](size_t, const size_t begin, const size_t end) {
+				dynaSortRange(keys, begin, end, descending);
+			});
+
+			for (size_t width = perChunk; width < keys.size(); width *= 2) {
+				for (size_t begin = 0; begin + width < keys.size(); begin += width * 2) {
+					const size_t end = std::min(keys.size(), begin + width * 2);
+					std::inplace_merge(keys.begin() + begin, keys.begin() + begin + width, keys.begin() + end, DynaSortLess {descending});
+				}
+			}
+		}
+
+		inline void dynaRequireArray (const DynaVal &arr, const char *caller) {
+			if (!arr.isArray()) detail::dynaThrow(std::string(caller) + " requires an array");
+		}
+
+		inline void dynaSortByImpl (DynaVal &arr, const std::string &path, const bool descending, const DynaParallelPolicy *policy) {
+			dynaRequireArray(arr, "dynaSortBy()");
+			arr.ensureMutable();
+			if (!arr.array || arr.array->size() < 2) return;
+
+			std::vector<DynaSortKey> keys = dynaSortKeys(arr, dynaSortPath(path), policy);
+			dynaSortKeysInPlace(keys, descending, policy);
+
+			DynaValArray sorted;
+			sorted.reserve(keys.size());
+			for (const auto &key : keys) sorted.push_back(std::move((*arr.array)[key.index]));
+			arr.array->swap(sorted);
+			arr.markDirty(false);
+		}
+	}
+
+	/**
+	 * Sorts an array in place by the value at a dot separated path in each
+	 * element, or by the elements themselves when path is empty. Keys are
+	 * extracted once; all-number keys are radix sorted and everything else
+	 * is compared on an 8 byte prefix before the full string. Elements are
+	 * then moved into their new positions. The sort is stable.
+	 *
+	 * Numbers order before strings, then bools, then other types. Elements
+	 * with a missing, null or undefined key go last in both directions.
+	 */
+	inline void dynaSortBy (DynaVal &arr, const std::string &path = "", const bool descending = false) {
+		detail::dynaSortByImpl(arr, path, descending, nullptr);
+	}
+
+	/**
+	 * As dynaSortBy(), with key extraction and sorting split over the task
+	 * pool once the array reaches policy.cutoff elements. Chunks are sorted
+	 * independently and merged, so the result is identical.
+	 */
+	inline void dynaSortBy (DynaVal &arr, const std::string &path, const bool descending, const DynaParallelPolicy &policy) {
+		detail::dynaSortByImpl(arr, path, descending, &policy);
+	}
+
+	/**
+	 * The k elements with the largest keys (smallest when largest is false)
+	 * in key order, as a new array. Only those k are ordered and copied; the
+	 * source is left untouched. Elements without a key are never chosen
+	 * ahead of ones with a key.
+	 */
+	inline DynaVal dynaTopK (const DynaVal &arr, const std::string &path, size_t k, const bool largest = true) {
+		detail::dynaRequireArray(arr, "dynaTopK()");
+		DynaValArray out;
+		if (!arr.array) return DynaVal(std::move(out));
+
+		std::vector<detail::DynaSortKey> keys = detail::dynaSortKeys(arr, detail::dynaSortPath(path), nullptr);
+		k = std::min(k, keys.size());
+		std::partial_sort(keys.begin(), keys.begin() + static_cast<std::ptrdiff_t>(k), keys.end(), detail::DynaSortLess {largest});
+
+		out.reserve(k);
+		for (size_t i = 0; i < k; ++i) out.push_back((*arr.array)[keys[i].index]);
+		return DynaVal(std::move(out));
+	}
+
+	/**
+	 * Groups the elements of an array by the value at path into an object
+	 * of arrays, each keeping the original element order. String keys name
+	 * their group as-is, other keys by their JSON ("42", "true"), and
+	 * elements without the key are grouped under "null". Elements are
+	 * copies sharing storage with the source, as with any DynaVal copy.
+	 */
+	inline DynaVal dynaGroupBy (const DynaVal &arr, const std::string &path) {
+		detail::dynaRequireArray(arr, "dynaGroupBy()");
+		DynaVal groups;
+		groups.becomeObject();
+		if (!arr.array) return groups;
+
+		const std::vector<std::string> segments = detail::dynaSortPath(path);
+		for (size_t i = 0; i < arr.array->size(); ++i) {
+			const DynaVal &item = (*arr.array)[i];
+			const DynaVal *current = detail::dynaSortFind(item, segments);
+
+			std::string name = "null";
+			if (current && current->isString()) name = current->string;
+			else if (current && !current->isUndefined()) name = current->toJson();
+
+			DynaVal &group = (*groups.object)[name];
+			if (!group.isArray()) group.becomeArray();
+			group.array->push_back(item);
+		}
+
+		return groups;
+	}
+}
@@ -0,0 +1,385 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "DynaVal.h"
+#include "DynaTable.h"
+
+// Define DYNAVAL_NO_SIMD to force the portable kernels
+#if !defined(DYNAVAL_NO_SIMD) && defined(__AVX__)
+#include <immintrin.h>
+#define DYNAVAL_STATS_AVX 1
+#elif !defined(DYNAVAL_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define DYNAVAL_STATS_SSE2 1
+#endif
+
+namespace Irrelon {
+	struct DynaStats {
+		size_t count = 0;
+		double sum = 0;
+		// NaN when count is 0. min and max skip NaN values, the others carry them through
+		double min = std::numeric_limits<double>::quiet_NaN();
+		double max = std::numeric_limits<double>::quiet_NaN();
+		double mean = std::numeric_limits<double>::quiet_NaN();
+		// Population variance, divided by count
+		double variance = std::numeric_limits<double>::quiet_NaN();
+		double stddev = std::numeric_limits<double>::quiet_NaN();
+	};
+
+	/**
+	 * Reduction kernels over contiguous doubles. With AVX they work four
+	 * lanes at a time, with SSE2 two. Everywhere else, including the
+	 * ESP32 (whose vector extensions have no double lanes), a portable
+	 * loop with four independent accumulators is used, which compilers
+	 * can still vectorize. Lane order changes how a sum rounds, so results
+	 * can differ from a plain loop in the last bits.
+	 */
+	namespace detail {
+		inline double dynaSumKernel (const double *values, const size_t count) {
+			size_t i = 0;
+			double total = 0;
+#if defined(DYNAVAL_STATS_AVX)
+			__m256d a = _mm256_setzero_pd();
+			__m256d b = _mm256_setzero_pd();
+			for (; i + 8 <= count; i += 8) {
+				a = _mm256_add_pd(a, _mm256_loadu_pd(values + i));
+				b = _mm256_add_pd(b, _mm256_loadu_pd(values + i + 4));
+			}
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, _mm256_add_pd(a, b));
+			total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(DYNAVAL_STATS_SSE2)
+			__m128d a = _mm_setzero_pd();
+			__m128d b = _mm_setzero_pd();
+			for (; i + 4 <= count; i += 4) {
+				a = _mm_add_pd(a, _mm_loadu_pd(values + i));
+				b = _mm_add_pd(b, _mm_loadu_pd(values + i + 2));
+			}
+			alignas(16) double lanes[2];
+			_mm_store_pd(lanes, _mm_add_pd(a, b));
+			total = lanes[0] + lanes[1];
+#else
+			double lanes[4] = {0, 0, 0, 0};
+			for (; i + 4 <= count; i += 4) {
+				lanes[0] += values[i];
+				lanes[1] += values[i + 1];
+				lanes[2] += values[i + 2];
+				lanes[3] += values[i + 3];
+			}
+			total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+			for (; i < count; ++i) total += values[i];
+			return total;
+		}
+
+		// Sum of (value - mean)^2, the second pass of a two pass variance
+		inline double dynaSquaredDeviationKernel (const double *values, const size_t count, const double mean) {
+			size_t i = 0;
+			double total = 0;
+#if defined(DYNAVAL_STATS_AVX)
+			const __m256d center = _mm256_set1_pd(mean);
+			__m256d acc = _mm256_setzero_pd();
+			for (; i + 4 <= count; i += 4) {
+				const __m256d d = _mm256_sub_pd(_mm256_loadu_pd(values + i), center);
+				acc = _mm256_add_pd(acc, _mm256_mul_pd(d, d));
+			}
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, acc);
+			total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(DYNAVAL_STATS_SSE2)
+			const __m128d center = _mm_set1_pd(mean);
+			__m128d acc = _mm_setzero_pd();
+			for (; i + 2 <= count; i += 2) {
+				const __m128d d = _mm_sub_pd(_mm_loadu_pd(values + i), center);
+				acc = _mm_add_pd(acc, _mm_mul_pd(d, d));
+			}
+			alignas(16) double lanes[2];
+			_mm_store_pd(lanes, acc);
+			total = lanes[0] + lanes[1];
+#else
+			double lanes[4] = {0, 0, 0, 0};
+			for (; i + 4 <= count; i += 4) {
+				for (size_t lane = 0; lane < 4; ++lane) {
+					const double d = values[i + lane] - mean;
+					lanes[lane] += d * d;
+				}
+			}
+			total = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+			for (; i < count; ++i) {
+				const double d = values[i] - mean;
+				total += d * d;
+			}
+			return total;
+		}
+
+		/**
+		 * Smallest and largest value, skipping NaN like std::fmin and
+		 * std::fmax. Both are NaN when count is 0 or every value is NaN.
+		 * The vector min and max return their second operand when either
+		 * side is NaN, so the running bound goes second and a NaN lane
+		 * leaves it unchanged, matching the scalar compares.
+		 */
+		inline void dynaMinMaxKernel (const double *values, const size_t count, double &outMin, double &outMax) {
+			size_t i = 0;
+			double low = std::numeric_limits<double>::infinity();
+			double high = -std::numeric_limits<double>::infinity();
+#if defined(DYNAVAL_STATS_AVX)
+			if (count >= 4) {
+				__m256d lo = _mm256_set1_pd(low);
+				__m256d hi = _mm256_set1_pd(high);
+				for (; i + 4 <= count; i += 4) {
+					const __m256d v = _mm256_loadu_pd(values + i);
+					lo = _mm256_min_pd(v, lo);
+					hi = _mm256_max_pd(v, hi);
+				}
+				alignas(32) double lows[4];
+				alignas(32) double highs[4];
+				_mm256_store_pd(lows, lo);
+				_mm256_store_pd(highs, hi);
+				for (size_t lane = 0; lane < 4; ++lane) {
+					if (lows[lane] < low) low = lows[lane];
+					if (highs[lane] > high) high = highs[lane];
+				}
+			}
+#elif defined(DYNAVAL_STATS_SSE2)
+			if (count >= 2) {
+				__m128d lo = _mm_set1_pd(low);
+				__m128d hi = _mm_set1_pd(high);
+				for (; i + 2 <= count; i += 2) {
+					const __m128d v = _mm_loadu_pd(values + i);
+					lo = _mm_min_pd(v, lo);
+					hi = _mm_max_pd(v, hi);
+				}
+				alignas(16) double lows[2];
+				alignas(16) double highs[2];
+				_mm_store_pd(lows, lo);
+				_mm_store_pd(highs, hi);
+				for (size_t lane = 0; lane < 2; ++lane) {
+					if (lows[lane] < low) low = lows[lane];
+					if (highs[lane] > high) high = highs[lane];
+				}
+			}
+#endif
+			for (; i < count; ++i) {
+				if (values[i] < low) low = values[i];
+				if (values[i] > high) high = values[i];
+			}
+			if (low > high) {
+				low = std::numeric_limits<double>::quiet_NaN();
+				high = low;
+			}
+			outMin = low;
+			outMax = high;
+		}
+
+		// Doubles gathered per chunk, 1 KB so the buffer fits an ESP32 task stack
+		constexpr size_t kDynaStatsChunk = 128;
+
+		/**
+		 * Calls fn(values, count) with the numeric elements of an array,
+		 * whatever their numeric type, in order. They are packed into a stack
+		 * buffer one chunk at a time, so the kernels run over contiguous
+		 * doubles without copying a large array into a heap buffer.
+		 */
+		template <typename Fn>
+		void dynaForEachNumberChunk (const DynaVal &arr, Fn &&fn) {
+			if (!arr.isArray() || !arr.array) return;
+			double chunk[kDynaStatsChunk];
+			size_t filled = 0;
+			for (const auto &item : *arr.array) {
+				if (!item.isNumber()) continue;
+				chunk[filled++] = item.number;
+				if (filled == kDynaStatsChunk) {
+					fn(static_cast<const double *>(chunk), filled);
+					filled = 0;
+				}
+			}
+			if (filled) fn(static_cast<const double *>(chunk), filled);
+		}
+
+		// Sum and count of an array's numbers
+		inline double dynaChunkedSum (const DynaVal &arr, size_t &count) {
+			double total = 0;
+			count = 0;
+			dynaForEachNumberChunk(arr, [&](const double *values, const size_t n) {
+				total += dynaSumKernel(values, n);
+				count += n;
+			});
+			return total;
+		}
+
+		// Smallest and largest number, combining each chunk's bounds the way the kernel combines lanes
+		inline void dynaChunkedMinMax (const DynaVal &arr, double &outMin, double &outMax) {
+			double low = std::numeric_limits<double>::infinity();
+			double high = -std::numeric_limits<double>::infinity();
+			dynaForEachNumberChunk(arr, [&](const double *values, const size_t n) {
+				double chunkLow;
+				double chunkHigh;
+				dynaMinMaxKernel(values, n, chunkLow, chunkHigh);
+				if (chunkLow < low) low = chunkLow;
+				if (chunkHigh > high) high = chunkHigh;
+			});
+			if (low > high) {
+				low = std::numeric_limits<double>::quiet_NaN();
+				high = low;
+			}
+			outMin = low;
+			outMax = high;
+		}
+
+		inline double dynaChunkedSquaredDeviation (const DynaVal &arr, const double mean) {
+			double total = 0;
+			dynaForEachNumberChunk(arr, [&](const double *values, const size_t n) {
+				total += dynaSquaredDeviationKernel(values, n, mean);
+			});
+			return total;
+		}
+
+		// Counts values into buckets, the loop shared by the pointer and array histograms
+		inline void dynaHistogramAdd (const double *values, const size_t count, const double lo, const double hi, std::vector<size_t> &buckets) {
+			const size_t bins = buckets.size();
+			const double scale = hi > lo ? static_cast<double>(bins) / (hi - lo) : 0;
+			for (size_t i = 0; i < count; ++i) {
+				const double v = values[i];
+				if (!(v >= lo && v <= hi)) continue;
+				auto bucket = static_cast<size_t>((v - lo) * scale);
+				if (bucket >= bins) bucket = bins - 1;
+				++buckets[bucket];
+			}
+		}
+
+		// The non-null cells of a number column, or the column storage itself when it has no nulls
+		inline const std::vector<double> &dynaColumnNumbers (const DynaTable::Column &column, std::vector<double> &scratch) {
+			if (!column.isNumeric()) return scratch;
+			if (!column.nullCount()) return column.numbers();
+			scratch.reserve(column.size() - column.nullCount());
+			for (size_t i = 0; i < column.size(); ++i) {
+				if (!column.isNull(i)) scratch.push_back(column.numbers()[i]);
+			}
+			return scratch;
+		}
+	}
+
+	inline DynaStats dynaStats (const double *values, const size_t count) {
+		DynaStats stats;
+		stats.count = count;
+		if (!count) return stats;
+
+		stats.sum = detail::dynaSumKernel(values, count);
+		detail::dynaMinMaxKernel(values, count, stats.min, stats.max);
+		stats.mean = stats.sum / static_cast<double>(count);
+		stats.variance = detail::dynaSquaredDeviationKernel(values, count, stats.mean) / static_cast<double>(count);
+		stats.stddev = std::sqrt(stats.variance);
+		return stats;
+	}
+
+	inline DynaStats dynaStats (const std::vector<double> &values) {
+		return dynaStats(values.data(), values.size());
+	}
+
+	/**
+	 * Statistics over the numeric elements of an array, mixing Int, UInt,
+	 * Float, Double and Long freely. Other elements are skipped and not
+	 * counted. The numbers are packed a chunk at a time into a stack
+	 * buffer so the kernels run over doubles rather than DynaVal nodes,
+	 * and partial sums and bounds are combined across chunks.
+	 */
+	inline DynaStats dynaStats (const DynaVal &arr) {
+		DynaStats stats;
+		double low = std::numeric_limits<double>::infinity();
+		double high = -std::numeric_limits<double>::infinity();
+		detail::dynaForEachNumberChunk(arr, [&](const double *values, const size_t n) {
+			stats.count += n;
+			stats.sum += detail::dynaSumKernel(values, n);
+			double chunkLow;
+			double chunkHigh;
+			detail::dynaMinMaxKernel(values, n, chunkLow, chunkHigh);
+			if (chunkLow < low) low = chunkLow;
+			if (chunkHigh > high) high = chunkHigh;
+		});
+		if (!stats.count) return stats;
+
+		if (low <= high) {
+			stats.min = low;
+			stats.max = high;
+		}
+		stats.mean = stats.sum / static_cast<double>(stats.count);
+		stats.variance = detail::dynaChunkedSquaredDeviation(arr, stats.mean) / static_cast<double>(stats.count);
+		stats.stddev = std::sqrt(stats.variance);
+		return stats;
+	}
+
+	// Statistics over the non-null cells of a DynaTable number column
+	inline DynaStats dynaStats (const DynaTable::Column &column) {
+		std::vector<double> scratch;
+		const std::vector<double> &values = detail::dynaColumnNumbers(column, scratch);
+		return dynaStats(values.data(), values.size());
+	}
+
+	inline double dynaSum (const DynaVal &arr) {
+		size_t count;
+		return detail::dynaChunkedSum(arr, count);
+	}
+
+	inline double dynaMin (const DynaVal &arr) {
+		double low;
+		double high;
+		detail::dynaChunkedMinMax(arr, low, high);
+		return low;
+	}
+
+	inline double dynaMax (const DynaVal &arr) {
+		double low;
+		double high;
+		detail::dynaChunkedMinMax(arr, low, high);
+		return high;
+	}
+
+	inline double dynaMean (const DynaVal &arr) {
+		size_t count;
+		const double total = detail::dynaChunkedSum(arr, count);
+		if (!count) return std::numeric_limits<double>::quiet_NaN();
+		return total / static_cast<double>(count);
+	}
+
+	// Population variance by two chunked passes, NaN when there are no numbers
+	inline double dynaVariance (const DynaVal &arr) {
+		size_t count;
+		const double total = detail::dynaChunkedSum(arr, count);
+		if (!count) return std::numeric_limits<double>::quiet_NaN();
+		return detail::dynaChunkedSquaredDeviation(arr, total / static_cast<double>(count)) / static_cast<double>(count);
+	}
+
+	/**
+	 * Counts values into bins equal-width buckets spanning [lo, hi]. A
+	 * value equal to hi lands in the last bucket; values outside the
+	 * range and NaN are not counted.
+	 */
+	inline std::vector<size_t> dynaHistogram (const double *values, const size_t count, const size_t bins, const double lo, const double hi) {
+		std::vector<size_t> buckets(bins, 0);
+		if (!bins || !(hi >= lo)) return buckets;
+		detail::dynaHistogramAdd(values, count, lo, hi, buckets);
+		return buckets;
+	}
+
+	inline std::vector<size_t> dynaHistogram (const DynaVal &arr, const size_t bins, const double lo, const double hi) {
+		std::vector<size_t> buckets(bins, 0);
+		if (!bins || !(hi >= lo)) return buckets;
+		detail::dynaForEachNumberChunk(arr, [&](const double *values, const size_t n) {
+			detail::dynaHistogramAdd(values, n, lo, hi, buckets);
+		});
+		return buckets;
+	}
+
+	// Histogram spanning the array's own min and max
+	inline std::vector<size_t> dynaHistogram (const DynaVal &arr, const size_t bins) {
+		double lo;
+		double hi;
+		detail::dynaChunkedMinMax(arr, lo, hi);
+		return dynaHistogram(arr, bins, lo, hi);
+	}
+}
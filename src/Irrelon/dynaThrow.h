@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * DYNAVAL_NO_EXCEPTIONS builds the library without throw, try or catch,
+ * so it links into firmware compiled with -fno-exceptions. It is defined
+ * automatically when the compiler has exceptions turned off.
+ *
+ * Misuse that would throw std::runtime_error (writing into a frozen
+ * value, toArray() on a number, a malformed query) instead calls
+ * DYNAVAL_FATAL(message), which prints the message and aborts unless the
+ * application defines its own before including any DynaVal header. Code
+ * that has to cope with bad input uses the non-throwing accessors
+ * (tryArray(), tryObject(), get<T>(), at()), and dynaFromJson() reports
+ * malformed JSON as a 400 error value in both builds.
+ */
+#if !defined(DYNAVAL_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define DYNAVAL_NO_EXCEPTIONS
+#endif
+
+#ifdef DYNAVAL_NO_EXCEPTIONS
+#ifndef DYNAVAL_FATAL
+#define DYNAVAL_FATAL(message) (std::fprintf(stderr, "DynaVal: %s\n", message), std::abort())
+#endif
+#else
+#include <stdexcept>
+#endif
+
+namespace Irrelon {
+	namespace detail {
+		// Throws std::runtime_error, or calls DYNAVAL_FATAL when exceptions are disabled
+		[[noreturn]] inline void dynaThrow (const char *message) {
+#ifdef DYNAVAL_NO_EXCEPTIONS
+			DYNAVAL_FATAL(message);
+			std::abort();
+#else
+			throw std::runtime_error(message);
+#endif
+		}
+
+		[[noreturn]] inline void dynaThrow (const std::string &message) {
+			dynaThrow(message.c_str());
+		}
+	}
+}
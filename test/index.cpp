@@ -1,8 +1,47 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <thread>
+#include <vector>
 #include <unity.h>
 #include "Irrelon/DynaVal.h"
+#include "Irrelon/DynaValSnapshotCell.h"
+#include "Irrelon/DynaConcurrentObject.h"
+#include "Irrelon/DynaCbor.h"
+#include "Irrelon/DynaView.h"
+#include "Irrelon/DynaJournal.h"
+#include "Irrelon/DynaLiteral.h"
+#include "Irrelon/DynaFields.h"
+#include "Irrelon/DynaSchema.h"
+#include "Irrelon/DynaProgram.h"
+#include "Irrelon/DynaQuery.h"
+#include "Irrelon/DynaIndex.h"
+#include "Irrelon/DynaTable.h"
+#include "Irrelon/dynaStats.h"
+#include "Irrelon/dynaSort.h"
+#include "Irrelon/DynaRef.h"
+#include "Irrelon/DynaRing.h"
+#include "Irrelon/DynaBuilder.h"
 #include "Irrelon/dynaLog.h"
 
+struct TestEndpoint {
+	std::string host;
+	uint16_t port = 80;
+};
+DYNA_FIELDS(TestEndpoint, host, port)
+
+struct TestDevice {
+	std::string name;
+	bool enabled = false;
+	double ratio = 0;
+	int64_t uptime = 0;
+	std::vector<TestEndpoint> endpoints;
+	std::vector<bool> flags;
+	Irrelon::DynaVal extra;
+};
+DYNA_FIELDS(TestDevice, name, enabled, ratio, uptime, endpoints, flags, extra)
+
 void test_object_assignment() {
 	try {
 		Irrelon::DynaVal obj;
@@ -41,9 +80,1858 @@ void test_array_assignment() {
 	}
 }
 
+void test_parallel_deep_copy_json_and_equals() {
+	try {
+		Irrelon::DynaVal arr;
+		arr.becomeArray();
+		for (int i = 0; i < 5000; ++i) {
+			Irrelon::DynaVal item;
+			item["id"] = i;
+			item["name"] = "item";
+			item["values"].push(i * 2);
+			arr.push(item);
+		}
+
+		Irrelon::DynaParallelPolicy policy;
+		policy.threads = 4;
+		policy.cutoff = 64;
+
+		TEST_ASSERT_EQUAL_STRING(arr.toJson().c_str(), arr.toJson(policy).c_str());
+
+		const Irrelon::DynaVal copy = arr.deepCopy(policy);
+		TEST_ASSERT_TRUE(copy.array != arr.array);
+		TEST_ASSERT_TRUE(copy.equals(arr));
+		TEST_ASSERT_TRUE(copy.equals(arr, policy));
+
+		Irrelon::DynaVal changed = arr.deepCopy(policy);
+		changed[4321]["values"][0] = 7;
+		TEST_ASSERT_FALSE(changed.equals(arr));
+		TEST_ASSERT_FALSE(changed.equals(arr, policy));
+
+		// clear() drops the storage, which reads as an empty container
+		Irrelon::DynaVal cleared;
+		cleared.becomeArray();
+		cleared.clear();
+		TEST_ASSERT_EQUAL_STRING("[]", cleared.toJson(policy).c_str());
+		Irrelon::DynaVal clearedObject;
+		clearedObject.becomeObject();
+		clearedObject.clear();
+		TEST_ASSERT_EQUAL_STRING("{}", clearedObject.toJson(policy).c_str());
+		changed[10]["values"].clear();
+		changed[11]["tags"].becomeObject();
+		changed[11]["tags"].clear();
+		TEST_ASSERT_EQUAL_STRING(changed.toJson().c_str(), changed.toJson(policy).c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_snapshot_cell_concurrent_readers() {
+	try {
+		Irrelon::DynaValSnapshotCell cell;
+		std::atomic<bool> done{false};
+		std::atomic<int> inconsistent{0};
+		std::vector<std::thread> readers;
+
+		for (int r = 0; r < 3; ++r) {
+			readers.emplace_back([&] {
+				const auto reader = cell.reader();
+				while (!done) {
+					const auto snap = reader.read();
+					if (snap->isNull()) continue;
+					const int n = (*snap)["n"].toInt();
+					const auto &values = (*snap)["values"];
+					for (size_t i = 0; i < values.size(); ++i) {
+						if (values[i].toInt() != n) ++inconsistent;
+					}
+				}
+			});
+		}
+
+		Irrelon::DynaVal state;
+		for (int n = 1; n <= 500; ++n) {
+			state["n"] = n;
+			state["values"].becomeArray();
+			for (int i = 0; i < 16; ++i) state["values"][i] = n;
+			cell.publish(state);
+		}
+
+		done = true;
+		for (auto &reader : readers) reader.join();
+
+		TEST_ASSERT_EQUAL_INT(0, inconsistent.load());
+		TEST_ASSERT_EQUAL(500u, cell.version());
+		TEST_ASSERT_EQUAL(0u, cell.reclaim());
+		TEST_ASSERT_EQUAL_INT(500, (*cell.reader().read())["n"].toInt());
+
+		// A second read on the same reader keeps the first snapshot pinned
+		const auto reader = cell.reader();
+		const auto first = reader.read();
+		state["n"] = 501;
+		cell.publish(state);
+		{
+			const auto second = reader.read();
+			TEST_ASSERT_EQUAL_INT(501, (*second)["n"].toInt());
+		}
+		state["n"] = 502;
+		cell.publish(state);
+		TEST_ASSERT_EQUAL(2u, cell.reclaim());
+		TEST_ASSERT_EQUAL_INT(500, (*first)["n"].toInt());
+		TEST_ASSERT_EQUAL_INT(16, (*first)["values"].size());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_concurrent_object_multiple_writers() {
+	try {
+		Irrelon::DynaConcurrentObject registry(8);
+		std::vector<std::thread> writers;
+
+		for (int t = 0; t < 4; ++t) {
+			writers.emplace_back([&registry, t] {
+				for (int i = 0; i < 1000; ++i) {
+					const std::string key = std::to_string(t) + ":" + std::to_string(i);
+					registry.set(key, i);
+					registry.update("count", [](Irrelon::DynaVal &val) { val = val.toInt() + 1; });
+					if (i % 2) registry.erase(key);
+				}
+			});
+		}
+
+		for (auto &writer : writers) writer.join();
+
+		TEST_ASSERT_EQUAL(2001u, registry.size());
+		TEST_ASSERT_EQUAL_INT(4000, registry.get("count").toInt());
+		TEST_ASSERT_TRUE(registry.containsKey("3:998"));
+		TEST_ASSERT_FALSE(registry.containsKey("3:999"));
+		TEST_ASSERT_TRUE(registry.get("3:999").isUndefined());
+
+		const Irrelon::DynaVal snapshot = registry.snapshot();
+		TEST_ASSERT_EQUAL(2001u, snapshot.size());
+		TEST_ASSERT_EQUAL_INT(998, snapshot["3:998"].toInt());
+
+		registry.update("list", [](Irrelon::DynaVal &val) { val.push(1); });
+		Irrelon::DynaVal held = registry.get("list");
+		registry.update("list", [](Irrelon::DynaVal &val) { val.push(2); });
+		TEST_ASSERT_EQUAL(1u, held.size());
+		held.push(3);
+		TEST_ASSERT_EQUAL(2u, registry.get("list").size());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_deep_freeze_enforced_and_memoized() {
+	try {
+		Irrelon::DynaVal config;
+		config["name"] = "device";
+		config["limits"]["max"] = 10;
+		config["list"].push(1);
+		config["list"].push(2);
+
+		const std::string json = config.toJson();
+		const size_t hash = config.hash();
+		Irrelon::DynaVal alias = config["limits"];
+		config.freeze();
+
+		TEST_ASSERT_TRUE(config["limits"].isFrozen());
+		TEST_ASSERT_EQUAL(hash, config.hash());
+		TEST_ASSERT_EQUAL_STRING(json.c_str(), config.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING(json.c_str(), config.toJson().c_str());
+
+		// A handle copied before the freeze stays mutable without reaching the frozen tree
+		TEST_ASSERT_FALSE(alias.isFrozen());
+		alias["z"] = 2;
+		TEST_ASSERT_EQUAL_INT(2, alias["z"].toInt());
+		TEST_ASSERT_NULL(std::as_const(config).at("limits")->at("z"));
+		TEST_ASSERT_EQUAL_STRING(json.c_str(), config.toJson().c_str());
+		TEST_ASSERT_EQUAL(hash, config.deepCopy().hash());
+		TEST_ASSERT_EQUAL_INT(10, config["limits"]["max"].toInt());
+
+		bool threw = false;
+		try { config["limits"]["max"] = 11; } catch (const std::runtime_error &) { threw = true; }
+		TEST_ASSERT_TRUE(threw);
+
+		threw = false;
+		try { config["missing"] = true; } catch (const std::runtime_error &) { threw = true; }
+		TEST_ASSERT_TRUE(threw);
+
+		threw = false;
+		try { config["list"].push(3); } catch (const std::runtime_error &) { threw = true; }
+		TEST_ASSERT_TRUE(threw);
+
+		// Thawing copies the storage so the frozen original is untouched
+		Irrelon::DynaVal working = config;
+		working.unfreeze();
+		working["name"] = "renamed";
+		working["list"].unfreeze();
+		working["list"].push(3);
+		working["list"].remove(0);
+
+		TEST_ASSERT_EQUAL_STRING(json.c_str(), config.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[2,3]", working["list"].toJson().c_str());
+		TEST_ASSERT_TRUE(working["limits"].isFrozen());
+		TEST_ASSERT_FALSE(working.equals(config));
+
+		// Equal content hashes equal regardless of numeric type
+		Irrelon::DynaVal a;
+		a["x"] = 1;
+		Irrelon::DynaVal b;
+		b["x"] = 1.0;
+		TEST_ASSERT_EQUAL(a.hash(), b.hash());
+		TEST_ASSERT_TRUE(config.sizeInBytes() > sizeof(Irrelon::DynaVal));
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_incremental_json_cache() {
+	try {
+		Irrelon::DynaVal state;
+		for (int i = 0; i < 20; ++i) {
+			const std::string key = "sensor" + std::to_string(i);
+			state[key]["value"] = i;
+			state[key]["history"].push(i);
+		}
+
+		// Values outside a cached tree carry no cache state, even after serializing or copying
+		(void)state.toJson();
+		const Irrelon::DynaVal plainCopy = state;
+		TEST_ASSERT_NULL(state.cacheLink);
+		TEST_ASSERT_NULL(state["sensor0"]["value"].cacheLink);
+		TEST_ASSERT_NULL(plainCopy.cacheLink);
+
+		state.enableJsonCache();
+		const std::string first = state.toJson();
+		TEST_ASSERT_FALSE(state.isDirty());
+		TEST_ASSERT_FALSE(state["sensor3"].isDirty());
+
+		state["sensor3"]["value"] = 300;
+		state["sensor7"]["history"].push(70);
+		state["sensor21"]["value"] = 21;
+
+		TEST_ASSERT_TRUE(state.isDirty());
+		TEST_ASSERT_TRUE(state["sensor3"].isDirty());
+		TEST_ASSERT_TRUE(state["sensor7"]["history"].isDirty());
+		TEST_ASSERT_FALSE(state["sensor4"]["history"].isDirty());
+
+		const std::string second = state.toJson();
+		TEST_ASSERT_TRUE(first != second);
+		TEST_ASSERT_FALSE(state["sensor21"].isDirty());
+
+		state["sensor7"]["history"].remove(0);
+		const std::string third = state.toJson();
+
+		// Reads leave the fragments alone
+		TEST_ASSERT_EQUAL_INT(4, state["sensor4"]["value"].toInt());
+		TEST_ASSERT_NOT_NULL(state.at("sensor5"));
+		TEST_ASSERT_FALSE(state.isDirty());
+
+		state.disableJsonCache();
+		TEST_ASSERT_EQUAL_STRING(state.toJson().c_str(), third.c_str());
+		TEST_ASSERT_TRUE(third.find("\"sensor3\":{\"history\":[3],\"value\":300}") != std::string::npos ||
+			third.find("\"sensor3\":{\"value\":300,\"history\":[3]}") != std::string::npos);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_json_cache_sees_writes_through_handles() {
+	try {
+		Irrelon::DynaVal state;
+		auto &held = state["a"]["h"];
+		held.becomeArray();
+		state["a"]["n"] = 1;
+		state.enableJsonCache();
+		TEST_ASSERT_TRUE(state.toJson().find("\"h\":[]") != std::string::npos);
+
+		// A reference held across toJson()
+		held.push(1);
+		TEST_ASSERT_TRUE(state.isDirty());
+		TEST_ASSERT_TRUE(state.toJson().find("\"h\":[1]") != std::string::npos);
+
+		// A copy sharing the container's storage
+		Irrelon::DynaVal alias = state["a"]["h"];
+		alias.push(2);
+		TEST_ASSERT_TRUE(state.toJson().find("\"h\":[1,2]") != std::string::npos);
+
+		// A pointer from at()
+		state.at("a")->at("h")->push(3);
+		TEST_ASSERT_TRUE(state.toJson().find("\"h\":[1,2,3]") != std::string::npos);
+
+		// Scalar assignment on a held reference
+		auto &n = state["a"]["n"];
+		state.toJson();
+		n = 5;
+		TEST_ASSERT_TRUE(state.toJson().find("\"n\":5") != std::string::npos);
+		n = Irrelon::DynaVal("text");
+		TEST_ASSERT_TRUE(state.toJson().find("\"n\":\"text\"") != std::string::npos);
+
+		state.disableJsonCache();
+		const std::string uncached = state.toJson();
+		state.enableJsonCache();
+		TEST_ASSERT_EQUAL_STRING(uncached.c_str(), state.toJson().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_diff_and_apply_patch() {
+	try {
+		Irrelon::DynaVal from;
+		from["name"] = "device";
+		from["a/b"] = 1;
+		from["list"].push(1);
+		from["list"].push(2);
+		from["list"].push(3);
+		from["nested"]["keep"] = true;
+		from["nested"]["drop"] = "x";
+		from["shared"]["big"].push("unchanged");
+
+		Irrelon::DynaVal to = from.deepCopy();
+		to["shared"] = from["shared"];
+		to["name"] = "renamed";
+		to["a/b"] = 2;
+		to["list"].remove(2);
+		to["list"].remove(1);
+		to["list"][0] = 10;
+		to["list"].push(20);
+		to["list"].push(30);
+		to["nested"].object->erase("drop");
+		to["nested"]["added"] = 5;
+
+		const Irrelon::DynaVal patch = Irrelon::DynaVal::diff(from, to);
+		TEST_ASSERT_TRUE(patch.isArray());
+		TEST_ASSERT_EQUAL(7u, patch.size());
+		TEST_ASSERT_TRUE(patch.toJson().find("\"/a~1b\"") != std::string::npos);
+		TEST_ASSERT_TRUE(patch.toJson().find("shared") == std::string::npos);
+
+		Irrelon::DynaVal target = from.deepCopy();
+		const Irrelon::DynaVal result = target.applyPatch(patch);
+		TEST_ASSERT_FALSE(result.isError());
+		TEST_ASSERT_TRUE(target.equals(to));
+		TEST_ASSERT_EQUAL(0u, Irrelon::DynaVal::diff(target, to).size());
+
+		// Move, copy and test operations, then a failing test stops the patch
+		Irrelon::DynaVal ops;
+		Irrelon::DynaVal move;
+		move["op"] = "move";
+		move["from"] = "/name";
+		move["path"] = "/label";
+		ops.push(move);
+		Irrelon::DynaVal copy;
+		copy["op"] = "copy";
+		copy["from"] = "/list/0";
+		copy["path"] = "/list/0";
+		ops.push(copy);
+		Irrelon::DynaVal test;
+		test["op"] = "test";
+		test["path"] = "/list/1";
+		test["value"] = 10;
+		ops.push(test);
+
+		TEST_ASSERT_FALSE(target.applyPatch(std::move(ops)).isError());
+		TEST_ASSERT_FALSE(target.containsKey("name"));
+		TEST_ASSERT_EQUAL_STRING("renamed", target["label"].toString().c_str());
+		TEST_ASSERT_EQUAL_STRING("[10,10,20,30]", target["list"].toJson().c_str());
+
+		// An rvalue copy shares the patch's storage, so the patch keeps its values for reuse
+		const char *reusedJson = R"([{"op":"add","path":"/tag","value":"x"},{"op":"replace","path":"/list","value":[1]}])";
+		Irrelon::DynaVal reused = Irrelon::dynaFromJson(reusedJson);
+		Irrelon::DynaVal first;
+		first["list"] = 0;
+		Irrelon::DynaVal second = first.deepCopy();
+		Irrelon::DynaVal reusedCopy = reused;
+		TEST_ASSERT_FALSE(first.applyPatch(std::move(reusedCopy)).isError());
+		TEST_ASSERT_TRUE(reused.equals(Irrelon::dynaFromJson(reusedJson)));
+		TEST_ASSERT_FALSE(second.applyPatch(reused).isError());
+		TEST_ASSERT_TRUE(second.equals(first));
+		TEST_ASSERT_EQUAL_STRING("x", second["tag"].toString().c_str());
+
+		Irrelon::DynaVal failing;
+		Irrelon::DynaVal remove;
+		remove["op"] = "remove";
+		remove["path"] = "/missing";
+		failing.push(remove);
+		TEST_ASSERT_TRUE(target.applyPatch(failing).isError());
+
+		// A move whose destination does not resolve leaves the source in place
+		Irrelon::DynaVal lost;
+		Irrelon::DynaVal strayMove;
+		strayMove["op"] = "move";
+		strayMove["from"] = "/list/1";
+		strayMove["path"] = "/missing/child";
+		lost.push(strayMove);
+		TEST_ASSERT_EQUAL_INT(422, target.applyPatch(lost).errorData->statusCode);
+		TEST_ASSERT_EQUAL_STRING("[10,10,20,30]", target["list"].toJson().c_str());
+
+		// test and copy only read, so they keep the cached fragments they pass
+		Irrelon::DynaVal cached = target.deepCopy();
+		cached.enableJsonCache();
+		const std::string before = cached.toJson();
+		Irrelon::DynaVal reads;
+		reads.push(test);
+		TEST_ASSERT_FALSE(cached.applyPatch(reads).isError());
+		TEST_ASSERT_FALSE(cached.isDirty());
+		TEST_ASSERT_FALSE(cached["list"].isDirty());
+		TEST_ASSERT_EQUAL_STRING(before.c_str(), cached.toJson().c_str());
+
+		// Operations hold their own copies of the values
+		to["nested"]["added"] = 6;
+		TEST_ASSERT_TRUE(patch.toJson().find("\"value\":5") != std::string::npos);
+
+		// Frozen targets and frozen subtrees are refused without throwing
+		Irrelon::DynaVal frozen = from.deepCopy();
+		frozen.freeze();
+		const Irrelon::DynaVal refused = frozen.applyPatch(patch);
+		TEST_ASSERT_TRUE(refused.isError());
+		TEST_ASSERT_EQUAL_INT(409, refused.errorData->statusCode);
+		TEST_ASSERT_TRUE(frozen.equals(from));
+
+		Irrelon::DynaVal partly = from.deepCopy();
+		partly["nested"].freeze();
+		TEST_ASSERT_EQUAL_INT(409, partly.applyPatch(patch).errorData->statusCode);
+
+		// Moving out of a frozen container copies instead of emptying the slot
+		Irrelon::DynaVal taken = std::move(frozen["list"]);
+		TEST_ASSERT_EQUAL_STRING("[1,2,3]", taken.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[1,2,3]", frozen["list"].toJson().c_str());
+		Irrelon::DynaVal assigned;
+		assigned = std::move(frozen["name"]);
+		TEST_ASSERT_EQUAL_STRING("device", frozen["name"].toString().c_str());
+		TEST_ASSERT_EQUAL_STRING("device", assigned.toString().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_cbor_round_trip() {
+	try {
+		Irrelon::DynaVal batch;
+		batch["int"] = static_cast<int32_t>(42);
+		batch["negative"] = static_cast<int32_t>(-7);
+		batch["uint"] = static_cast<uint32_t>(300000);
+		batch["long"] = 123456789L;
+		batch["float"] = 1.5f;
+		batch["double"] = 0.1;
+		batch["bool"] = true;
+		batch["null"].becomeNull();
+		batch["undefined"].becomeUndefined();
+		batch["text"] = "caf\xc3\xa9 \"quoted\"";
+		batch["error"] = Irrelon::DynaVal::error("sensor offline", 503);
+		uint8_t bytes[] = {0, 1, 127, 255};
+		batch["bytes"].fromBytesAsArray(bytes, sizeof(bytes));
+		batch["readings"].push(1.25);
+		batch["readings"].push("mixed");
+
+		const std::vector<uint8_t> encoded = Irrelon::dynaToCbor(batch);
+		TEST_ASSERT_TRUE(encoded.size() < batch.toJson().size());
+
+		size_t consumed = 0;
+		const Irrelon::DynaVal decoded = Irrelon::dynaFromCbor(encoded, &consumed);
+		TEST_ASSERT_EQUAL(encoded.size(), consumed);
+		TEST_ASSERT_TRUE(decoded.equals(batch));
+		TEST_ASSERT_TRUE(decoded["int"].isInt());
+		TEST_ASSERT_TRUE(decoded["negative"].isInt());
+		TEST_ASSERT_TRUE(decoded["uint"].isUInt());
+		TEST_ASSERT_TRUE(decoded["long"].type == Irrelon::DynaValType::Long);
+		TEST_ASSERT_TRUE(decoded["float"].isFloat());
+		TEST_ASSERT_TRUE(decoded["double"].isDouble());
+		TEST_ASSERT_TRUE(decoded["undefined"].isUndefined());
+		TEST_ASSERT_TRUE(decoded["error"].isError());
+		TEST_ASSERT_EQUAL_INT(503, decoded["error"].toError().statusCode);
+		TEST_ASSERT_TRUE(decoded["bytes"][3].isUInt());
+		TEST_ASSERT_EQUAL_INT(255, decoded["bytes"][3].toInt());
+
+		const Irrelon::DynaVal truncated = Irrelon::dynaFromCbor(encoded.data(), encoded.size() - 1);
+		TEST_ASSERT_TRUE(truncated.isError());
+
+		// Int is the untagged default, other integer types are tagged only when their value doesn't imply them
+		TEST_ASSERT_EQUAL(1u, Irrelon::dynaToCbor(Irrelon::DynaVal(static_cast<int32_t>(7))).size());
+		TEST_ASSERT_EQUAL(2u, Irrelon::dynaToCbor(Irrelon::DynaVal(static_cast<int32_t>(42))).size());
+		TEST_ASSERT_EQUAL(5u, Irrelon::dynaToCbor(Irrelon::DynaVal(static_cast<uint32_t>(4000000000u))).size());
+
+		// Integer types holding a fraction keep both their type and value
+		Irrelon::DynaVal fraction = static_cast<int32_t>(0);
+		fraction.number = 2.5;
+		const Irrelon::DynaVal fractionBack = Irrelon::dynaFromCbor(Irrelon::dynaToCbor(fraction));
+		TEST_ASSERT_TRUE(fractionBack.isInt());
+		TEST_ASSERT_EQUAL_DOUBLE(2.5, fractionBack.number);
+		Irrelon::DynaVal negativeUInt = static_cast<uint32_t>(0);
+		negativeUInt.number = -2;
+		const Irrelon::DynaVal negativeUIntBack = Irrelon::dynaFromCbor(Irrelon::dynaToCbor(negativeUInt));
+		TEST_ASSERT_TRUE(negativeUIntBack.isUInt());
+		TEST_ASSERT_EQUAL_DOUBLE(-2, negativeUIntBack.number);
+
+		// A UInt array only becomes a byte string when every element is a whole byte
+		Irrelon::DynaVal notBytes;
+		Irrelon::DynaVal half = static_cast<uint32_t>(0);
+		half.number = 1.5;
+		notBytes.push(half);
+		notBytes.push(static_cast<uint32_t>(3));
+		const Irrelon::DynaVal notBytesBack = Irrelon::dynaFromCbor(Irrelon::dynaToCbor(notBytes));
+		TEST_ASSERT_TRUE(notBytesBack.equals(notBytes));
+		TEST_ASSERT_EQUAL_DOUBLE(1.5, notBytesBack[0].number);
+
+		// A cleared array has no storage and encodes as an empty one
+		Irrelon::DynaVal cleared;
+		cleared.becomeArray().push(1);
+		cleared.clear();
+		const std::vector<uint8_t> clearedBytes = Irrelon::dynaToCbor(cleared);
+		TEST_ASSERT_EQUAL(1u, clearedBytes.size());
+		TEST_ASSERT_EQUAL_STRING("[]", Irrelon::dynaFromCbor(clearedBytes).toJson().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_snapshot_view() {
+	try {
+		Irrelon::DynaVal config;
+		config["name"] = "gateway";
+		config["port"] = static_cast<int32_t>(8080);
+		config["ratio"] = 0.25;
+		config["enabled"] = true;
+		config["fallback"].becomeNull();
+		config["hosts"].push("alpha");
+		config["hosts"].push("beta");
+		config["hosts"].push("gamma");
+		config["limits"]["read"] = static_cast<int32_t>(10);
+		config["limits"]["write"] = static_cast<int32_t>(5);
+
+		const std::vector<uint8_t> snapshot = Irrelon::dynaSnapshotWrite(config);
+		TEST_ASSERT_TRUE(Irrelon::dynaSnapshotValidate(snapshot.data(), snapshot.size()));
+
+		const Irrelon::DynaView view(snapshot.data());
+		TEST_ASSERT_TRUE(view.isObject());
+		TEST_ASSERT_EQUAL(7, view.size());
+		TEST_ASSERT_EQUAL_STRING("gateway", view["name"].toString().c_str());
+		TEST_ASSERT_EQUAL_INT(8080, view["port"].toInt());
+		TEST_ASSERT_TRUE(view["port"].type() == Irrelon::DynaValType::Int);
+		TEST_ASSERT_DOUBLE_WITHIN(0.0001, 0.25, view["ratio"].toDouble());
+		TEST_ASSERT_TRUE(view["enabled"].toBool());
+		TEST_ASSERT_TRUE(view["fallback"].isNull());
+		TEST_ASSERT_TRUE(view["missing"].isNull());
+		TEST_ASSERT_TRUE(view.containsKey("limits"));
+		TEST_ASSERT_FALSE(view.containsKey("missing"));
+		TEST_ASSERT_EQUAL_INT(5, view["limits"]["write"].toInt());
+		TEST_ASSERT_EQUAL(3, view["hosts"].size());
+		TEST_ASSERT_TRUE(view["hosts"][1].toStringView() == "beta");
+		TEST_ASSERT_TRUE(view["hosts"][3].isNull());
+
+		std::string joined;
+		for (const Irrelon::DynaView host : view["hosts"]) joined += host.toStringView();
+		TEST_ASSERT_EQUAL_STRING("alphabetagamma", joined.c_str());
+
+		// Object iteration visits keys in sorted order
+		std::string keys;
+		for (auto it = view.begin(); it != view.end(); ++it) keys += std::string(it.key()) + ",";
+		TEST_ASSERT_EQUAL_STRING("enabled,fallback,hosts,limits,name,port,ratio,", keys.c_str());
+
+		TEST_ASSERT_TRUE(view.toDynaVal().equals(config));
+
+		std::vector<uint8_t> corrupt = snapshot;
+		corrupt[corrupt.size() - 1] = 0xff;
+		corrupt.pop_back();
+		TEST_ASSERT_FALSE(Irrelon::dynaSnapshotValidate(corrupt.data(), corrupt.size()));
+
+		// Entries pointing at the same node are refused rather than validated once per path
+		Irrelon::DynaVal pair;
+		pair.push(1);
+		pair.push(2);
+		std::vector<uint8_t> shared = Irrelon::dynaSnapshotWrite(pair);
+		TEST_ASSERT_TRUE(Irrelon::dynaSnapshotValidate(shared.data(), shared.size()));
+		const uint32_t rootOffset = Irrelon::detail::dynaReadU32(shared.data() + 8);
+		std::copy_n(shared.begin() + rootOffset + 5, 4, shared.begin() + rootOffset + 9);
+		TEST_ASSERT_FALSE(Irrelon::dynaSnapshotValidate(shared.data(), shared.size()));
+
+		// A cleared array has no storage and is written as a zero length array
+		Irrelon::DynaVal emptied;
+		emptied["list"].push(1);
+		emptied["list"].clear();
+		const std::vector<uint8_t> emptiedSnapshot = Irrelon::dynaSnapshotWrite(emptied);
+		TEST_ASSERT_TRUE(Irrelon::dynaSnapshotValidate(emptiedSnapshot.data(), emptiedSnapshot.size()));
+		const Irrelon::DynaView emptiedView(emptiedSnapshot.data());
+		TEST_ASSERT_TRUE(emptiedView["list"].isArray());
+		TEST_ASSERT_EQUAL(0, emptiedView["list"].size());
+
+		const uint8_t junk[16] = {};
+		TEST_ASSERT_TRUE(Irrelon::DynaView(junk).isNull());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_journal_replay_and_compaction() {
+	try {
+		const std::string path = "test_journal_state";
+		std::remove((path + ".snap").c_str());
+		std::remove((path + ".log").c_str());
+
+		Irrelon::DynaJournalOptions options;
+		options.syncEvery = 4;
+		options.compactAfterBytes = 0;
+
+		{
+			Irrelon::DynaJournal journal(path, options);
+			TEST_ASSERT_FALSE(journal.open().isError());
+			TEST_ASSERT_FALSE(journal.set("/device/name", "gateway").isError());
+			TEST_ASSERT_FALSE(journal.set("/device/port", static_cast<int32_t>(8080)).isError());
+			TEST_ASSERT_FALSE(journal.push("/events", "boot").isError());
+			TEST_ASSERT_FALSE(journal.push("/events", "connect").isError());
+			TEST_ASSERT_FALSE(journal.set("/scratch", true).isError());
+			TEST_ASSERT_FALSE(journal.remove("/scratch").isError());
+			TEST_ASSERT_TRUE(journal.remove("/missing").isError());
+		}
+
+		{
+			Irrelon::DynaJournal journal(path, options);
+			TEST_ASSERT_FALSE(journal.open().isError());
+			TEST_ASSERT_EQUAL_STRING("gateway", journal.state()["device"]["name"].toString().c_str());
+			TEST_ASSERT_TRUE(journal.state()["device"]["port"].isInt());
+			TEST_ASSERT_EQUAL(2, journal.state()["events"].size());
+			TEST_ASSERT_FALSE(journal.state().containsKey("scratch"));
+
+			const uint64_t generation = journal.generation();
+			TEST_ASSERT_FALSE(journal.compact().isError());
+			TEST_ASSERT_EQUAL(generation + 1, journal.generation());
+			TEST_ASSERT_FALSE(journal.set("/events/0", "restart").isError());
+		}
+
+		// A torn final entry is dropped and the rest of the log still replays
+		{
+			FILE *log = std::fopen((path + ".log").c_str(), "ab");
+			const uint8_t partial[] = {1, 200, 0, 0, 0, 0x82};
+			std::fwrite(partial, 1, sizeof(partial), log);
+			std::fclose(log);
+		}
+
+		{
+			Irrelon::DynaJournal journal(path, options);
+			TEST_ASSERT_FALSE(journal.open().isError());
+			TEST_ASSERT_EQUAL_STRING("restart", journal.state()["events"][0].toString().c_str());
+			TEST_ASSERT_EQUAL_STRING("connect", journal.state()["events"][1].toString().c_str());
+		}
+
+		std::remove((path + ".snap").c_str());
+		std::remove((path + ".log").c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_compile_time_literal() {
+	try {
+		using namespace Irrelon::literals;
+
+		static constexpr Irrelon::DynaView defaults = R"({
+			"name": "gateway",
+			"port": 8080,
+			"big": 5000000000,
+			"ratio": 0.25,
+			"enabled": true,
+			"fallback": null,
+			"hosts": ["alpha", "beta"],
+			"escaped": "tab\there \u00e9",
+			"port": 9090
+		})"_dyna;
+
+		// Everything below is answered by the compiler
+		static_assert(defaults.isObject());
+		static_assert(defaults.size() == 8);
+		static_assert(defaults["port"].toInt() == 9090);
+		static_assert(defaults["port"].type() == Irrelon::DynaValType::Int);
+		static_assert(defaults["big"].type() == Irrelon::DynaValType::Long);
+		static_assert(defaults["hosts"][1].toStringView() == "beta");
+		static_assert(defaults["missing"].isNull());
+
+		// A zero mantissa stays zero however large the exponent
+		static constexpr Irrelon::DynaView zeros = R"([0e400, -0.0e999, 1e-400])"_dyna;
+		static_assert(zeros[0].toDouble() == 0 && zeros[1].toDouble() == 0 && zeros[2].toDouble() == 0);
+
+		TEST_ASSERT_EQUAL_STRING("gateway", defaults["name"].toString().c_str());
+		TEST_ASSERT_DOUBLE_WITHIN(0.0001, 0.25, defaults["ratio"].toDouble());
+		TEST_ASSERT_TRUE(defaults["enabled"].toBool());
+		TEST_ASSERT_TRUE(defaults["fallback"].isNull());
+		TEST_ASSERT_EQUAL_STRING("tab\there \xc3\xa9", std::string(defaults["escaped"].toStringView()).c_str());
+
+		const auto &bytes = Irrelon::dynaLiteralBytes<R"([1, [2, 3], {}])">();
+		TEST_ASSERT_TRUE(Irrelon::dynaSnapshotValidate(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()));
+		TEST_ASSERT_EQUAL_STRING("[1,[2,3],{}]", Irrelon::dynaLiteral<R"([1, [2, 3], {}])">().toJson().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_struct_binding() {
+	try {
+		TestDevice device;
+		device.name = "gate \"1\"";
+		device.enabled = true;
+		device.ratio = 0.1;
+		device.uptime = 5000000000LL;
+		device.endpoints.push_back({"alpha", 8080});
+		device.endpoints.push_back({"beta", 8081});
+		device.flags = {true, false, true};
+		device.extra["note"] = "free form";
+
+		const Irrelon::DynaVal val = Irrelon::toDynaVal(device);
+		TEST_ASSERT_TRUE(val["enabled"].isBool());
+		TEST_ASSERT_TRUE(val["uptime"].type == Irrelon::DynaValType::Long);
+		TEST_ASSERT_TRUE(val["endpoints"][1]["port"].isUInt());
+		TEST_ASSERT_EQUAL_INT(8081, val["endpoints"][1]["port"].toInt());
+
+		TestDevice fromVal;
+		TEST_ASSERT_FALSE(Irrelon::fromDynaVal(val, fromVal).isError());
+		TEST_ASSERT_EQUAL_STRING(device.name.c_str(), fromVal.name.c_str());
+		TEST_ASSERT_EQUAL(2, fromVal.endpoints.size());
+		TEST_ASSERT_EQUAL_STRING("beta", fromVal.endpoints[1].host.c_str());
+
+		// Direct struct to JSON and back, with no tree in between
+		const std::string json = Irrelon::dynaToJson(device);
+		TEST_ASSERT_TRUE(Irrelon::dynaFromJson(json).equals(val));
+
+		TestDevice fromJson;
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(json, fromJson).isError());
+		TEST_ASSERT_EQUAL_STRING(device.name.c_str(), fromJson.name.c_str());
+		TEST_ASSERT_TRUE(fromJson.enabled);
+		TEST_ASSERT_TRUE(fromJson.ratio == 0.1);
+		TEST_ASSERT_TRUE(fromJson.uptime == 5000000000LL);
+		TEST_ASSERT_EQUAL_INT(8080, fromJson.endpoints[0].port);
+		TEST_ASSERT_EQUAL_STRING("free form", fromJson.extra["note"].toString().c_str());
+		TEST_ASSERT_TRUE(fromJson.flags == device.flags);
+		TEST_ASSERT_TRUE(fromVal.flags == device.flags);
+
+		TestDevice partial;
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(R"({"unknown": [1, {"a": 2}], "name": "x"})", partial).isError());
+		TEST_ASSERT_EQUAL_STRING("x", partial.name.c_str());
+		TEST_ASSERT_EQUAL_INT(0, partial.endpoints.size());
+
+		Irrelon::DynaVal wrong = val.deepCopy();
+		wrong["endpoints"][1]["port"] = "high";
+		const Irrelon::DynaVal result = Irrelon::fromDynaVal(wrong, fromVal);
+		TEST_ASSERT_TRUE(result.isError());
+		TEST_ASSERT_EQUAL_STRING("endpoints.1.port", result.toError().key.c_str());
+
+		TEST_ASSERT_TRUE(Irrelon::dynaFromJson(R"({"name": })", partial).isError());
+
+		// Wrong types, fractions and out of range numbers are 422 errors keyed by the field path
+		const Irrelon::DynaVal mismatch = Irrelon::dynaFromJson(R"({"endpoints": [{"port": 1}, {"port": "high"}]})", partial);
+		TEST_ASSERT_EQUAL_INT(422, mismatch.toError().statusCode);
+		TEST_ASSERT_EQUAL_STRING("endpoints.1.port", mismatch.toError().key.c_str());
+
+		// 64 bit fields round trip every digit, past where a double is exact
+		TestDevice wide;
+		wide.uptime = INT64_MAX;
+		TestDevice wideBack;
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(Irrelon::dynaToJson(wide), wideBack).isError());
+		TEST_ASSERT_TRUE(wideBack.uptime == INT64_MAX);
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(R"({"uptime": 9007199254740993})", wideBack).isError());
+		TEST_ASSERT_TRUE(wideBack.uptime == 9007199254740993LL);
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(R"({"uptime": -9223372036854775808})", wideBack).isError());
+		TEST_ASSERT_TRUE(wideBack.uptime == INT64_MIN);
+		TEST_ASSERT_EQUAL_INT(422, Irrelon::dynaFromJson(R"({"uptime": 9223372036854775808})", wideBack).toError().statusCode);
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(R"({"uptime": 2e3})", wideBack).isError());
+		TEST_ASSERT_TRUE(wideBack.uptime == 2000);
+		TEST_ASSERT_EQUAL_INT(422, Irrelon::dynaFromJson(R"({"endpoints": [{"port": -1}]})", partial).toError().statusCode);
+		TEST_ASSERT_FALSE(Irrelon::dynaFromJson(R"({"endpoints": [{"port": -0}]})", partial).isError());
+
+		const Irrelon::DynaVal tooBig = Irrelon::dynaFromJson(R"({"endpoints": [{"port": 70000}]})", partial);
+		TEST_ASSERT_EQUAL_INT(422, tooBig.toError().statusCode);
+		TEST_ASSERT_EQUAL_STRING("endpoints.0.port", tooBig.toError().key.c_str());
+
+		const Irrelon::DynaVal fraction = Irrelon::dynaFromJson(R"({"uptime": 1.5})", partial);
+		TEST_ASSERT_EQUAL_INT(422, fraction.toError().statusCode);
+		TEST_ASSERT_EQUAL_STRING("uptime", fraction.toError().key.c_str());
+
+		wrong["endpoints"][1]["port"] = -1;
+		TEST_ASSERT_EQUAL_STRING("endpoints.1.port", Irrelon::fromDynaVal(wrong, fromVal).toError().key.c_str());
+		wrong["endpoints"][1]["port"] = 1e300;
+		TEST_ASSERT_EQUAL_INT(422, Irrelon::fromDynaVal(wrong, fromVal).toError().statusCode);
+
+		// Doubles printed with 17 digits read back as the same bits
+		const double samples[] = {0.1, 1.0 / 3, 5e-324, 2.2250738585072014e-308, 1.7976931348623157e308, 9007199254740993.0, 123456.789e-5, 8.98846567431158e307};
+		uint64_t bits = 0x9e3779b97f4a7c15ULL;
+		for (int i = 0; i < 2000; ++i) {
+			double sample;
+			if (i < 8) {
+				sample = samples[i];
+			} else {
+				bits ^= bits << 13;
+				bits ^= bits >> 7;
+				bits ^= bits << 17;
+				std::memcpy(&sample, &bits, sizeof(sample));
+				if (!std::isfinite(sample)) continue;
+			}
+			char text[32];
+			std::snprintf(text, sizeof(text), "%.17g", sample);
+			TEST_ASSERT_TRUE_MESSAGE(Irrelon::dynaFromJson(text).number == sample, text);
+		}
+
+		// Zero and underflow read as zero, overflow is rejected rather than read as infinity
+		TEST_ASSERT_TRUE(Irrelon::dynaFromJson("0e400").number == 0);
+		TEST_ASSERT_TRUE(Irrelon::dynaFromJson("1e-400").number == 0);
+		TEST_ASSERT_EQUAL_INT(400, Irrelon::dynaFromJson("1e400").toError().statusCode);
+		TEST_ASSERT_EQUAL_INT(400, Irrelon::dynaFromJson("-1.8e308").toError().statusCode);
+
+		// Nesting past DYNAVAL_JSON_MAX_DEPTH is rejected, both when kept and when skipped
+		const std::string deep = std::string(100000, '[') + std::string(100000, ']');
+		TEST_ASSERT_EQUAL_INT(400, Irrelon::dynaFromJson(deep).toError().statusCode);
+		TEST_ASSERT_EQUAL_INT(400, Irrelon::dynaFromJson("{\"unknown\":" + deep + "}", partial).toError().statusCode);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_schema_validation() {
+	try {
+		Irrelon::DynaVal params;
+		params.push(Irrelon::makeParam("name", Irrelon::makeType(Irrelon::DynaValType::String)));
+		params.push(Irrelon::makeParam("port", Irrelon::makeType(Irrelon::DynaValType::UInt), static_cast<uint32_t>(80), true));
+		params.push(Irrelon::makeParam("tags", Irrelon::makeType(Irrelon::DynaValType::Array, Irrelon::makeType(Irrelon::DynaValType::String))));
+
+		const Irrelon::DynaSchema schema = Irrelon::DynaSchema::fromDescriptor(params);
+
+		Irrelon::DynaVal good;
+		good["name"] = "gateway";
+		good["tags"].push("edge");
+		TEST_ASSERT_TRUE(schema.isValid(good));
+		TEST_ASSERT_FALSE(good.containsKey("port"));
+		TEST_ASSERT_EQUAL(0, schema.validateAndFill(good).size());
+		TEST_ASSERT_EQUAL_INT(80, good["port"].toInt());
+
+		Irrelon::DynaVal bad;
+		bad["port"] = -1;
+		bad["tags"].push("edge");
+		bad["tags"].push(3);
+		const std::vector<Irrelon::DynaError> errors = schema.validate(bad);
+		TEST_ASSERT_EQUAL(3, errors.size());
+		std::string paths;
+		for (const auto &error : errors) paths += error.key + ";";
+		TEST_ASSERT_TRUE(paths.find("name;") != std::string::npos);
+		TEST_ASSERT_TRUE(paths.find("port;") != std::string::npos);
+		TEST_ASSERT_TRUE(paths.find("tags.1;") != std::string::npos);
+		TEST_ASSERT_EQUAL_INT(422, errors[0].statusCode);
+
+		const Irrelon::DynaSchema jsonSchema = Irrelon::DynaSchema::fromJsonSchema(Irrelon::dynaFromJson(R"({
+			"type": "object",
+			"required": ["id"],
+			"additionalProperties": false,
+			"properties": {
+				"id": {"type": "integer", "minimum": 1},
+				"mode": {"enum": ["auto", "manual"], "default": "auto"},
+				"label": {"type": ["string", "null"], "maxLength": 4}
+			}
+		})"));
+
+		Irrelon::DynaVal record = Irrelon::dynaFromJson(R"({"id": 7, "label": null})");
+		TEST_ASSERT_EQUAL(0, jsonSchema.validateAndFill(record).size());
+		TEST_ASSERT_EQUAL_STRING("auto", record["mode"].toString().c_str());
+
+		const Irrelon::DynaVal wrong = Irrelon::dynaFromJson(R"({"id": 1.5, "mode": "off", "label": "toolong", "extra": 1})");
+		TEST_ASSERT_EQUAL(4, jsonSchema.validate(wrong).size());
+		TEST_ASSERT_FALSE(jsonSchema.isValid(Irrelon::dynaFromJson(R"({"id": 0})")));
+
+		// validate() leaves its input alone, defaults are only written by validateAndFill()
+		const Irrelon::DynaVal bare = Irrelon::dynaFromJson(R"({"id": 3})");
+		TEST_ASSERT_TRUE(jsonSchema.isValid(bare));
+		TEST_ASSERT_FALSE(bare.containsKey("mode"));
+
+		// Inclusive and exclusive bounds on the same node both apply
+		const Irrelon::DynaSchema bounded = Irrelon::DynaSchema::fromJsonSchema(Irrelon::dynaFromJson(
+			R"({"type": "number", "minimum": 1, "exclusiveMinimum": 0, "maximum": 5, "exclusiveMaximum": 10})"));
+		TEST_ASSERT_FALSE(bounded.isValid(Irrelon::DynaVal(0.5)));
+		TEST_ASSERT_TRUE(bounded.isValid(Irrelon::DynaVal(1.0)));
+		TEST_ASSERT_TRUE(bounded.isValid(Irrelon::DynaVal(5.0)));
+		TEST_ASSERT_FALSE(bounded.isValid(Irrelon::DynaVal(7.0)));
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_program_compile_and_run() {
+	try {
+		using namespace Irrelon;
+
+		// (qty = 1) * (price ?? 0) > limit && enabled ? "big" : "small"
+		const DynaVal ast = makeConditional(
+			makeLogical("&&",
+				makeBinary(">",
+					makeBinary("*",
+						makeParam("qty", makeType(DynaValType::Int), static_cast<int32_t>(1), true),
+						makeLogical("??", makeIdentifier("price"), makeLiteral(static_cast<int32_t>(0)))),
+					makeIdentifier("limit")),
+				makeIdentifier("enabled")),
+			makeLiteral("big"),
+			makeLiteral("small"));
+
+		const DynaProgram program = DynaProgram::compile(ast, {"limit"});
+		TEST_ASSERT_EQUAL_INT(0, program.slot("limit"));
+		TEST_ASSERT_EQUAL(4, program.slotCount());
+
+		DynaVal scope;
+		scope["limit"] = static_cast<int32_t>(100);
+		scope["price"] = static_cast<int32_t>(150);
+		scope["enabled"] = true;
+		TEST_ASSERT_EQUAL_STRING("big", program.run(scope).toString().c_str());
+
+		scope["qty"] = static_cast<int32_t>(0);
+		TEST_ASSERT_EQUAL_STRING("small", program.run(scope).toString().c_str());
+
+		// Slot values by position, undefined price falls back to 0
+		DynaVal limit = static_cast<int32_t>(-1);
+		DynaVal qty = static_cast<int32_t>(3);
+		TEST_ASSERT_EQUAL_STRING("big", program.run(std::vector<DynaVal> {limit, qty, DynaVal().becomeUndefined(), DynaVal(true)}).toString().c_str());
+
+		const DynaVal sum = DynaProgram::compile(makeBinary("+", makeIdentifier("a"), makeIdentifier("b"))).run(scope);
+		TEST_ASSERT_TRUE(sum.isError());
+
+		scope["a"] = static_cast<int32_t>(7);
+		scope["b"] = static_cast<int32_t>(5);
+		const DynaVal product = DynaProgram::compile(makeBinary("*", makeIdentifier("a"), makeIdentifier("b"))).run(scope);
+		TEST_ASSERT_TRUE(product.isInt());
+		TEST_ASSERT_EQUAL_INT(35, product.toInt());
+
+		// Integer results that leave their operand type widen instead of wrapping
+		scope["a"] = static_cast<uint32_t>(1);
+		scope["b"] = static_cast<uint32_t>(3);
+		const DynaVal difference = DynaProgram::compile(makeBinary("-", makeIdentifier("a"), makeIdentifier("b"))).run(scope);
+		TEST_ASSERT_TRUE(difference.isInt());
+		TEST_ASSERT_EQUAL_INT(-2, difference.toInt());
+
+		scope["a"] = static_cast<int32_t>(2000000000);
+		scope["b"] = static_cast<int32_t>(2000000000);
+		const DynaVal overflow = DynaProgram::compile(makeBinary("+", makeIdentifier("a"), makeIdentifier("b"))).run(scope);
+		TEST_ASSERT_EQUAL(DynaValType::Long, overflow.type);
+		TEST_ASSERT_EQUAL_DOUBLE(4000000000.0, overflow.number);
+
+		// Negation widens the same way
+		scope["a"] = static_cast<uint32_t>(3000000000u);
+		const DynaVal negatedUInt = DynaProgram::compile(makeUnary("-", makeIdentifier("a"))).run(scope);
+		TEST_ASSERT_EQUAL(DynaValType::Long, negatedUInt.type);
+		TEST_ASSERT_EQUAL_DOUBLE(-3000000000.0, negatedUInt.number);
+		scope["a"] = static_cast<int32_t>(INT32_MIN);
+		const DynaVal negatedMin = DynaProgram::compile(makeUnary("-", makeIdentifier("a"))).run(scope);
+		TEST_ASSERT_EQUAL(DynaValType::Long, negatedMin.type);
+		TEST_ASSERT_EQUAL_DOUBLE(2147483648.0, negatedMin.number);
+		scope["a"] = static_cast<uint32_t>(5);
+		const DynaVal negatedSmall = DynaProgram::compile(makeUnary("-", makeIdentifier("a"))).run(scope);
+		TEST_ASSERT_TRUE(negatedSmall.isInt());
+		TEST_ASSERT_EQUAL_INT(-5, negatedSmall.toInt());
+
+		// Integer zero divisors are errors for both operators
+		scope["b"] = static_cast<int32_t>(0);
+		TEST_ASSERT_EQUAL_INT(400, DynaProgram::compile(makeBinary("/", makeIdentifier("a"), makeIdentifier("b"))).run(scope).errorData->statusCode);
+		TEST_ASSERT_EQUAL_INT(400, DynaProgram::compile(makeBinary("%", makeIdentifier("a"), makeIdentifier("b"))).run(scope).errorData->statusCode);
+
+		scope["list"].push("zero");
+		scope["list"].push("one");
+		const DynaVal member = DynaProgram::compile(
+			makeBinary("+", makeMember(makeIdentifier("list"), makeLiteral(static_cast<int32_t>(1))), makeLiteral("!"))
+		).run(scope);
+		TEST_ASSERT_EQUAL_STRING("one!", member.toString().c_str());
+
+		TEST_ASSERT_TRUE(DynaProgram::compile(makeUnary("!", makeIdentifier("missing"))).run(scope).toBool());
+
+		// A container literal comes back as a fresh value each run
+		DynaVal literal;
+		literal["a"] = static_cast<int32_t>(1);
+		const DynaProgram constant = DynaProgram::compile(makeLiteral(literal));
+		literal["a"] = static_cast<int32_t>(2);
+		DynaVal out = constant.run(std::vector<DynaVal> {});
+		TEST_ASSERT_FALSE(out.isFrozen());
+		out["a"] = static_cast<int32_t>(99);
+		TEST_ASSERT_EQUAL_STRING("{\"a\":1}", constant.run(std::vector<DynaVal> {}).toJson().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_query_compile_and_stream() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal doc;
+		doc["site"] = "north";
+		doc["limit"] = static_cast<int32_t>(30);
+		for (int32_t i = 0; i < 6; ++i) {
+			DynaVal reading;
+			reading["id"] = "r" + std::to_string(i);
+			reading["value"] = i * 10;
+			if (i % 2 == 0) reading["tags"].push("even");
+			doc["readings"].push(reading);
+		}
+
+		const DynaQuery query = DynaQuery::compile("$.readings[?(@.value > 30)].id");
+		std::vector<std::string> ids;
+		query.forEach(doc, [&ids](const DynaVal &id) { ids.push_back(id.string); });
+		TEST_ASSERT_EQUAL(2, ids.size());
+		TEST_ASSERT_EQUAL_STRING("r4", ids[0].c_str());
+		TEST_ASSERT_EQUAL_STRING("r5", ids[1].c_str());
+
+		// Matches are references into the document, not copies
+		TEST_ASSERT_TRUE(DynaQuery::compile("$.readings[0]").first(doc) == &doc["readings"][0]);
+
+		TEST_ASSERT_EQUAL(6, DynaQuery::compile("$.readings[*].value").count(doc));
+		TEST_ASSERT_EQUAL_STRING("r5", DynaQuery::compile("$['readings'][-1].id").first(doc)->string.c_str());
+		TEST_ASSERT_EQUAL_STRING("[\"r1\",\"r3\"]", DynaQuery::compile("$.readings[1:5:2].id").select(doc).toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[\"r5\",\"r3\",\"r1\"]", DynaQuery::compile("$.readings[::-2].id").select(doc).toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[\"r0\",\"r2\"]", DynaQuery::compile("$.readings[0,2].id").select(doc).toJson().c_str());
+		TEST_ASSERT_EQUAL(3, DynaQuery::compile("$..tags[0]").count(doc));
+		TEST_ASSERT_EQUAL(3, DynaQuery::compile("$.readings[?(@.tags)]").count(doc));
+		TEST_ASSERT_EQUAL(2, DynaQuery::compile("$.readings[?(@.value >= $.limit && !(@.tags[0] == 'even'))]").count(doc));
+		TEST_ASSERT_EQUAL(2, DynaQuery::compile("$.readings[?(@.id == \"r1\" || @.value < 10)]").count(doc));
+
+		// Returning false from the callback stops the query
+		size_t seen = 0;
+		DynaQuery::compile("$..value").forEach(doc, [&seen](const DynaVal &) { return ++seen < 2; });
+		TEST_ASSERT_EQUAL(2, seen);
+
+		bool threw = false;
+		try {
+			(void)DynaQuery::compile("$.readings[?(@.value > )]");
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		TEST_ASSERT_TRUE(threw);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_secondary_index() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal devices;
+		for (int32_t i = 0; i < 5; ++i) {
+			DynaVal device;
+			device["mac"] = "mac-" + std::to_string(i);
+			device["meta"]["rssi"] = -40 - i * 10;
+			devices.push(device);
+		}
+		devices.push("not a record");
+
+		DynaIndex byMac(devices, "mac");
+		DynaIndex byRssi(devices, "meta.rssi", {false, true});
+
+		TEST_ASSERT_TRUE(byMac.find("mac-3") == &devices[3]);
+		TEST_ASSERT_NULL(byMac.find("mac-9"));
+		TEST_ASSERT_EQUAL(1, byRssi.findAll(-60).size());
+		TEST_ASSERT_EQUAL(2, byRssi.findAll(-60).front());
+
+		// Ordered by value, bounds inclusive, and a mixed int / double key still matches
+		std::vector<size_t> weak = byRssi.range(-70, -50.0);
+		TEST_ASSERT_EQUAL(3, weak.size());
+		TEST_ASSERT_EQUAL(3, weak[0]);
+		TEST_ASSERT_EQUAL(1, weak[2]);
+		TEST_ASSERT_EQUAL(0, byRssi.range(-50, -70).size());
+
+		// Changes made through the index keep it current
+		DynaVal extra;
+		extra["mac"] = "mac-1";
+		TEST_ASSERT_EQUAL(6, byMac.push(extra));
+		TEST_ASSERT_EQUAL(2, byMac.count("mac-1"));
+		TEST_ASSERT_EQUAL(7, devices.size());
+
+		byMac.remove(0);
+		TEST_ASSERT_NULL(byMac.find("mac-0"));
+		TEST_ASSERT_TRUE(byMac.find("mac-4") == &devices[3]);
+		TEST_ASSERT_EQUAL(5, byMac.findAll("mac-1").back());
+
+		byMac.set(0, "mac", "renamed");
+		TEST_ASSERT_EQUAL(1, byMac.count("mac-1"));
+		TEST_ASSERT_TRUE(byMac.find("renamed") == &devices[0]);
+
+		// The rssi index did not see those changes until it is rebuilt
+		byRssi.rebuild();
+		TEST_ASSERT_TRUE(byRssi.find(-80) == &devices[3]);
+
+		// find() returns the lowest position even after updates reorder the buckets
+		byMac.set(1, "mac", "mac-1");
+		TEST_ASSERT_TRUE(byMac.find("mac-1") == &devices[1]);
+
+		// NaN fields are left out of the index and NaN bounds match nothing
+		byRssi.update(2, [](DynaVal &record) { record["meta"]["rssi"] = std::nan(""); });
+		TEST_ASSERT_EQUAL(3, byRssi.range(-1000, 1000).size());
+		TEST_ASSERT_NULL(byRssi.find(std::nan("")));
+		TEST_ASSERT_EQUAL(0, byRssi.range(-1000, std::nan("")).size());
+
+		// A direct change to the shared array never hands back a dead record
+		DynaVal direct;
+		for (int32_t i = 0; i < 4; ++i) {
+			DynaVal record;
+			record["id"] = i;
+			direct.push(record);
+		}
+		DynaIndex byId(direct, "id");
+		direct.remove(2);
+		TEST_ASSERT_TRUE(byId.isStale());
+		TEST_ASSERT_NULL(byId.find(static_cast<int32_t>(3)));
+		TEST_ASSERT_EQUAL(0, byId.findAll(static_cast<int32_t>(3)).size());
+		TEST_ASSERT_EQUAL(0, byId.count(static_cast<int32_t>(3)));
+		byId.rebuild();
+		TEST_ASSERT_TRUE(byId.find(static_cast<int32_t>(3)) == &direct[2]);
+
+		// Container fields are left out of both indexes and container keys find nothing
+		DynaVal tagged;
+		for (int32_t i = 0; i < 3; ++i) {
+			DynaVal record;
+			record["tags"].push(i);
+			tagged.push(record);
+		}
+		DynaVal scalarTag;
+		scalarTag["tags"] = "none";
+		tagged.push(scalarTag);
+		DynaIndex byTagsHashed(tagged, "tags");
+		DynaIndex byTagsOrdered(tagged, "tags", {false, true});
+		DynaVal tagKey;
+		tagKey.push(static_cast<int32_t>(1));
+		TEST_ASSERT_NULL(byTagsHashed.find(tagKey));
+		TEST_ASSERT_NULL(byTagsOrdered.find(tagKey));
+		TEST_ASSERT_EQUAL(0, byTagsOrdered.count(tagKey));
+		TEST_ASSERT_EQUAL(0, byTagsOrdered.findAll(tagKey).size());
+		TEST_ASSERT_EQUAL(1, byTagsOrdered.range("a", "z").size());
+		TEST_ASSERT_TRUE(byTagsOrdered.find("none") == &tagged[3]);
+
+		bool threw = false;
+		try {
+			(void)byMac.range(0, 1);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		TEST_ASSERT_TRUE(threw);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_columnar_table() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal samples;
+		for (int32_t i = 0; i < 100; ++i) {
+			DynaVal sample;
+			sample["ts"] = 1000 + i;
+			sample["temp"] = i % 10 == 0 ? DynaVal(20.5) : DynaVal(static_cast<int32_t>(15 + i % 10));
+			if (i % 3) sample["hum"] = static_cast<int32_t>(40 + i % 20);
+			sample["room"] = i % 2 ? "kitchen" : "hall";
+			samples.push(sample);
+		}
+
+		const DynaTable table = DynaTable::fromRows(samples);
+		TEST_ASSERT_EQUAL(100, table.rowCount());
+		TEST_ASSERT_EQUAL(4, table.columnCount());
+
+		const DynaTable::Column *ts = table.column("ts");
+		TEST_ASSERT_TRUE(ts->type() == DynaValType::Int);
+		TEST_ASSERT_EQUAL(100, ts->numbers().size());
+		TEST_ASSERT_EQUAL_DOUBLE(1042, ts->numbers()[42]);
+
+		// Mixed Int and Double rows widen the column to Double
+		TEST_ASSERT_TRUE(table.column("temp")->type() == DynaValType::Double);
+		TEST_ASSERT_TRUE(table.column("room")->type() == DynaValType::String);
+
+		const DynaTable::Column *hum = table.column("hum");
+		TEST_ASSERT_EQUAL(34, hum->nullCount());
+		TEST_ASSERT_TRUE(hum->isNull(3));
+		TEST_ASSERT_FALSE(hum->isNull(4));
+		TEST_ASSERT_TRUE(hum->at(3).isNull());
+
+		const std::vector<size_t> warm = table.where("temp", [](const double t) { return t > 23; });
+		TEST_ASSERT_EQUAL(10, warm.size());
+		TEST_ASSERT_EQUAL(9, warm[0]);
+
+		const std::vector<size_t> kitchen = table.where("room", [](const std::string &room) { return room == "kitchen"; });
+		TEST_ASSERT_EQUAL(50, kitchen.size());
+
+		const DynaTable picked = table.take(warm).project({"ts", "hum"});
+		TEST_ASSERT_EQUAL(2, picked.columnCount());
+		TEST_ASSERT_EQUAL(10, picked.rowCount());
+		TEST_ASSERT_EQUAL_STRING("[{\"ts\":1009,\"hum\":null},{\"ts\":1019,\"hum\":59}]",
+			picked.take({0, 1}).toJson().c_str());
+
+		const DynaVal rows = table.toRows();
+		TEST_ASSERT_EQUAL(100, rows.size());
+		TEST_ASSERT_TRUE(rows[7]["temp"].equals(samples[7]["temp"]));
+		TEST_ASSERT_TRUE(rows[7]["temp"].isDouble());
+		TEST_ASSERT_TRUE(rows[7]["room"] == "kitchen");
+
+		bool threw = false;
+		try {
+			(void)table.where("room", [](const double) { return true; });
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		TEST_ASSERT_TRUE(threw);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_numeric_stats() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal values;
+		for (int32_t i = 1; i <= 1001; ++i) {
+			if (i % 4 == 0) values.push(static_cast<double>(i));
+			else if (i % 4 == 1) values.push(static_cast<uint32_t>(i));
+			else if (i % 4 == 2) values.push(static_cast<float>(i));
+			else values.push(static_cast<int32_t>(i));
+		}
+		values.push("not a number");
+		values.push(DynaVal());
+
+		const DynaStats stats = dynaStats(values);
+		TEST_ASSERT_EQUAL(1001, stats.count);
+		TEST_ASSERT_EQUAL_DOUBLE(501501, stats.sum);
+		TEST_ASSERT_EQUAL_DOUBLE(1, stats.min);
+		TEST_ASSERT_EQUAL_DOUBLE(1001, stats.max);
+		TEST_ASSERT_EQUAL_DOUBLE(501, stats.mean);
+		// Population variance of 1..n is (n^2 - 1) / 12
+		TEST_ASSERT_DOUBLE_WITHIN(1e-6, (1001.0 * 1001.0 - 1) / 12, stats.variance);
+		TEST_ASSERT_EQUAL_DOUBLE(501501, dynaSum(values));
+		TEST_ASSERT_EQUAL_DOUBLE(1001, dynaMax(values));
+
+		const std::vector<size_t> buckets = dynaHistogram(values, 4, 1, 1001);
+		TEST_ASSERT_EQUAL(4, buckets.size());
+		TEST_ASSERT_EQUAL(250, buckets[0]);
+		TEST_ASSERT_EQUAL(251, buckets[3]);
+
+		TEST_ASSERT_EQUAL(0, dynaStats(DynaVal().becomeArray()).count);
+
+		// min and max skip NaN wherever it falls, in the vector lanes or the scalar tail
+		for (size_t at = 0; at < 9; ++at) {
+			std::vector<double> withNaN = {5, 3, 8, 1, 9, 2, 7, 4, 6};
+			withNaN[at] = std::nan("");
+			const DynaStats nanStats = dynaStats(withNaN);
+			TEST_ASSERT_EQUAL_DOUBLE(withNaN[3] == 1 ? 1 : 2, nanStats.min);
+			TEST_ASSERT_EQUAL_DOUBLE(withNaN[4] == 9 ? 9 : 8, nanStats.max);
+			TEST_ASSERT_TRUE(std::isnan(nanStats.sum));
+		}
+		TEST_ASSERT_TRUE(std::isnan(dynaStats(std::vector<double>(5, std::nan(""))).min));
+		DynaVal nanFirst;
+		nanFirst.push(std::nan(""));
+		nanFirst.push(4);
+		nanFirst.push(-2);
+		TEST_ASSERT_EQUAL_DOUBLE(-2, dynaMin(nanFirst));
+		TEST_ASSERT_EQUAL_DOUBLE(4, dynaMax(nanFirst));
+		nanFirst.remove(0);
+		TEST_ASSERT_DOUBLE_WITHIN(1e-9, 9, dynaVariance(nanFirst));
+		TEST_ASSERT_TRUE(std::isnan(dynaMean(DynaVal().becomeArray())));
+
+		// Arrays are read in chunks, and a chunk of only NaN leaves the bounds of the others alone
+		DynaVal chunked;
+		for (int32_t i = 0; i < 300; ++i) chunked.push(i < 200 ? std::nan("") : static_cast<double>(i));
+		TEST_ASSERT_EQUAL_DOUBLE(200, dynaMin(chunked));
+		TEST_ASSERT_EQUAL_DOUBLE(299, dynaStats(chunked).max);
+		TEST_ASSERT_EQUAL(300, dynaStats(chunked).count);
+		TEST_ASSERT_EQUAL(100, dynaHistogram(chunked, 2)[0] + dynaHistogram(chunked, 2)[1]);
+
+		// Null cells of a table column are skipped
+		DynaVal rows;
+		for (int32_t i = 0; i < 7; ++i) {
+			DynaVal row;
+			row.becomeObject();
+			if (i != 3) row["v"] = i;
+			rows.push(row);
+		}
+		const DynaStats column = dynaStats(*DynaTable::fromRows(rows).column("v"));
+		TEST_ASSERT_EQUAL(6, column.count);
+		TEST_ASSERT_EQUAL_DOUBLE(18, column.sum);
+		TEST_ASSERT_EQUAL_DOUBLE(6, column.max);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_sort_top_k_group_by() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal readings;
+		const int32_t values[] = {5, -3, 12, 5, 0, 7, -20, 12};
+		for (int32_t i = 0; i < 8; ++i) {
+			DynaVal reading;
+			reading["id"] = i;
+			reading["data"]["value"] = i == 2 ? DynaVal(12.0) : DynaVal(values[i]);
+			reading["room"] = i % 3 == 0 ? "hall" : i % 3 == 1 ? "kitchen" : "kitchenette";
+			readings.push(reading);
+		}
+		DynaVal unkeyed;
+		unkeyed["id"] = 8;
+		readings.push(unkeyed);
+
+		DynaVal sorted = readings.deepCopy();
+		dynaSortBy(sorted, "data.value");
+		std::string ids;
+		for (size_t i = 0; i < sorted.size(); ++i) ids += std::to_string(sorted[i]["id"].toInt()) + ",";
+		// Stable for equal keys, missing keys last
+		TEST_ASSERT_EQUAL_STRING("6,1,4,0,3,5,2,7,8,", ids.c_str());
+
+		dynaSortBy(sorted, "data.value", true);
+		ids.clear();
+		for (size_t i = 0; i < sorted.size(); ++i) ids += std::to_string(sorted[i]["id"].toInt()) + ",";
+		TEST_ASSERT_EQUAL_STRING("2,7,5,0,3,4,1,6,8,", ids.c_str());
+
+		dynaSortBy(sorted, "room");
+		TEST_ASSERT_TRUE(sorted[0]["room"] == "hall");
+		TEST_ASSERT_TRUE(sorted[7]["room"] == "kitchenette");
+		TEST_ASSERT_FALSE(sorted[8].containsKey("room"));
+		TEST_ASSERT_EQUAL_INT(2, sorted[6]["id"].toInt());
+
+		const DynaVal top = dynaTopK(readings, "data.value", 3);
+		TEST_ASSERT_EQUAL(3, top.size());
+		TEST_ASSERT_EQUAL_INT(2, top[0]["id"].toInt());
+		TEST_ASSERT_EQUAL_INT(7, top[1]["id"].toInt());
+		TEST_ASSERT_EQUAL_INT(5, top[2]["id"].toInt());
+		TEST_ASSERT_EQUAL_INT(6, dynaTopK(readings, "data.value", 1, false)[0]["id"].toInt());
+
+		const DynaVal groups = dynaGroupBy(readings, "room");
+		TEST_ASSERT_EQUAL(4, groups.size());
+		TEST_ASSERT_EQUAL(3, groups["hall"].size());
+		TEST_ASSERT_EQUAL_INT(4, groups["kitchen"][1]["id"].toInt());
+		TEST_ASSERT_EQUAL(1, groups["null"].size());
+		TEST_ASSERT_EQUAL(2, dynaGroupBy(readings, "data.value")["12"].size());
+
+		// The parallel variant gives the same order
+		DynaVal large;
+		for (int32_t i = 0; i < 5000; ++i) large.push((i * 7919) % 1000 - 500);
+		DynaVal expected = large.deepCopy();
+		dynaSortBy(expected);
+		DynaParallelPolicy policy;
+		policy.threads = 4;
+		policy.cutoff = 100;
+		dynaSortBy(large, "", false, policy);
+		TEST_ASSERT_TRUE(large.equals(expected));
+		TEST_ASSERT_EQUAL_INT(-500, large[0].toInt());
+		TEST_ASSERT_EQUAL_INT(499, large[4999].toInt());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_ref_and_slice_views() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal doc;
+		doc["name"] = "sensor";
+		for (int32_t i = 0; i < 10; ++i) doc["samples"].push(i * 10);
+		doc["meta"]["rssi"] = -72;
+		const long arrayUses = doc["samples"].array.use_count();
+
+		const DynaRef ref(doc);
+		TEST_ASSERT_EQUAL_INT(-72, ref["meta"]["rssi"].toInt());
+		TEST_ASSERT_TRUE(ref["name"].toStringView() == "sensor");
+
+		// Missing keys and indexes read as null without creating anything
+		TEST_ASSERT_FALSE(ref["missing"]["deeper"].exists());
+		TEST_ASSERT_TRUE(ref["missing"].isNull());
+		TEST_ASSERT_FALSE(ref["samples"][42].exists());
+		TEST_ASSERT_FALSE(doc.containsKey("missing"));
+		TEST_ASSERT_EQUAL(3, doc.size());
+
+		const DynaSlice window = ref["samples"].slice(2, 7);
+		TEST_ASSERT_EQUAL(5, window.size());
+		TEST_ASSERT_EQUAL_INT(20, window[0].toInt());
+		TEST_ASSERT_TRUE(window.begin() == &doc["samples"][2]);
+		TEST_ASSERT_EQUAL_STRING("[20,30,40,50,60]", window.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[50,60]", window.slice(3, 100).toJson().c_str());
+		TEST_ASSERT_TRUE(window.slice(4, 2).empty());
+		TEST_ASSERT_TRUE(ref["name"].items().empty());
+
+		int32_t total = 0;
+		for (const DynaVal &sample : window) total += sample.toInt();
+		TEST_ASSERT_EQUAL_INT(200, total);
+
+		size_t entries = 0;
+		ref.forEachEntry([&entries](const std::string &, DynaRef) { ++entries; });
+		TEST_ASSERT_EQUAL(3, entries);
+
+		// None of the views took a reference on the shared storage
+		TEST_ASSERT_EQUAL(arrayUses, doc["samples"].array.use_count());
+
+		const DynaVal copied = window.toDynaVal();
+		TEST_ASSERT_EQUAL(5, copied.size());
+		TEST_ASSERT_EQUAL_INT(60, copied[4].toInt());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_ring_window_and_bulk_erase() {
+	using namespace Irrelon;
+
+	try {
+		DynaRing window(4);
+		for (int32_t i = 0; i < 6; ++i) window.push(i);
+		TEST_ASSERT_TRUE(window.full());
+		TEST_ASSERT_EQUAL_STRING("[2,3,4,5]", window.toJson().c_str());
+		TEST_ASSERT_EQUAL_INT(2, window[0].toInt());
+		TEST_ASSERT_EQUAL_INT(5, window.back().toInt());
+
+		TEST_ASSERT_EQUAL_INT(2, window.shift().toInt());
+		TEST_ASSERT_EQUAL_INT(5, window.pop().toInt());
+		window.push(6);
+		TEST_ASSERT_EQUAL_STRING("[3,4,6]", window.toJson().c_str());
+		const DynaRing &view = window;
+		TEST_ASSERT_TRUE(view[7].isNull());
+
+		int32_t total = 0;
+		for (const DynaVal &val : window) total += val.toInt();
+		TEST_ASSERT_EQUAL_INT(13, total);
+
+		window.clear();
+		TEST_ASSERT_TRUE(window.shift().isUndefined());
+
+		DynaVal history;
+		for (int32_t i = 0; i < 10; ++i) history.push(i);
+		const DynaRing tail = DynaRing::fromArray(history, 3);
+		TEST_ASSERT_EQUAL_STRING("[7,8,9]", tail.toDynaVal().toJson().c_str());
+
+		history.eraseRange(0, 4);
+		TEST_ASSERT_EQUAL_STRING("[4,5,6,7,8,9]", history.toJson().c_str());
+		history.eraseRange(4, 100);
+		TEST_ASSERT_EQUAL_STRING("[4,5,6,7]", history.toJson().c_str());
+
+		const DynaVal removed = history.splice(1, 2, std::vector<DynaVal> {DynaVal("a"), DynaVal("b"), DynaVal("c")});
+		TEST_ASSERT_EQUAL_STRING("[5,6]", removed.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("[4,\"a\",\"b\",\"c\",7]", history.toJson().c_str());
+		TEST_ASSERT_EQUAL(0, history.splice(99, 1, std::vector<DynaVal> {DynaVal(8)}).size());
+		TEST_ASSERT_EQUAL_INT(8, history[5].toInt());
+
+		history.clear();
+		TEST_ASSERT_EQUAL(0, history.splice(0, 0, std::vector<DynaVal> {DynaVal(7), DynaVal(8)}).size());
+		TEST_ASSERT_EQUAL_STRING("[7,8]", history.toJson().c_str());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_reserve_and_builder() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal list;
+		list.becomeArray().reserve(500);
+		TEST_ASSERT_TRUE(list.array->capacity() >= 500);
+		const DynaVal *storage = list.array->data();
+		for (int32_t i = 0; i < 500; ++i) list.push(i);
+		TEST_ASSERT_TRUE(storage == list.array->data());
+
+		DynaVal map;
+		map.becomeObject().reserve(100);
+		const size_t buckets = map.object->bucket_count();
+		for (int32_t i = 0; i < 100; ++i) map["k" + std::to_string(i)] = i;
+		TEST_ASSERT_EQUAL(buckets, map.object->bucket_count());
+
+		// Reserving a scalar leaves it alone
+		DynaVal scalar = 5;
+		scalar.reserve(10);
+		TEST_ASSERT_TRUE(scalar.isInt());
+
+		DynaBuilder b;
+		b.beginObject(3)
+			.key("id").value(42)
+			.key("name").value("probe")
+			.key("readings").beginArray(3);
+		for (int32_t i = 0; i < 3; ++i) {
+			b.beginObject(1).key("v").value(i * 2).endObject();
+		}
+		b.endArray().endObject();
+		TEST_ASSERT_TRUE(b.isComplete());
+
+		DynaVal doc = b.build();
+		TEST_ASSERT_EQUAL_INT(42, doc["id"].toInt());
+		TEST_ASSERT_TRUE(doc["name"] == "probe");
+		TEST_ASSERT_EQUAL(3, doc["readings"].size());
+		TEST_ASSERT_EQUAL_INT(4, doc["readings"][2]["v"].toInt());
+		TEST_ASSERT_FALSE(b.isComplete());
+
+		bool threw = false;
+		try {
+			DynaBuilder bad;
+			bad.beginObject().value(1);
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		TEST_ASSERT_TRUE(threw);
+
+		threw = false;
+		try {
+			DynaBuilder bad;
+			bad.beginArray().endObject();
+		} catch (const std::runtime_error &) {
+			threw = true;
+		}
+		TEST_ASSERT_TRUE(threw);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_zero_copy_strings() {
+	using namespace Irrelon;
+
+	try {
+		// Escape-free strings are read as views into the parse input
+		const std::string json = R"({"topic": "sensors/kitchen/temperature/fast", "escaped": "a\nb"})";
+		DynaJsonReader reader(json);
+		reader.expect('{', "object");
+		std::string_view raw;
+		TEST_ASSERT_TRUE(reader.readStringView(raw));
+		TEST_ASSERT_TRUE(raw == "topic");
+		reader.expect(':', "colon");
+		TEST_ASSERT_TRUE(reader.readStringView(raw));
+		TEST_ASSERT_TRUE(raw == "sensors/kitchen/temperature/fast");
+		TEST_ASSERT_TRUE(raw.data() > json.data() && raw.data() < json.data() + json.size());
+
+		reader.expect(',', "comma");
+		TEST_ASSERT_TRUE(reader.readStringView(raw));
+		reader.expect(':', "colon");
+		reader.skipWhitespace();
+		const size_t before = reader.position();
+		TEST_ASSERT_FALSE(reader.readStringView(raw));
+		TEST_ASSERT_EQUAL(before, reader.position());
+
+		DynaVal val = "probe";
+		TEST_ASSERT_TRUE(val.toStringView() == "probe");
+		TEST_ASSERT_TRUE(val.toStringView().data() == val.string.data());
+		TEST_ASSERT_TRUE(DynaVal(5).toStringView().empty());
+
+		// Long shared strings are one block for every copy, short ones stay inline
+		const DynaSharedString topic = std::string("sensors/kitchen/temperature/fast");
+		DynaSharedString copy = topic;
+		TEST_ASSERT_TRUE(copy.isShared());
+		TEST_ASSERT_TRUE(copy.data() == topic.data());
+		TEST_ASSERT_TRUE(copy == "sensors/kitchen/temperature/fast");
+		TEST_ASSERT_FALSE(DynaSharedString("probe").isShared());
+		const DynaSharedString moved = std::move(copy);
+		TEST_ASSERT_TRUE(moved.data() == topic.data());
+		TEST_ASSERT_TRUE(copy.empty());
+		copy.assign("kitchen", 7);
+		TEST_ASSERT_EQUAL_STRING("kitchen", copy.c_str());
+		TEST_ASSERT_TRUE(topic.compare(moved) == 0);
+
+#ifdef DYNAVAL_SHARED_STRINGS
+		DynaVal doc;
+		doc["topic"] = std::string(topic);
+		const DynaVal copied = doc.deepCopy();
+		TEST_ASSERT_TRUE(copied["topic"].string.data() == doc["topic"].string.data());
+#endif
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_non_throwing_accessors() {
+	using namespace Irrelon;
+
+	try {
+		DynaVal doc;
+		doc["name"] = "probe";
+		doc["count"] = 3;
+		doc["ratio"] = 2.5;
+		doc["big"] = 5000000000.0;
+		doc["on"] = true;
+		doc["bytes"].push(DynaVal(static_cast<u_int>(104)));
+		doc["bytes"].push(DynaVal(static_cast<u_int>(105)));
+
+		TEST_ASSERT_NOT_NULL(doc.tryObject());
+		TEST_ASSERT_NULL(doc.tryArray());
+		TEST_ASSERT_EQUAL(2, doc["bytes"].tryArray()->size());
+
+		TEST_ASSERT_EQUAL(3, doc["count"].get<int>().value());
+		TEST_ASSERT_EQUAL_DOUBLE(3.0, doc["count"].get<double>().value());
+		TEST_ASSERT_FALSE(doc["ratio"].get<int>().has_value());
+		TEST_ASSERT_FALSE(doc["big"].get<int>().has_value());
+		TEST_ASSERT_TRUE(doc["big"].get<int64_t>().value() == 5000000000LL);
+		TEST_ASSERT_FALSE(doc["name"].get<double>().has_value());
+		TEST_ASSERT_TRUE(doc["name"].get<std::string_view>().value() == "probe");
+		TEST_ASSERT_TRUE(doc["on"].get<bool>().value());
+		TEST_ASSERT_FALSE(doc["count"].get<bool>().has_value());
+
+		const size_t keys = doc.size();
+		TEST_ASSERT_NULL(doc.at("missing"));
+		TEST_ASSERT_NULL(doc.at("name")->at("inner"));
+		TEST_ASSERT_NULL(doc["bytes"].at(7));
+		TEST_ASSERT_EQUAL(keys, doc.size());
+		TEST_ASSERT_EQUAL(2, doc["bytes"].size());
+
+		*doc.at("count") = 4;
+		TEST_ASSERT_EQUAL(4, doc["count"].toInt());
+		TEST_ASSERT_EQUAL(105, doc.at("bytes")->at(1)->toInt());
+
+		TEST_ASSERT_EQUAL_STRING("hi", doc["bytes"].tryArrayToString().value().c_str());
+		TEST_ASSERT_FALSE(doc["name"].tryArrayToString().has_value());
+
+		DynaVal error = DynaVal::error("Nope", 404);
+		TEST_ASSERT_NULL(error.at("key"));
+
+		DynaVal arr;
+		arr.becomeArray();
+		arr[-1] = 5;
+		TEST_ASSERT_EQUAL(0, arr.size());
+
+		int value = 0;
+		TEST_ASSERT_TRUE(dynaFromJson("[1, 2", value).isError());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_static_and_lazy_errors() {
+	using namespace Irrelon;
+
+	try {
+		static const DynaError notFound("Not found", 404);
+		const DynaVal first = DynaVal::staticError(notFound);
+		const DynaVal copy = first;
+		TEST_ASSERT_TRUE(first.isError());
+		TEST_ASSERT_TRUE(copy.isStaticError());
+		TEST_ASSERT_TRUE(copy.errorData.get() == &notFound);
+		TEST_ASSERT_TRUE(first.deepCopy().errorData.get() == &notFound);
+		TEST_ASSERT_EQUAL_INT(404, copy.toError().statusCode);
+		TEST_ASSERT_EQUAL_STRING("Error(404): Not found", copy.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("Error(404): Not found", copy.toString().c_str());
+		TEST_ASSERT_TRUE(first.equals(DynaVal::error("Not found", 404)));
+
+		DynaVal edited = first;
+		edited.editError().key = "users.7";
+		TEST_ASSERT_FALSE(edited.isStaticError());
+		TEST_ASSERT_EQUAL_STRING("users.7", edited.toError().key.c_str());
+		TEST_ASSERT_TRUE(notFound.key.empty());
+
+		const DynaVal plain = DynaVal::error("Bad input", 400);
+		TEST_ASSERT_FALSE(plain.isStaticError());
+		TEST_ASSERT_NULL(plain.toError().stack);
+		TEST_ASSERT_TRUE(plain.errorStack().isArray());
+		TEST_ASSERT_EQUAL(0, plain.errorStack().size());
+		const DynaVal traced = DynaVal::error("Bad input", 400, {"parse", "handler"});
+		TEST_ASSERT_EQUAL(2, traced.errorStack().size());
+
+		// The stack is allocated when asked for, and a copy's frames stay its own
+		DynaVal framed = plain;
+		framed.editErrorStack().push(DynaVal("handler"));
+		TEST_ASSERT_EQUAL(1, framed.errorStack().size());
+		TEST_ASSERT_NULL(plain.toError().stack);
+		DynaVal reframed = traced;
+		reframed.editErrorStack().push(DynaVal("retry"));
+		TEST_ASSERT_EQUAL(3, reframed.errorStack().size());
+		TEST_ASSERT_EQUAL(2, traced.errorStack().size());
+
+		// Only the copy editError() made is changed in place
+		DynaVal owned = DynaVal::error("Bad input", 400);
+		const DynaError *before = &owned.editError();
+		owned.editError().key = "body";
+		TEST_ASSERT_TRUE(&owned.toError() == before);
+		const auto replaced = std::make_shared<const DynaError>("Replaced", 400);
+		owned.errorData = replaced;
+		owned.editError().key = "query";
+		TEST_ASSERT_TRUE(replaced->key.empty());
+		TEST_ASSERT_EQUAL_STRING("query", owned.toError().key.c_str());
+
+		DynaVal shared = plain;
+		shared.editError().key = "body";
+		TEST_ASSERT_TRUE(plain.toError().key.empty());
+
+		DynaVal doc;
+		doc["error"] = first;
+		TEST_ASSERT_EQUAL_STRING("{\"error\":Error(404): Not found}", doc.toJson().c_str());
+
+		// A frozen error refuses edits, and a cached parent drops its fragment on one
+		DynaVal locked;
+		locked["error"] = DynaVal::error("Original", 500);
+		locked.freeze();
+		const std::string lockedJson = locked.toJson();
+		bool threw = false;
+		try { locked["error"].editError().message = "mutated"; } catch (const std::runtime_error &) { threw = true; }
+		TEST_ASSERT_TRUE(threw);
+		TEST_ASSERT_EQUAL_STRING(lockedJson.c_str(), locked.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("Original", locked["error"].toError().message.c_str());
+
+		DynaVal cached;
+		cached["error"] = DynaVal::error("Original", 500);
+		cached.enableJsonCache();
+		TEST_ASSERT_EQUAL_STRING("{\"error\":Error(500): Original}", cached.toJson().c_str());
+		cached["error"].editError().message = "Changed";
+		TEST_ASSERT_EQUAL_STRING("{\"error\":Error(500): Changed}", cached.toJson().c_str());
+		cached["error"].editError().statusCode = 503;
+		TEST_ASSERT_EQUAL_STRING("{\"error\":Error(503): Changed}", cached.toJson().c_str());
+
+		std::string out;
+		DynaError().appendTo(out);
+		TEST_ASSERT_EQUAL_STRING("Error(<null>): Unknown error occurred", out.c_str());
+
+		int value = 0;
+		TEST_ASSERT_TRUE(dynaFromJson("1 2", value).isStaticError());
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
+void test_typed_visit_and_is() {
+	using namespace Irrelon;
+
+	try {
+		const auto describe = [](const DynaVal &val) {
+			return val.visit(DynaOverloaded{
+				[](DynaUndefined) { return std::string("undefined"); },
+				[](std::nullptr_t) { return std::string("null"); },
+				[](const bool value) { return std::string(value ? "yes" : "no"); },
+				[](const int value) { return "int " + std::to_string(value); },
+				[](const unsigned int value) { return "uint " + std::to_string(value); },
+				[](const int64_t value) { return "long " + std::to_string(value); },
+				[](const float) { return std::string("float"); },
+				[](const double value) { return "double " + std::to_string(static_cast<int>(value)); },
+				[](const std::string &value) { return "string " + value; },
+				[](const DynaValArray &items) { return "array " + std::to_string(items.size()); },
+				[](const DynaValObject &entries) { return "object " + std::to_string(entries.size()); },
+				[](const DynaError &err) { return "error " + std::to_string(err.statusCode); }
+			});
+		};
+
+		DynaVal doc;
+		doc["count"] = -3;
+		doc["flags"] = static_cast<u_int>(7);
+		doc["big"] = 5000000000L;
+		doc["ratio"] = 2.5f;
+		doc["mean"] = 4.0;
+		doc["on"] = true;
+		doc["name"] = "probe";
+		doc["tags"].push("a");
+		doc["tags"].push("b");
+
+		TEST_ASSERT_EQUAL_STRING("int -3", describe(doc["count"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("uint 7", describe(doc["flags"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("long 5000000000", describe(doc["big"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("float", describe(doc["ratio"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("double 4", describe(doc["mean"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("yes", describe(doc["on"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("string probe", describe(doc["name"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("array 2", describe(doc["tags"]).c_str());
+		TEST_ASSERT_EQUAL_STRING("object 8", describe(doc).c_str());
+		TEST_ASSERT_EQUAL_STRING("null", describe(DynaVal()).c_str());
+		TEST_ASSERT_EQUAL_STRING("undefined", describe(DynaVal().becomeUndefined()).c_str());
+		TEST_ASSERT_EQUAL_STRING("error 418", describe(DynaVal::error("Teapot", 418)).c_str());
+
+		const size_t weight = doc.visit(DynaOverloaded{
+			[](const DynaValObject &entries) { return entries.size(); },
+			[](const auto &) { return size_t(1); }
+		});
+		TEST_ASSERT_EQUAL(8, weight);
+
+		TEST_ASSERT_TRUE(doc["count"].is<int>());
+		TEST_ASSERT_FALSE(doc["count"].is<double>());
+		TEST_ASSERT_TRUE(doc["big"].is<int64_t>());
+		TEST_ASSERT_TRUE(doc["name"].is<std::string>());
+		TEST_ASSERT_TRUE(doc["tags"].is<DynaValArray>());
+		TEST_ASSERT_TRUE(doc.is<DynaValObject>());
+		TEST_ASSERT_TRUE(DynaVal().is<std::nullptr_t>());
+		TEST_ASSERT_TRUE(DynaVal().becomeUndefined().is<DynaUndefined>());
+		TEST_ASSERT_EQUAL(-3, doc["count"].get<int>().value());
+
+		TEST_ASSERT_TRUE(DynaVal(0).isFalsy());
+		TEST_ASSERT_FALSE(doc["count"].isFalsy());
+		TEST_ASSERT_TRUE(DynaVal("").isFalsy());
+		TEST_ASSERT_TRUE(DynaVal().becomeArray().isFalsy());
+		TEST_ASSERT_FALSE(doc["tags"].isFalsy());
+		TEST_ASSERT_FALSE(DynaVal::error("Nope", 400).isFalsy());
+
+		// Numbers outside their type's range reach the double handler instead of wrapping
+		DynaVal wideInt;
+		wideInt.type = DynaValType::Int;
+		wideInt.number = 4e9;
+		DynaVal negativeUInt;
+		negativeUInt.type = DynaValType::UInt;
+		negativeUInt.number = -1;
+		TEST_ASSERT_EQUAL_STRING("double -1", describe(negativeUInt).c_str());
+		TEST_ASSERT_EQUAL_STRING("4e+09", wideInt.toJson().c_str());
+		TEST_ASSERT_EQUAL_STRING("-1", negativeUInt.toJson().c_str());
+		TEST_ASSERT_FALSE(wideInt.isFalsy());
+		negativeUInt.number = 0.5;
+		TEST_ASSERT_FALSE(negativeUInt.isFalsy());
+
+		const DynaVal copy = doc.deepCopy();
+		TEST_ASSERT_TRUE(copy.equals(doc));
+		TEST_ASSERT_TRUE(copy["flags"].isUInt());
+		TEST_ASSERT_TRUE(copy["ratio"].isFloat());
+		TEST_ASSERT_FALSE(copy["tags"].array == doc["tags"].array);
+
+		DynaVal line;
+		line["text"] = "say \"hi\"\n";
+		line["n"] = 12;
+		line["list"].push(1.5);
+		line["list"].push("x");
+		line["list"].push(false);
+		const std::string json = line.toJson();
+		TEST_ASSERT_TRUE(json.find("\"text\":\"say \\\"hi\\\"\\n\"") != std::string::npos);
+		TEST_ASSERT_TRUE(json.find("\"n\":12") != std::string::npos);
+		TEST_ASSERT_TRUE(json.find("\"list\":[1.5,\"x\",false]") != std::string::npos);
+	} catch (const std::exception &e) {
+		Irrelon::dynaLogLn("Exception", e.what());
+		TEST_FAIL_MESSAGE(e.what());
+	}
+}
+
 int main() {
 	UNITY_BEGIN();
 	RUN_TEST(test_object_assignment);
 	RUN_TEST(test_array_assignment);
+	RUN_TEST(test_parallel_deep_copy_json_and_equals);
+	RUN_TEST(test_snapshot_cell_concurrent_readers);
+	RUN_TEST(test_concurrent_object_multiple_writers);
+	RUN_TEST(test_deep_freeze_enforced_and_memoized);
+	RUN_TEST(test_incremental_json_cache);
+	RUN_TEST(test_json_cache_sees_writes_through_handles);
+	RUN_TEST(test_diff_and_apply_patch);
+	RUN_TEST(test_cbor_round_trip);
+	RUN_TEST(test_snapshot_view);
+	RUN_TEST(test_journal_replay_and_compaction);
+	RUN_TEST(test_compile_time_literal);
+	RUN_TEST(test_struct_binding);
+	RUN_TEST(test_schema_validation);
+	RUN_TEST(test_program_compile_and_run);
+	RUN_TEST(test_query_compile_and_stream);
+	RUN_TEST(test_secondary_index);
+	RUN_TEST(test_columnar_table);
+	RUN_TEST(test_numeric_stats);
+	RUN_TEST(test_sort_top_k_group_by);
+	RUN_TEST(test_ref_and_slice_views);
+	RUN_TEST(test_ring_window_and_bulk_erase);
+	RUN_TEST(test_reserve_and_builder);
+	RUN_TEST(test_zero_copy_strings);
+	RUN_TEST(test_non_throwing_accessors);
+	RUN_TEST(test_static_and_lazy_errors);
+	RUN_TEST(test_typed_visit_and_is);
 	UNITY_END();
 }